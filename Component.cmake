@@ -84,7 +84,7 @@ if (WINDOWS)
     message( FATAL "unsupported visual studio compiler version ${MSVC_VERSION}" )
   endif()
 elseif(LINUX)
-  set( COOL_NG_PLATFORM_LIBRARIES pthread dispatch )
+  set( COOL_NG_PLATFORM_LIBRARIES pthread dispatch rt )
 endif()
 
 
@@ -110,12 +110,19 @@ set( COOL_NG_API_HEADERS
     include/cool/ng/traits.h
     include/cool/ng/bases.h
     include/cool/ng/ip_address.h
+    include/cool/ng/local_address.h
     include/cool/ng/binary.h
     include/cool/ng/async/task.h
     include/cool/ng/async/runner.h
     include/cool/ng/async/event_sources.h
+    include/cool/ng/async/file.h
+    include/cool/ng/async/watcher.h
+    include/cool/ng/async/net/pool.h
+    include/cool/ng/async/net/resolver.h
     include/cool/ng/async/net/server.h
+    include/cool/ng/async/net/socket_options.h
     include/cool/ng/async/net/stream.h
+    include/cool/ng/async/ipc/channel.h
 )
 
 set( COOL_NG_IMPL_HEADERS
@@ -131,8 +138,12 @@ set( COOL_NG_IMPL_HEADERS
     include/cool/ng/impl/async/repeat_impl.h
     include/cool/ng/impl/async/loop_impl.h
     include/cool/ng/impl/async/event_sources_types.h
+    include/cool/ng/impl/async/fd_watcher.h
+    include/cool/ng/impl/async/file_io.h
     include/cool/ng/impl/async/net_server.h
     include/cool/ng/impl/async/net_stream.h
+    include/cool/ng/impl/async/net_resolver.h
+    include/cool/ng/impl/async/ipc_channel.h
 )
 
 # ### ##################################################
@@ -152,6 +163,8 @@ set( COOL_NG_LIB_SRCS
   ${COOL_NG_HOME}/lib/src/ip_address.cpp
   ${COOL_NG_HOME}/lib/src/async/runner.cpp
   ${COOL_NG_HOME}/lib/src/async/event_sources.cpp
+  ${COOL_NG_HOME}/lib/src/async/resolver.cpp
+  ${COOL_NG_HOME}/lib/src/async/file.cpp
 )
 
 # --- executor sources
@@ -27,6 +27,7 @@
 #include <string>
 #include <memory>
 #include <cstdint>
+#include <cstddef>
 #include <functional>
 #include <chrono>
 
@@ -35,8 +36,10 @@
 #include "cool/ng/impl/async/event_sources_types.h"
 
 #include "task.h"
+#include "watcher.h"
 #include "net/stream.h"
 #include "net/server.h"
+#include "ipc/channel.h"
 
 namespace cool { namespace ng { namespace async {
 /**
@@ -304,6 +307,227 @@ class timer
   std::shared_ptr<detail::itf::timer> m_impl;
 };
 
+/**
+ * Coalescing notification event source.
+ *
+ * Notifier objects let any thread cheaply signal a user specified task. The
+ * signals are merged into a counter until the notifier gets to schedule the
+ * task, and the task receives the accumulated count as its input parameter.
+ * Several signals that arrive before the task is scheduled thus result in a
+ * single run of the task. Unlike calling @ref task::run() "run()" for every
+ * notification, signalling does not allocate memory and does not block.
+ *
+ * @note Upon creation the notifier object is inactive and must be explicitly
+ *   started using @ref start(). The signals raised while the notifier is
+ *   inactive are accumulated and reported once it is started.
+ * @note Notifier objects created via copy construction or copy assignment
+ *   are clones and refer to the same underlying notifier implementation.
+ * @note The notifier is not available on Microsoft Windows.
+ */
+class notifier
+{
+ public:
+  /**
+   * User task type.
+   *
+   * The type of the task the user shall specify to be run when signalled. It
+   * corresponds to the following @ref cool::ng::async::task "task" type:
+   * ~~~
+   *    cool::ng::async::task<std::size_t, void>
+   * ~~~
+   * The input parameter of the task is the number of signals accumulated
+   * since the previous run of the task.
+   */
+  using task_type = detail::itf::notifier::task_type;
+
+ public:
+  /**
+   * Default constructor to allow @ref notifier "notifiers" to be stored in
+   * standard library containers.
+   *
+   * This constructor constructs an empty, non-functional @ref notifier. The
+   * only way to make it functional is to replace it with a functional notifier
+   * using copy assignment or move assignment operator.
+   *
+   * @note The only permitted operations on an empty notifier are copy assignment
+   *   and the @ref operator bool() "bool" conversion operator. Any other
+   *   operation will throw @ref cool::ng::exception::empty_object "empty_object"
+   *   exception.
+   */
+  notifier() { /* noop */ }
+
+  /**
+   * Create a notifier object.
+   *
+   * @param task_ the task to run when the notifier is signalled
+   *
+   * @throw exception::illegal_argument thrown if the task @a task_ is empty
+   * @throw exception::operation_failed with error code @c not_available if
+   *        the platform does not support the notifier
+   */
+  dlldecl explicit notifier(const task_type& task_);
+
+  /**
+   * Signal the notifier.
+   *
+   * Adds @a count_ to the accumulated count and makes sure that the task is
+   * going to be scheduled. This method may be called from any thread.
+   *
+   * @param count_ the number of signals to add. Signalling with zero count
+   *               has no effect.
+   */
+  dlldecl void signal(std::size_t count_ = 1);
+
+  /**
+   * Start the notifier.
+   *
+   * Enables the scheduling of the task, including the signals accumulated
+   * while the notifier was inactive.
+   */
+  dlldecl void start();
+
+  /**
+   * Suspend the notifier.
+   *
+   * The signals raised while the notifier is suspended are accumulated and
+   * reported when it is started again.
+   */
+  dlldecl void stop();
+
+  /**
+   * Empty notifier predicate.
+   *
+   * @return true if this @ref notifier is properly created and functional, false if empty.
+   */
+  dlldecl explicit operator bool() const;
+
+  /**
+   * Return notifier's name.
+   *
+   * Each notifier instance, except empty notifiers, has a unique name.
+   */
+  dlldecl const std::string& name() const;
+
+ private:
+  std::shared_ptr<detail::itf::notifier> m_impl;
+};
+
+/**
+ * POSIX signal event source.
+ *
+ * Signal objects turn the deliveries of a POSIX signal, such as @c SIGTERM,
+ * @c SIGHUP or @c SIGUSR1, into the runs of a user specified task. This
+ * removes the need for a dedicated signal handling thread; the task runs in
+ * its @ref runner "runner's" context like any other task and may freely use
+ * the runner's data. The deliveries of the signal that arrive before the task
+ * is scheduled are coalesced, and the task receives their count as its input
+ * parameter.
+ *
+ * On Linux the deliveries of the signal are reported through the signal
+ * objects only if the signal is blocked in all threads of the process. The
+ * signal object blocks the signal in the thread that creates it, and unblocks
+ * it in the same thread when the last signal object for the signal is
+ * destroyed, unless it was blocked before; the disposition of the signal is
+ * left unchanged. On other platforms the default disposition of the signal is
+ * ignored while at least one signal object for a given signal exists, and the
+ * original disposition is restored when the last signal object for the
+ * signal is destroyed.
+ *
+ * @note Upon creation the signal object is inactive and must be explicitly
+ *   started using @ref start(). The deliveries of the signal while the
+ *   signal object is inactive are reported once it is started.
+ * @note Signal objects created via copy construction or copy assignment
+ *   are clones and refer to the same underlying signal implementation.
+ * @note On Linux the application should block the signal in the main
+ *   thread before it creates any other thread, so that all threads inherit
+ *   the blocked signal. The signal that is not blocked in some thread may be
+ *   delivered to that thread and handled according to its disposition.
+ * @note On platforms other than Linux the ignored disposition is inherited
+ *   by the child processes created while the signal object exists, also
+ *   across @c execve().
+ * @note The signal object is not available on Microsoft Windows.
+ */
+class signal
+{
+ public:
+  /**
+   * User task type.
+   *
+   * The type of the task the user shall specify to be run upon the delivery
+   * of the signal. It corresponds to the following @ref cool::ng::async::task
+   * "task" type:
+   * ~~~
+   *    cool::ng::async::task<std::size_t, void>
+   * ~~~
+   * The input parameter of the task is the number of the deliveries of the
+   * signal since the previous run of the task.
+   */
+  using task_type = detail::itf::signal::task_type;
+
+ public:
+  /**
+   * Default constructor to allow @ref signal "signal objects" to be stored in
+   * standard library containers.
+   *
+   * This constructor constructs an empty, non-functional @ref signal. The
+   * only way to make it functional is to replace it with a functional signal
+   * object using copy assignment or move assignment operator.
+   *
+   * @note The only permitted operations on an empty signal object are copy
+   *   assignment and the @ref operator bool() "bool" conversion operator. Any
+   *   other operation will throw @ref cool::ng::exception::empty_object
+   *   "empty_object" exception.
+   */
+  signal() { /* noop */ }
+
+  /**
+   * Create a signal object.
+   *
+   * @param signo_ the number of the signal to observe
+   * @param task_  the task to run when the signal is delivered
+   *
+   * @throw exception::illegal_argument thrown if the task @a task_ is empty,
+   *        or if @a signo_ is not a valid signal number or denotes a signal
+   *        that cannot be caught
+   * @throw exception::operation_failed with error code @c not_available if
+   *        the platform does not support the signal objects
+   */
+  dlldecl signal(int signo_, const task_type& task_);
+
+  /**
+   * Start the signal object.
+   *
+   * Enables the scheduling of the task, including the deliveries of the signal
+   * while the signal object was inactive.
+   */
+  dlldecl void start();
+
+  /**
+   * Suspend the signal object.
+   *
+   * The deliveries of the signal while the signal object is suspended are
+   * reported when it is started again.
+   */
+  dlldecl void stop();
+
+  /**
+   * Empty signal object predicate.
+   *
+   * @return true if this @ref signal is properly created and functional, false if empty.
+   */
+  dlldecl explicit operator bool() const;
+
+  /**
+   * Return signal object's name.
+   *
+   * Each signal object, except empty ones, has a unique name.
+   */
+  dlldecl const std::string& name() const;
+
+ private:
+  std::shared_ptr<detail::itf::signal> m_impl;
+};
+
 } } } // namespace
 
 #endif
@@ -0,0 +1,214 @@
+/* 
+ * Copyright (c) 2017 Leon Mlakar.
+ * Copyright (c) 2017 Digiverse d.o.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. The
+ * license should be included in the source distribution of the Software;
+ * if not, you may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and licensing terms shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#if !defined(cool_ng_64b2449e_84ef_4622_b9eb_c4c5e43c4b03)
+#define      cool_ng_64b2449e_84ef_4622_b9eb_c4c5e43c4b03
+
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+#include "cool/ng/impl/platform.h"
+#include "cool/ng/ip_address.h"
+#include "cool/ng/async/task.h"
+#include "cool/ng/impl/async/file_io.h"
+
+namespace cool { namespace ng { namespace async {
+
+/**
+ * Asynchronous file.
+ *
+ * The file performs positional reads and writes without blocking the
+ * @ref cool::ng::async::runner "runner". The requests are executed by a small
+ * pool of threads dedicated to the file and their completions are reported
+ * by running the user specified @ref task, with the @ref completion as its
+ * input parameter, on the task's runner. The requests do not move any file
+ * position and may be executed concurrently and in any order, thus the
+ * requests that depend on each other should be issued from the completion of
+ * the previous request.
+ *
+ * The read requests transfer the requested number of bytes unless the end of
+ * the file is reached first. The write requests always transfer the
+ * requested number of bytes, unless they fail.
+ *
+ * @note Copies of the file share the thread pool and the descriptor.
+ * @note The requests issued before the last copy of the file is destroyed are
+ *   still executed and their completions are reported. The buffers passed to
+ *   the requests must thus remain valid until the completions are reported.
+ * @note This header is not included by <tt>cool/ng/async.h</tt> and must be
+ *   included explicitly.
+ * @note The asynchronous file is not available on Microsoft Windows.
+ */
+class file
+{
+ public:
+  /**
+   * The input parameter of the completion task.
+   *
+   * ~~~
+   *   struct completion
+   *   {
+   *     void*           buffer;   // buffer passed to the request
+   *     std::size_t     size;     // number of bytes transferred
+   *     uint64_t        offset;   // file offset passed to the request
+   *     std::error_code error;    // error code if the request failed
+   *   };
+   * ~~~
+   * The error code is a @c std::system_category error code set from
+   * @c errno.
+   */
+  using completion = detail::itf::file::completion;
+  /**
+   * The type of the completion task. It corresponds to the following
+   * @ref cool::ng::async::task "task" type:
+   * ~~~
+   *    cool::ng::async::task<file::completion, void>
+   * ~~~
+   */
+  using task_type = detail::itf::file::task_type;
+
+  /**
+   * File configuration.
+   */
+  struct options
+  {
+    options() : threads(2)
+    { /* noop */ }
+
+    std::size_t threads;   //!< Number of threads executing the requests
+  };
+
+ public:
+  /**
+   * Default constructor to allow @ref file "files" to be stored in standard
+   * library containers.
+   *
+   * This constructor constructs an empty, non-functional @ref file. The only
+   * way to make it functional is to replace it with a functional file using
+   * copy assignment or move assignment operator.
+   *
+   * @note The only permitted operations on an empty file are copy assignment
+   *   and the @ref operator bool() "bool" conversion operator. Any other
+   *   operation will throw @ref cool::ng::exception::empty_object "empty_object"
+   *   exception.
+   */
+  file() { /* noop */ }
+
+  /**
+   * Opens the file.
+   *
+   * @param path_  path name of the file
+   * @param flags_ flags passed to @c open(2), for example <tt>O_RDWR | O_CREAT</tt>
+   * @param mode_  permissions of the file if created
+   * @param opts_  file configuration
+   *
+   * @throw cool::ng::exception::illegal_argument if the number of threads is 0
+   * @throw std::system_error if the file could not be opened or if the threads
+   *        could not be started
+   * @throw cool::ng::exception::operation_failed with error code @c not_available
+   *        if the platform does not support the asynchronous file
+   */
+  dlldecl file(const std::string& path_, int flags_, int mode_ = 0644, const options& opts_ = options());
+
+  /**
+   * Uses the already opened file descriptor.
+   *
+   * @param fd_    file descriptor
+   * @param owner_ if @c true, the file closes the descriptor when the last copy
+   *               is destroyed and all requests are completed. Otherwise the
+   *               descriptor must remain open until then.
+   * @param opts_  file configuration
+   *
+   * @throw cool::ng::exception::illegal_argument if the number of threads is 0
+   *        or if the descriptor is not valid
+   * @throw std::system_error if the threads could not be started
+   * @throw cool::ng::exception::operation_failed with error code @c not_available
+   *        if the platform does not support the asynchronous file
+   */
+  dlldecl file(cool::ng::net::handle fd_, bool owner_ = false, const options& opts_ = options());
+
+  /**
+   * Reads from the file.
+   *
+   * Reads up to @a size_ bytes at offset @a offset_ into the buffer and runs
+   * the task @a t_ with the @ref completion when done.
+   *
+   * @param offset_ file offset to read from
+   * @param buf_    buffer to read into, which must remain valid until the
+   *                completion is reported
+   * @param size_   number of bytes to read
+   * @param t_      the completion task
+   *
+   * @throw cool::ng::exception::illegal_argument if the buffer or the task is empty
+   */
+  dlldecl void read(uint64_t offset_, void* buf_, std::size_t size_, const task_type& t_);
+  /**
+   * Writes to the file.
+   *
+   * Writes @a size_ bytes from the buffer at offset @a offset_ and runs the
+   * task @a t_ with the @ref completion when done.
+   *
+   * @param offset_ file offset to write to
+   * @param buf_    buffer to write from, which must remain valid until the
+   *                completion is reported
+   * @param size_   number of bytes to write
+   * @param t_      the completion task
+   *
+   * @throw cool::ng::exception::illegal_argument if the buffer or the task is empty
+   */
+  dlldecl void write(uint64_t offset_, const void* buf_, std::size_t size_, const task_type& t_);
+  /**
+   * Flushes the file data to the storage device.
+   *
+   * Runs the task @a t_ when the data written by the writes completed so far
+   * are flushed.
+   *
+   * @param t_ the completion task
+   *
+   * @throw cool::ng::exception::illegal_argument if the task is empty
+   */
+  dlldecl void sync(const task_type& t_);
+  /**
+   * Returns the number of requests that are not yet completed.
+   */
+  dlldecl std::size_t pending() const;
+  /**
+   * Returns the file descriptor.
+   */
+  dlldecl cool::ng::net::handle native_handle() const;
+  /**
+   * Empty file predicate.
+   *
+   * @return true if this @ref file is properly created and functional, false if empty.
+   */
+  dlldecl explicit operator bool() const;
+
+ private:
+  std::shared_ptr<detail::itf::file> m_impl;
+};
+
+} } } // namespace
+
+#endif
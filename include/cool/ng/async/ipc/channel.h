@@ -0,0 +1,206 @@
+/* 
+ * Copyright (c) 2017 Leon Mlakar.
+ * Copyright (c) 2017 Digiverse d.o.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. The
+ * license should be included in the source distribution of the Software;
+ * if not, you may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and licensing terms shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#if !defined(cool_ng_a4f2c815_6d3e_4b9a_9c07_e1d58b3f6a20)
+#define      cool_ng_a4f2c815_6d3e_4b9a_9c07_e1d58b3f6a20
+
+#include <string>
+#include <memory>
+#include <functional>
+#include <cstdint>
+
+#include "cool/ng/bases.h"
+#include "cool/ng/impl/platform.h"
+
+#include "cool/ng/impl/async/event_sources_types.h"
+#include "cool/ng/impl/async/ipc_channel.h"
+
+namespace cool { namespace ng {
+
+namespace async {
+
+/**
+ * This namespace contains interprocess communication event sources.
+ */
+namespace ipc {
+
+/**
+ * Message channel between two processes on the same host.
+ *
+ * The channel transfers messages between two processes through a pair of
+ * single producer, single consumer ring buffers placed in the shared memory,
+ * one for each direction. The sender copies the message directly into the
+ * ring buffer and the receiver's read handler is given the message directly
+ * from the ring buffer, hence each message is copied only once. The receiver
+ * is woken up only if it has run out of messages and went to sleep; as long
+ * as it keeps up with the sender no system calls are made.
+ *
+ * The channel uses the same handler model as the network
+ * @ref cool::ng::async::net::stream "stream" but preserves message
+ * boundaries - each call to @ref write() results in exactly one call to the
+ * peer's read handler with the same data.
+ *
+ * One of the processes must @ref mode::create "create" the channel and the
+ * other must @ref mode::open "open" it, using the same name. The channel
+ * reports the following events to the event handler:
+ *   Value                       | Description
+ *   ----------------------------|------------
+ *   net::detail::oob_event::connect    | The peer opened the channel or, at the peer, the channel was opened
+ *   net::detail::oob_event::disconnect | The peer closed the channel
+ *   net::detail::oob_event::failure    | The peer's ring buffer is corrupt; the error code is @c std::errc::bad_message and the channel no longer reads the messages
+ *
+ * After the peer closes the channel, the channel remains usable and another
+ * peer may open it. Messages written while the peer is not connected remain
+ * in the ring buffer and are delivered to the next peer.
+ *
+ * @note The channel is only available on the POSIX platforms. On Microsoft
+ *   Windows the constructor throws @ref cool::ng::exception::operation_failed
+ *   "operation_failed" with error code @c not_available.
+ * @note The channel does not report the abnormal termination of the peer
+ *   process. However, the side of the channel left open by the terminated
+ *   process may be opened again.
+ * @note The channel uses a pair of fifos in the directory named by the
+ *   @c TMPDIR environment variable, or in @c /tmp if not set. Both processes
+ *   must thus use the same @c TMPDIR. The fifos must belong to the effective
+ *   user of the process.
+ * @note Channel objects created via copy construction or copy assignment
+ *   are clones and refer to the same underlying channel implementation.
+ */
+class channel
+{
+ public:
+  /**
+   * Default constructor to allow @ref channel "channels" to be stored in
+   * standard library containers.
+   *
+   * @note The only permitted operations on an empty channel are copy assignment
+   *   and the @ref operator bool() "bool" conversion operator. Any other
+   *   operation will throw @ref cool::ng::exception::empty_object "empty_object"
+   *   exception.
+   */
+  channel() { /* noop */ }
+  /**
+   * Creates or opens the channel.
+   *
+   * @tparam RunnerT <b>RunnerT</b> is the concrete type of the @ref cool::ng::async::runner "runner"
+   *         to be used to schedule tasks that will call specified handlers.
+   * @tparam ReadHandlerT <b>ReadHandlerT</b> is he actual type of the read handler.
+   *         This type must be assignable to the following functional type:
+   * ~~~{.c}
+   *     std::function<void(const std::shared_ptr<RunnerT>&, void*&, std::size_t&)>
+   * ~~~
+   *         The read handler is called once for each received message, with
+   *         the address and size of the message. The message data resides in
+   *         the shared memory and is only valid until the read handler returns.
+   *         Changes to the second and the third parameter are ignored.
+   * @tparam WriteHandlerT <b>WriteHandlerT</b> is the actual type of the write handler.
+   *         This type must be assignable to the following functional type:
+   * ~~~{.c}
+   *     std::function<void(const std::shared_ptr<RunnerT>&, const void*, std::size_t)>
+   * ~~~
+   *         The write handler is called once the message was copied into the
+   *         ring buffer and the data buffer is no longer needed.
+   * @tparam EvtHandlerT <b>EvtHandlerT</b> is the actual type of the event handler.
+   *         This type must be assignable to the following functional type:
+   * ~~~{.c}
+   *     std::function<void(const std::shared_ptr<RunnerT>&, net::detail::oob_event, const std::error_code& code)>
+   * ~~~
+   *
+   * @param r_  weak pointer to @ref cool::ng::async::runner "runner" to use to
+   *            schedule asynchronous notifications for execution.
+   * @param name_ name of the channel, which must not contain the @c / character
+   * @param mode_ whether to create a new channel or open existing one
+   * @param hr_ read handler
+   * @param hw_ write handler
+   * @param he_ event handler
+   * @param capacity_ capacity of each ring buffer, in bytes; ignored when
+   *            opening the channel. The capacity is rounded up to the whole
+   *            number of memory pages. The largest message that can be written
+   *            into the channel is about half of the capacity.
+   *
+   * @throw cool::ng::exception::illegal_argument if the channel name is not valid
+   * @throw cool::ng::exception::system_error if the shared memory or the
+   *        wake-up mechanism could not be created or opened
+   * @throw cool::ng::exception::operation_failed with error code
+   *        @c resource_busy if the channel is already opened by another peer,
+   *        or with error code @c not_available if the channels are not
+   *        supported on this platform
+   * @throw cool::ng::exception::runner_not_available if the @ref cool::ng::async::runner
+   *        "runner" specified via parameter @a r_ is no longer available
+   */
+  template <typename RunnerT, typename ReadHandlerT, typename WriteHandlerT, typename EvtHandlerT>
+  channel(const std::weak_ptr<RunnerT>& r_
+        , const std::string& name_
+        , mode mode_
+        , const ReadHandlerT& hr_
+        , const WriteHandlerT& hw_
+        , const EvtHandlerT& he_
+        , std::size_t capacity_ = 1048576)
+  {
+    using read_handler  = typename net::detail::types<RunnerT>::read_handler;
+    using write_handler = typename net::detail::types<RunnerT>::write_handler;
+    using event_handler = typename net::detail::types<RunnerT>::event_handler;
+
+    auto impl = cool::ng::util::shared_new<detail::channel<RunnerT>>(
+        r_
+      , static_cast<read_handler>(hr_)
+      , static_cast<write_handler>(hw_)
+      , static_cast<event_handler>(he_));
+
+    m_impl = impl;
+    impl->initialize(name_, mode_, capacity_);
+  }
+
+  dlldecl const std::string& name() const;
+
+  /**
+   * Send message to the peer.
+   *
+   * If there is enough free space in the ring buffer the message is copied
+   * immediately and the write completion is reported via the write handler.
+   * Otherwise the channel keeps the pointer to the data and completes the
+   * write when the peer frees enough space. Only one such write can be
+   * pending at any time.
+   *
+   * @throw cool::ng::exception::invalid_state if the channel was shut down.
+   * @throw cool::ng::exception::illegal_argument if the message is empty or
+   *   too large for the channel.
+   * @throw cool::ng::exception::operation_failed with error code
+   *   @c resource_busy if the previous write is not yet completed.
+   */
+  dlldecl void write(const void* data_, std::size_t size_);
+
+  /**
+   * Empty channel predicate.
+   *
+   * @return true if this @ref channel is properly created and functional, false if empty.
+   */
+  dlldecl explicit operator bool() const;
+
+ private:
+  std::shared_ptr<async::detail::itf::writable> m_impl;
+};
+
+} } } } // namespace
+
+#endif
@@ -0,0 +1,659 @@
+/* 
+ * Copyright (c) 2017 Leon Mlakar.
+ * Copyright (c) 2017 Digiverse d.o.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. The
+ * license should be included in the source distribution of the Software;
+ * if not, you may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and licensing terms shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#if !defined(cool_ng_5b8d0e3f_71c2_4a6e_b9f4_2d6a0c17e853)
+#define      cool_ng_5b8d0e3f_71c2_4a6e_b9f4_2d6a0c17e853
+
+#include <string>
+#include <memory>
+#include <functional>
+#include <cstdint>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#include "cool/ng/error.h"
+#include "cool/ng/exception.h"
+#include "cool/ng/ip_address.h"
+#include "cool/ng/async/task.h"
+#include "cool/ng/async/event_sources.h"
+
+namespace cool { namespace ng { namespace async { namespace net {
+
+/**
+ * Pool of connected client @ref stream "streams".
+ *
+ * The pool keeps idle connected streams, grouped by the remote address and
+ * port, and hands them out to the users, thus saving the connection set up
+ * for each short request/response exchange. The user @ref acquire() "acquires"
+ * the stream with its own set of handlers, uses it, and @ref release()
+ * "releases" it back to the pool. The pool can @ref reserve() "keep"
+ * a minimum number of idle connections to the remote peer, pre-connected in
+ * advance.
+ *
+ * The idle streams are evicted from the pool when the peer closes the
+ * connection, when they stay idle for longer than the idle timeout, or
+ * when there are more idle streams than the pool is configured to keep.
+ * The evicted streams are disconnected.
+ *
+ * The streams created by the pool use internal handlers, which forward the
+ * stream events to the handlers of the current user. While the stream is idle
+ * any data received from the peer is discarded.
+ *
+ * @tparam RunnerT <b>RunnerT</b> is the concrete type of the @ref cool::ng::async::runner "runner"
+ *         to be used for streams and to schedule calls to the user handlers.
+ *
+ * @note The pool is not copyable. Destroying the pool disconnects all idle
+ *   streams; the streams acquired by the users remain functional.
+ * @note This header is not included by <tt>cool/ng/async.h</tt> and must be
+ *   included explicitly.
+ */
+template <typename RunnerT>
+class pool
+{
+ public:
+  using read_handler  = typename detail::types<RunnerT>::read_handler;
+  using write_handler = typename detail::types<RunnerT>::write_handler;
+  using event_handler = typename detail::types<RunnerT>::event_handler;
+  /**
+   * Type of the handler called when the acquired stream is ready. The third
+   * parameter is set to the error code if the pool failed to connect the
+   * new stream, in which case the second parameter is an empty stream.
+   */
+  using ready_handler = std::function<void(const std::shared_ptr<RunnerT>&, const stream&, const std::error_code&)>;
+
+  /**
+   * Pool configuration.
+   */
+  struct options
+  {
+    options()
+      : max_idle(8)
+      , idle_timeout(std::chrono::seconds(60))
+      , buffer_size(16384)
+    { /* noop */ }
+
+    std::size_t               max_idle;      //!< Maximum number of idle streams per remote peer
+    std::chrono::milliseconds idle_timeout;  //!< Time after which the idle stream is evicted
+    std::size_t               buffer_size;   //!< Size of the read buffer of the new streams
+  };
+
+ private:
+  struct connection
+  {
+    connection() : connected(false), leased(false)
+    { /* noop */ }
+
+    std::string   key;
+    stream        strm;
+    bool          connected;
+    bool          leased;
+    read_handler  rh;
+    write_handler wh;
+    event_handler eh;
+    ready_handler ready;    // set while acquired stream is connecting
+    std::chrono::steady_clock::time_point since;
+  };
+  using conn_ptr = std::shared_ptr<connection>;
+
+  struct endpoint
+  {
+    endpoint() : port(0), min_idle(0), warming(0)
+    { /* noop */ }
+
+    cool::ng::net::ip::host_container addr;
+    uint16_t              port;
+    std::size_t           min_idle;
+    std::size_t           warming;   // pre-connecting streams
+    std::deque<conn_ptr>  idle;      // the most recently released at the back
+  };
+
+  struct state
+  {
+    state(const std::weak_ptr<RunnerT>& r_, const options& o_)
+      : runner(r_), opts(o_), closed(false)
+    { /* noop */ }
+
+    std::weak_ptr<RunnerT>          runner;
+    options                         opts;
+    std::mutex                      lock;
+    std::map<std::string, endpoint> endpoints;
+    std::map<std::string, conn_ptr> connections;   // by stream name
+    bool                            closed;
+  };
+  using state_ptr = std::shared_ptr<state>;
+
+ public:
+  pool(const pool&) = delete;
+  pool& operator =(const pool&) = delete;
+
+  /**
+   * Constructs a new connection pool.
+   *
+   * @param r_    weak pointer to @ref cool::ng::async::runner "runner" to use
+   *              for the streams and the pool maintenance
+   * @param opts_ pool configuration
+   *
+   * @throw cool::ng::exception::illegal_argument if the idle timeout or the
+   *        buffer size are 0
+   * @throw cool::ng::exception::runner_not_available if the runner is no
+   *        longer available
+   */
+  pool(const std::weak_ptr<RunnerT>& r_, const options& opts_ = options())
+    : m_state(std::make_shared<state>(r_, opts_))
+    , m_timer(make_sweep(m_state), sweep_period(opts_))
+  {
+    m_timer.start();
+  }
+
+  ~pool()
+  {
+    try { m_timer.stop(); } catch (...) { /* noop */ }
+
+    std::vector<conn_ptr> drop;
+    {
+      std::unique_lock<std::mutex> l(m_state->lock);
+      m_state->closed = true;
+      for (auto& ep : m_state->endpoints)
+        drop.insert(drop.end(), ep.second.idle.begin(), ep.second.idle.end());
+      m_state->endpoints.clear();
+      m_state->connections.clear();
+    }
+    for (auto& c : drop)
+      retire(m_state, c);
+  }
+
+  /**
+   * Acquire a connected stream to the remote peer.
+   *
+   * If there is an idle stream connected to the specified peer the pool hands
+   * it out, otherwise it creates and connects a new one. Either way the
+   * @a ready_ handler is called from the runner once the stream is ready for
+   * use. From then on and until the stream is @ref release() "released"
+   * back to the pool, the stream will call the specified handlers.
+   *
+   * @param addr_  IP address of the remote peer
+   * @param port_  port of the remote peer
+   * @param rh_    read handler for the acquired stream
+   * @param wh_    write handler for the acquired stream
+   * @param eh_    event handler for the acquired stream
+   * @param ready_ handler to call when the stream is ready
+   *
+   * @throw cool::ng::exception::invalid_state if the pool is being destroyed
+   * @throw cool::ng::exception::socket_failure if creating new connection failed
+   */
+  void acquire(const cool::ng::net::ip::address& addr_
+             , uint16_t port_
+             , const read_handler& rh_
+             , const write_handler& wh_
+             , const event_handler& eh_
+             , const ready_handler& ready_)
+  {
+    auto key = make_key(addr_, port_);
+    conn_ptr c;
+    {
+      std::unique_lock<std::mutex> l(m_state->lock);
+      if (m_state->closed)
+        throw cool::ng::exception::invalid_state();
+
+      auto& ep = get_endpoint(m_state, key, addr_, port_);
+      if (!ep.idle.empty())
+      {
+        c = ep.idle.back();
+        ep.idle.pop_back();
+        c->leased = true;
+        c->rh = rh_;
+        c->wh = wh_;
+        c->eh = eh_;
+      }
+    }
+
+    if (c)
+    {
+      auto s = c->strm;
+      cool::ng::async::factory::create(
+          m_state->runner
+        , [ready_, s] (const std::shared_ptr<RunnerT>& r_)
+          {
+            ready_(r_, s, cool::ng::error::no_error());
+          }
+      ).run();
+      return;
+    }
+
+    c = std::make_shared<connection>();
+    c->key = key;
+    c->leased = true;
+    c->rh = rh_;
+    c->wh = wh_;
+    c->eh = eh_;
+    c->ready = ready_;
+    open(m_state, c, addr_, port_);
+  }
+
+  /**
+   * Release the acquired stream back to the pool.
+   *
+   * The stream is kept in the pool as idle if it is still connected and the
+   * pool does not already hold the maximum number of idle streams to the same
+   * peer. Otherwise the stream is disconnected. Releasing the stream that
+   * does not belong to the pool or is not acquired has no effect.
+   *
+   * @note The user must not use the stream after it was released.
+   */
+  void release(const stream& s_)
+  {
+    if (!s_)
+      return;
+
+    conn_ptr drop;
+    {
+      std::unique_lock<std::mutex> l(m_state->lock);
+      auto it = m_state->connections.find(s_.name());
+      if (it == m_state->connections.end() || !it->second->leased || !it->second->connected)
+        return;
+
+      auto c = it->second;
+      c->leased = false;
+      c->rh = nullptr;
+      c->wh = nullptr;
+      c->eh = nullptr;
+
+      auto& ep = m_state->endpoints[c->key];
+      if (m_state->closed || ep.idle.size() >= m_state->opts.max_idle)
+      {
+        m_state->connections.erase(it);
+        drop = c;
+      }
+      else
+      {
+        c->since = std::chrono::steady_clock::now();
+        ep.idle.push_back(c);
+      }
+    }
+
+    if (drop)
+      retire(m_state, drop);
+  }
+
+  /**
+   * Set the minimum number of idle streams to keep connected to the remote
+   * peer.
+   *
+   * The pool immediately starts connecting the streams to reach the minimum
+   * and will keep reconnecting them as they are acquired or evicted. The idle
+   * streams below the minimum are not evicted on the idle timeout. Setting
+   * the minimum to 0 stops the pre-connecting.
+   */
+  void reserve(const cool::ng::net::ip::address& addr_, uint16_t port_, std::size_t min_idle_)
+  {
+    auto key = make_key(addr_, port_);
+    {
+      std::unique_lock<std::mutex> l(m_state->lock);
+      if (m_state->closed)
+        throw cool::ng::exception::invalid_state();
+      get_endpoint(m_state, key, addr_, port_).min_idle = min_idle_;
+    }
+    sweep(m_state);
+  }
+
+  /**
+   * Returns the number of idle streams connected to the remote peer.
+   */
+  std::size_t idle(const cool::ng::net::ip::address& addr_, uint16_t port_) const
+  {
+    std::unique_lock<std::mutex> l(m_state->lock);
+    auto it = m_state->endpoints.find(make_key(addr_, port_));
+    return it == m_state->endpoints.end() ? 0 : it->second.idle.size();
+  }
+
+ private:
+  // the timer is constructed in place from these; timer clones share the
+  // implementation and destroying a temporary clone would stop it
+  static cool::ng::async::timer::task_type make_sweep(const state_ptr& st_)
+  {
+    if (st_->opts.idle_timeout.count() <= 0 || st_->opts.buffer_size == 0)
+      throw cool::ng::exception::illegal_argument();
+
+    std::weak_ptr<state> ws = st_;
+    return cool::ng::async::factory::create(
+        st_->runner
+      , [ws] (const std::shared_ptr<RunnerT>&) { sweep(ws); });
+  }
+
+  static std::chrono::milliseconds sweep_period(const options& opts_)
+  {
+    auto period = opts_.idle_timeout / 4;
+    return period < std::chrono::milliseconds(10) ? std::chrono::milliseconds(10) : period;
+  }
+
+  static std::string make_key(const cool::ng::net::ip::address& addr_, uint16_t port_)
+  {
+    std::ostringstream os;
+    os << addr_ << "|" << port_;
+    return os.str();
+  }
+
+  // must be called with state lock held
+  static endpoint& get_endpoint(const state_ptr& st_
+                              , const std::string& key_
+                              , const cool::ng::net::ip::address& addr_
+                              , uint16_t port_)
+  {
+    auto& ep = st_->endpoints[key_];
+    if (ep.port == 0)
+    {
+      ep.addr = addr_;
+      ep.port = port_;
+    }
+    return ep;
+  }
+
+  // must be called with state lock held; the endpoints are gone once the
+  // pool is destroyed, hence the endpoint is looked up rather than created
+  static void warmed(const state_ptr& st_, const std::string& key_)
+  {
+    auto it = st_->endpoints.find(key_);
+    if (it != st_->endpoints.end() && it->second.warming > 0)
+      --it->second.warming;
+  }
+
+  // disconnects the stream, if requested, and drops it from the runner; the
+  // stream may be the caller of pool code and must not be destroyed in place
+  static void retire(const state_ptr& st_, const conn_ptr& c_, bool disconnect_ = true)
+  {
+    if (disconnect_)
+      try { c_->strm.disconnect(); } catch (...) { /* noop */ }
+
+    auto s = c_->strm;
+    try
+    {
+      cool::ng::async::factory::create(
+          st_->runner
+        , [s] (const std::shared_ptr<RunnerT>&) { /* noop */ }
+      ).run();
+    }
+    catch (...)
+    { /* noop */ }
+  }
+
+  // creates new stream and starts connecting it; the stream is registered
+  // before connect so that its handlers can always find it
+  static void open(const state_ptr& st_
+                 , const conn_ptr& c_
+                 , const cool::ng::net::ip::address& addr_
+                 , uint16_t port_)
+  {
+    std::weak_ptr<state> ws = st_;
+    std::weak_ptr<connection> wc = c_;
+
+    stream s(
+        st_->runner
+      , [ws, wc] (const std::shared_ptr<RunnerT>& r_, void*& buf_, std::size_t& size_)
+        {
+          on_read(ws, wc, r_, buf_, size_);
+        }
+      , [ws, wc] (const std::shared_ptr<RunnerT>& r_, const void* buf_, std::size_t size_)
+        {
+          on_write(ws, wc, r_, buf_, size_);
+        }
+      , [ws, wc] (const std::shared_ptr<RunnerT>& r_, detail::oob_event evt_, const std::error_code& err_)
+        {
+          on_event(ws, wc, r_, evt_, err_);
+        }
+      , nullptr
+      , st_->opts.buffer_size);
+
+    {
+      std::unique_lock<std::mutex> l(st_->lock);
+      c_->strm = s;
+      st_->connections[s.name()] = c_;
+    }
+
+    try
+    {
+      s.connect(addr_, port_);
+    }
+    catch (...)
+    {
+      std::unique_lock<std::mutex> l(st_->lock);
+      st_->connections.erase(s.name());
+      if (!c_->leased)
+        warmed(st_, c_->key);
+      throw;
+    }
+  }
+
+  static void on_read(const std::weak_ptr<state>& ws_
+                    , const std::weak_ptr<connection>& wc_
+                    , const std::shared_ptr<RunnerT>& r_
+                    , void*& buf_
+                    , std::size_t& size_)
+  {
+    auto st = ws_.lock();
+    auto c = wc_.lock();
+    if (!st || !c)
+      return;
+
+    read_handler h;
+    {
+      std::unique_lock<std::mutex> l(st->lock);
+      if (c->leased)
+        h = c->rh;
+    }
+    if (h)
+      h(r_, buf_, size_);
+  }
+
+  static void on_write(const std::weak_ptr<state>& ws_
+                     , const std::weak_ptr<connection>& wc_
+                     , const std::shared_ptr<RunnerT>& r_
+                     , const void* buf_
+                     , std::size_t size_)
+  {
+    auto st = ws_.lock();
+    auto c = wc_.lock();
+    if (!st || !c)
+      return;
+
+    write_handler h;
+    {
+      std::unique_lock<std::mutex> l(st->lock);
+      if (c->leased)
+        h = c->wh;
+    }
+    if (h)
+      h(r_, buf_, size_);
+  }
+
+  static void on_event(const std::weak_ptr<state>& ws_
+                     , const std::weak_ptr<connection>& wc_
+                     , const std::shared_ptr<RunnerT>& r_
+                     , detail::oob_event evt_
+                     , const std::error_code& err_)
+  {
+    auto st = ws_.lock();
+    auto c = wc_.lock();
+    if (!st || !c)
+      return;
+
+    ready_handler ready;
+    event_handler eh;
+    stream s;
+    bool removed = false;
+    bool abandoned = false;
+    {
+      std::unique_lock<std::mutex> l(st->lock);
+      s = c->strm;
+
+      switch (evt_)
+      {
+        case detail::oob_event::connect:
+          c->connected = true;
+          if (c->leased)
+          {
+            ready.swap(c->ready);
+          }
+          else
+          {
+            warmed(st, c->key);
+            if (st->closed)
+            {
+              st->connections.erase(s.name());
+              removed = abandoned = true;
+            }
+            else
+            {
+              c->since = std::chrono::steady_clock::now();
+              st->endpoints[c->key].idle.push_back(c);
+            }
+          }
+          break;
+
+        case detail::oob_event::failure:
+        case detail::oob_event::disconnect:
+        {
+          auto ep = st->endpoints.find(c->key);
+          if (c->leased)
+          {
+            if (c->connected)
+              eh = c->eh;
+            else
+              ready.swap(c->ready);
+          }
+          else if (!c->connected)
+          {
+            warmed(st, c->key);
+          }
+          else if (ep != st->endpoints.end())
+          {
+            auto& idle = ep->second.idle;
+            for (auto it = idle.begin(); it != idle.end(); ++it)
+              if (*it == c)
+              {
+                idle.erase(it);
+                break;
+              }
+          }
+          c->connected = false;
+          st->connections.erase(s.name());
+          removed = true;
+          break;
+        }
+
+        default:
+          if (c->leased)
+            eh = c->eh;
+          break;
+      }
+    }
+
+    if (ready)
+    {
+      if (evt_ == detail::oob_event::connect)
+        ready(r_, s, err_);
+      else
+        ready(r_, stream(), err_);
+    }
+    if (eh)
+      eh(r_, evt_, err_);
+    if (removed)
+      retire(st, c, abandoned);
+  }
+
+  // evicts expired idle streams and starts connecting streams needed to
+  // reach the reserved minimum
+  static void sweep(const std::weak_ptr<state>& ws_)
+  {
+    auto st = ws_.lock();
+    if (!st)
+      return;
+
+    // the endpoints may be gone once the lock is released, hence the
+    // addresses of the streams to pre-connect are copied
+    struct target
+    {
+      std::string                       key;
+      cool::ng::net::ip::host_container addr;
+      uint16_t                          port;
+    };
+
+    std::vector<conn_ptr> drop;
+    std::vector<target> warm;
+    {
+      std::unique_lock<std::mutex> l(st->lock);
+      if (st->closed)
+        return;
+
+      auto now = std::chrono::steady_clock::now();
+      for (auto& item : st->endpoints)
+      {
+        auto& ep = item.second;
+        while (ep.idle.size() > ep.min_idle && now - ep.idle.front()->since >= st->opts.idle_timeout)
+        {
+          drop.push_back(ep.idle.front());
+          st->connections.erase(ep.idle.front()->strm.name());
+          ep.idle.pop_front();
+        }
+        for (auto n = ep.idle.size() + ep.warming; n < ep.min_idle; ++n)
+        {
+          ++ep.warming;
+          warm.push_back(target { item.first, ep.addr, ep.port });
+        }
+      }
+    }
+
+    for (auto& c : drop)
+      retire(st, c);
+
+    for (auto& w : warm)
+    {
+      {
+        // the pool destroyed meanwhile dropped its endpoints
+        std::unique_lock<std::mutex> l(st->lock);
+        if (st->closed || st->endpoints.find(w.key) == st->endpoints.end())
+          return;
+      }
+
+      auto c = std::make_shared<connection>();
+      c->key = w.key;
+      try
+      {
+        open(st, c, w.addr, w.port);
+      }
+      catch (...)
+      { /* noop - open() already corrected the warming count */ }
+    }
+  }
+
+ private:
+  state_ptr               m_state;
+  cool::ng::async::timer  m_timer;
+};
+
+} } } } // namespace
+
+#endif
@@ -0,0 +1,178 @@
+/* 
+ * Copyright (c) 2017 Leon Mlakar.
+ * Copyright (c) 2017 Digiverse d.o.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. The
+ * license should be included in the source distribution of the Software;
+ * if not, you may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and licensing terms shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#if !defined(cool_ng_a4075def_f3d4_470c_badc_b00431eabf3a)
+#define      cool_ng_a4075def_f3d4_470c_badc_b00431eabf3a
+
+#include <string>
+#include <memory>
+#include <functional>
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+#include "cool/ng/error.h"
+#include "cool/ng/exception.h"
+#include "cool/ng/ip_address.h"
+#include "cool/ng/async/task.h"
+#include "cool/ng/impl/async/net_resolver.h"
+
+namespace cool { namespace ng { namespace async { namespace net {
+
+/**
+ * Asynchronous host name resolver.
+ *
+ * The resolver translates host names into IP addresses without blocking the
+ * @ref cool::ng::async::runner "runner". The lookups are performed by a small
+ * pool of threads dedicated to the resolver, using the system resolver
+ * (<tt>getaddrinfo</tt>), thus the host names from the local <tt>hosts</tt>
+ * file are resolved as well. The results are reported through a @ref task
+ * submitted to the runner.
+ *
+ * The resolver caches the results, including the failed lookups, for the
+ * configured time to live. The concurrent requests to resolve the same name
+ * share a single lookup.
+ *
+ * @tparam RunnerT <b>RunnerT</b> is the concrete type of the @ref cool::ng::async::runner "runner"
+ *         to be used to schedule calls to the result handler.
+ *
+ * @note Copies of the resolver share the thread pool and the cache.
+ * @note The system resolver does not expose the time to live of the DNS
+ *   records; the resolver caches all results for the configured time.
+ * @note This header is not included by <tt>cool/ng/async.h</tt> and must be
+ *   included explicitly.
+ */
+template <typename RunnerT>
+class resolver
+{
+ public:
+  /**
+   * Type of the handler called with the result of the lookup. The second
+   * parameter contains the resolved addresses, in the order of preference
+   * reported by the system resolver. If the lookup failed, the third
+   * parameter is set to the error code and the list of addresses is empty.
+   */
+  using result_handler = std::function<void(
+      const std::shared_ptr<RunnerT>&
+    , const std::vector<cool::ng::net::ip::host_container>&
+    , const std::error_code&)>;
+
+  /**
+   * Resolver configuration.
+   */
+  struct options
+  {
+    options()
+      : threads(2)
+      , ttl(std::chrono::seconds(60))
+      , negative_ttl(std::chrono::seconds(5))
+    { /* noop */ }
+
+    std::size_t               threads;       //!< Number of lookup threads
+    std::chrono::milliseconds ttl;           //!< Time to keep the resolved addresses in the cache
+    std::chrono::milliseconds negative_ttl;  //!< Time to keep the failed lookups in the cache
+  };
+
+ public:
+  /**
+   * Constructs a new resolver.
+   *
+   * @param r_    weak pointer to @ref cool::ng::async::runner "runner" to use
+   *              to call the result handlers
+   * @param opts_ resolver configuration
+   *
+   * @throw cool::ng::exception::illegal_argument if the number of threads is 0
+   * @throw std::system_error if the lookup threads could not be started
+   */
+  resolver(const std::weak_ptr<RunnerT>& r_, const options& opts_ = options())
+    : m_runner(r_)
+  {
+    if (opts_.threads == 0)
+      throw cool::ng::exception::illegal_argument();
+    m_impl = impl::create_resolver(opts_.threads, opts_.ttl, opts_.negative_ttl);
+  }
+
+  /**
+   * Resolves the host name.
+   *
+   * Calls the result handler from the task submitted to the runner when the
+   * lookup completes, or immediately if the result is in the cache. The
+   * numeric IP addresses are accepted as well and are returned as they are.
+   *
+   * @param name_ host name to resolve
+   * @param h_    handler to call with the result of the lookup
+   *
+   * @note The lookups in progress when the last copy of the resolver is
+   *   destroyed report @c errc::request_aborted.
+   */
+  void resolve(const std::string& name_, const result_handler& h_)
+  {
+    auto r = m_runner;
+    m_impl->lookup(
+        name_
+      , [r, h_] (const std::vector<cool::ng::net::ip::host_container>& hosts_, const std::error_code& err_)
+        {
+          try
+          {
+            cool::ng::async::factory::create(
+                r
+              , [h_, hosts_, err_] (const std::shared_ptr<RunnerT>& r_)
+                {
+                  h_(r_, hosts_, err_);
+                }
+            ).run();
+          }
+          catch (...)
+          { /* noop */ }
+        }
+    );
+  }
+
+  /**
+   * Removes all results from the cache.
+   */
+  void flush()
+  {
+    m_impl->flush();
+  }
+
+  /**
+   * Returns the number of lookups performed by the resolver threads.
+   *
+   * The requests served from the cache and the requests that joined the
+   * lookup already in progress are not counted.
+   */
+  std::size_t lookups() const
+  {
+    return m_impl->lookups();
+  }
+
+ private:
+  std::weak_ptr<RunnerT>                     m_runner;
+  std::shared_ptr<detail::itf::resolver>     m_impl;
+};
+
+} } } } // namespace
+
+#endif
@@ -25,16 +25,21 @@
 #define      cool_ng_f36defb0_dda1_0ce1_b25a_943f5deed23b
 
 #include <string>
+#include <cstddef>
 #include <memory>
 #include <functional>
+#include <chrono>
 #include <cstdint>
+#include <vector>
 
 #include "cool/ng/bases.h"
 #include "cool/ng/ip_address.h"
+#include "cool/ng/local_address.h"
 #include "cool/ng/impl/platform.h"
 
 #include "cool/ng/impl/async/event_sources_types.h"
 #include "cool/ng/impl/async/net_server.h"
+#include "cool/ng/async/net/socket_options.h"
 
 namespace cool { namespace ng {
 
@@ -105,7 +110,9 @@ class server
    *         connection if the factory @em Callable fails to provide @ref stream
    *         in the required state or if it throws. The parameters to the factory
    *         @em Callable, in addition to the shared pointer to server's @ref runner,
-   *         are remote IP address and network port of the new client.
+   *         are remote IP address and network port of the new client. If the
+   *         server was given a pool of @ref runners() "runners", the first
+   *         parameter is the runner assigned to the new connection instead.
    * @param r_  weak pointer to @ref cool::ng::async::runner "runner" to use to
    *            schedule asynchronous notifications for execution.
    * @param addr_ IP address of the network peer to bind to. This may be an
@@ -154,12 +161,200 @@ class server
     m_impl = impl;
     impl->initialize(addr_, port_);
   }
+  /**
+   * Constructs new instance of server listening on the local (Unix domain) socket.
+   *
+   * <b>Template Parameters</b><br>
+   * See the above constructor for details on the template parameters. Since
+   * the clients of the local socket have no network address, the stream
+   * factory will receive the @ref cool::ng::net::ipv4::any "ipv4::any"
+   * address and port 0 as parameters.
+   *
+   * @param r_  weak pointer to @ref cool::ng::async::runner "runner" to use to
+   *            schedule asynchronous notifications for execution.
+   * @param addr_ local address to bind to. If the address is a filesystem
+   *            path, the server will remove the socket file when it is
+   *            destroyed.
+   * @param hc_ read handler to be called from the scheduled task when a new connect
+   *            request has been detected.
+   * @param sf_ stream factory to use to spawn new @ref stream "streams" for
+   *            connected peers
+   * @param he_ error handle to be called should the server detect network errors
+   *
+   * @throw cool::ng::exception::socket_failure if any socket operations failed
+   * @throw cool::ng::exception::illegal_argument if the local address is empty
+   *        or too long
+   * @throw cool::ng::exception::operation_failed with error code @c not_available
+   *        if the platform does not support the local sockets or the requested
+   *        address namespace
+   * @throw cool::ng::exception::runner_not_available if the @ref cool::ng::async::runner
+   *        "runner" specified via parameter @a r_ is no longer available
+   * @throw std::bad_alloc if the internal memory allocation failed
+   */
+  template <typename RunnerT
+          , typename StreamFactoryT
+          , typename ConnectHandlerT
+          , typename ErrorHandlerT = typename detail::types<RunnerT>::error_handler
+  >
+  server(const std::weak_ptr<RunnerT>& r_
+       , const cool::ng::net::local::address& addr_
+       , const StreamFactoryT& sf_
+       , const ConnectHandlerT& hc_
+       , const ErrorHandlerT& he_ = ErrorHandlerT())
+  {
+    using stream_factory  = typename detail::types<RunnerT>::stream_factory;
+    using connect_handler = typename detail::types<RunnerT>::connect_handler;
+    using error_handler   = typename detail::types<RunnerT>::error_handler;
+
+    auto impl = cool::ng::util::shared_new<detail::server<RunnerT>>(
+        r_
+      , static_cast<stream_factory>(sf_)
+      , static_cast<connect_handler>(hc_)
+      , static_cast<error_handler>(he_));
+
+    m_impl = impl;
+    impl->initialize(addr_);
+  }
   /**
    * Starts the @ref server.
    */
   dlldecl void start();
   dlldecl void stop();
   dlldecl const std::string& name() const;
+  /**
+   * Sets the socket options for the accepted connections.
+   *
+   * The options are applied to the sockets of all connections accepted after
+   * this call, before they are handed over to the @ref stream "streams". The
+   * send and receive buffer sizes are also applied to the listening socket,
+   * so that the accepted connections inherit them already at the connection
+   * set up. The options set in @a opts_ are merged with the options set
+   * in previous calls.
+   *
+   * @param opts_ socket options to apply
+   *
+   * @throw cool::ng::exception::socket_failure if the options could not be
+   *        applied to the listening socket
+   * @throw cool::ng::exception::operation_failed with error code @c not_available
+   *        if the platform does not support one of the requested options
+   *
+   * @note If the options cannot be applied to the accepted connection, the
+   *   connection is closed and the error is reported to the error handler.
+   */
+  dlldecl void options(const socket_options& opts_);
+
+  /**
+   * Sets the maximal number of concurrent connections.
+   *
+   * When the number of open connections accepted by this server reaches the
+   * limit, the server stops accepting new connections. The pending
+   * connection requests are left in the listen backlog of the operating
+   * system and are accepted when one of the open connections is closed. A
+   * connection counts as open until the socket of its @ref stream "stream"
+   * is closed, either by the peer, by the @ref stream::disconnect()
+   * "disconnect" or by the destruction of the stream.
+   *
+   * @param max_ maximal number of concurrent connections; 0, the default,
+   *             means no limit
+   *
+   * @throw cool::ng::exception::operation_failed with error code @c not_available
+   *        if the platform does not support connection limits
+   *
+   * @note Lowering the limit below the number of currently open connections
+   *   does not close any connection; the server resumes accepting when the
+   *   number of open connections drops below the new limit.
+   * @note The connection limits are not available on Microsoft Windows.
+   */
+  dlldecl void max_connections(std::size_t max_);
+
+  /**
+   * Returns the number of currently open connections accepted by this server.
+   *
+   * @throw cool::ng::exception::operation_failed with error code @c not_available
+   *        if the platform does not support connection limits
+   */
+  dlldecl std::size_t connections() const;
+
+  /**
+   * Gracefully drains the server.
+   *
+   * Stops accepting new connections and closes the connections accepted by
+   * this server in an orderly way. The connections with no pending write are
+   * closed immediately. The connections with a pending write are closed as
+   * soon as their write queue is empty. Each closed @ref stream "stream"
+   * reports @c oob_event::disconnect to its event handler, as if the peer
+   * closed the connection. When all connections are closed, the server
+   * calls the drain handler from its runner's context.
+   *
+   * The drained server is stopped and may be @ref start() "started" again
+   * after the drain handler was called.
+   *
+   * @param handler_ handler to call when all connections are closed
+   * @param grace_   maximal time to wait for the pending writes to complete;
+   *                 when it elapses, the remaining connections are closed
+   *                 regardless of their pending writes. The value of 0, the
+   *                 default, means to wait indefinitely.
+   *
+   * @throw cool::ng::exception::invalid_state if the server is already draining
+   * @throw cool::ng::exception::operation_failed with error code @c not_available
+   *        if the platform does not support draining
+   *
+   * @note The server can only tell whether a write is pending. The
+   *   applications that write their responses asynchronously should stop
+   *   taking new requests and complete the responses in progress before
+   *   draining the server.
+   */
+  dlldecl void drain(const std::function<void()>& handler_
+                   , const std::chrono::milliseconds& grace_ = std::chrono::milliseconds(0));
+
+  /**
+   * Sets the pool of runners to assign to the accepted connections.
+   *
+   * Instead of the server's own @ref cool::ng::async::runner "runner", the
+   * stream factory receives the runner from the pool, selected by the
+   * assignment strategy, and is expected to create the @ref stream "stream"
+   * on it. This spreads the handling of the connections across several
+   * runners without the dispatching logic in the stream factory. The
+   * available strategies are:
+   *
+   *   Strategy                   | Selected runner
+   *   ---------------------------|------------------------------------------------
+   *   assignment::round_robin    | The runners from the pool in turn
+   *   assignment::least_loaded   | The runner with the lowest @ref runner::queue_depth() "queue depth"
+   *   assignment::peer_hash      | The runner selected by the hash of the peer's IP address
+   *   assignment::incoming_cpu   | The runner @ref runner::affinity() "pinned" to the CPU that received the connection
+   *
+   * The runners that are no longer available are skipped. The connect
+   * handler and the error handler are still called with the server's own
+   * runner.
+   *
+   * @tparam RunnerT the type of the runners in the pool; must be the same as
+   *         the runner type the server was constructed with
+   * @param pool_     runners to assign to the accepted connections. The empty
+   *                  pool restores the use of the server's own runner.
+   * @param strategy_ assignment strategy
+   *
+   * @throw cool::ng::exception::illegal_argument if the runner type does not
+   *        match the runner type of the server
+   *
+   * @note The peers connecting via the local socket have no IP address and
+   *   the @c peer_hash strategy assigns all of them the same runner.
+   * @note The @c incoming_cpu strategy keeps the connection on the CPU that
+   *   handles its network queue. It falls back to round robin when the
+   *   platform does not report the CPU or no runner is pinned to it.
+   */
+  template <typename RunnerT>
+  void runners(const std::vector<std::weak_ptr<RunnerT>>& pool_
+             , assignment strategy_ = assignment::round_robin)
+  {
+    if (!m_impl)
+      throw cool::ng::exception::empty_object();
+
+    auto impl = std::dynamic_pointer_cast<detail::server<RunnerT>>(m_impl);
+    if (!impl)
+      throw cool::ng::exception::illegal_argument();
+    impl->runners(pool_, strategy_);
+  }
 
   /**
    * Empty server predicate.
@@ -173,7 +368,7 @@ class server
   dlldecl explicit operator bool() const;
 
  private:
-  std::shared_ptr<async::detail::itf::startable> m_impl;
+  std::shared_ptr<detail::itf::server> m_impl;
 };
 
 } } } } // namespace
@@ -0,0 +1,240 @@
+/* 
+ * Copyright (c) 2017 Leon Mlakar.
+ * Copyright (c) 2017 Digiverse d.o.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. The
+ * license should be included in the source distribution of the Software;
+ * if not, you may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and licensing terms shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#if !defined(cool_ng_2c4e7a91_d35b_4f08_a6c1_8e0b97f4d216)
+#define      cool_ng_2c4e7a91_d35b_4f08_a6c1_8e0b97f4d216
+
+#include <chrono>
+#include <cstdint>
+
+namespace cool { namespace ng { namespace async { namespace net {
+
+/**
+ * Socket options of the network @ref stream "streams".
+ *
+ * The socket options are set using the chainable setter methods. Only the
+ * options that were explicitly set are applied to the socket; the options that
+ * were not set remain at the system defaults.
+ * ~~~
+ *   auto opts = socket_options().no_delay(true).receive_buffer(256 * 1024);
+ *   my_stream.options(opts);
+ * ~~~
+ * The options can be specified for the @ref stream, in which case they are
+ * applied to the stream's socket immediately, if the stream is connected, and
+ * at each subsequent connect, or for the @ref server, in which case they
+ * are applied to each accepted connection.
+ *
+ * @note Some options are not available on all platforms. The attempt to apply
+ *   such option will throw @ref cool::ng::exception::operation_failed
+ *   "operation_failed" with error code @c not_available.
+ * @note TCP specific options are not applied to the local (Unix domain) sockets.
+ */
+class socket_options
+{
+ public:
+  /**
+   * Identifiers of the options.
+   */
+  enum class option : unsigned int {
+    no_delay       = 0x0001,  //!< @c TCP_NODELAY
+    send_buffer    = 0x0002,  //!< @c SO_SNDBUF
+    receive_buffer = 0x0004,  //!< @c SO_RCVBUF
+    quick_ack      = 0x0008,  //!< @c TCP_QUICKACK, Linux only
+    cork           = 0x0010,  //!< @c TCP_CORK on Linux, @c TCP_NOPUSH on BSD and OSX
+    keep_alive     = 0x0020,  //!< @c SO_KEEPALIVE with optional probe parameters
+    busy_poll      = 0x0040   //!< @c SO_BUSY_POLL, Linux only
+  };
+
+ public:
+  socket_options()
+    : m_set(0)
+    , m_no_delay(false)
+    , m_send_buffer(0)
+    , m_receive_buffer(0)
+    , m_quick_ack(false)
+    , m_cork(false)
+    , m_keep_alive(false)
+    , m_ka_idle(0)
+    , m_ka_interval(0)
+    , m_ka_count(0)
+    , m_busy_poll(0)
+  { /* noop */ }
+
+  /**
+   * Enables or disables the Nagle's algorithm. Setting @a enable_ to @c true
+   * disables coalescing of small writes.
+   */
+  socket_options& no_delay(bool enable_)
+  {
+    m_no_delay = enable_;
+    return mark(option::no_delay);
+  }
+  /**
+   * Sets the size of the socket's send buffer, in bytes.
+   */
+  socket_options& send_buffer(int size_)
+  {
+    m_send_buffer = size_;
+    return mark(option::send_buffer);
+  }
+  /**
+   * Sets the size of the socket's receive buffer, in bytes.
+   *
+   * @note For the best effect set the receive buffer size before the connection
+   *   is established, either via the @ref server or on the not yet connected
+   *   @ref stream, since it affects the TCP window scaling negotiated at the
+   *   connection set up.
+   */
+  socket_options& receive_buffer(int size_)
+  {
+    m_receive_buffer = size_;
+    return mark(option::receive_buffer);
+  }
+  /**
+   * Enables or disables the quick acknowledgments.
+   *
+   * @note The quick acknowledgment mode is not permanent and the kernel may
+   *   leave it on its own. The option may need to be set again, for instance
+   *   after each read.
+   */
+  socket_options& quick_ack(bool enable_)
+  {
+    m_quick_ack = enable_;
+    return mark(option::quick_ack);
+  }
+  /**
+   * Enables or disables corking. While corked the partial frames are not
+   * sent; uncorking flushes them.
+   */
+  socket_options& cork(bool enable_)
+  {
+    m_cork = enable_;
+    return mark(option::cork);
+  }
+  /**
+   * Enables or disables the keep-alive probes.
+   *
+   * @param enable_   enable or disable keep-alive probes
+   * @param idle_     idle time before the first probe is sent; 0 leaves the system default
+   * @param interval_ interval between the probes; 0 leaves the system default
+   * @param count_    number of unanswered probes before the connection is
+   *                  dropped; 0 leaves the system default
+   */
+  socket_options& keep_alive(bool enable_
+                           , const std::chrono::seconds& idle_ = std::chrono::seconds(0)
+                           , const std::chrono::seconds& interval_ = std::chrono::seconds(0)
+                           , int count_ = 0)
+  {
+    m_keep_alive = enable_;
+    m_ka_idle = static_cast<int>(idle_.count());
+    m_ka_interval = static_cast<int>(interval_.count());
+    m_ka_count = count_;
+    return mark(option::keep_alive);
+  }
+  /**
+   * Sets the time the kernel busy polls the device queue on blocking reads
+   * when there is no data.
+   */
+  socket_options& busy_poll(const std::chrono::microseconds& time_)
+  {
+    m_busy_poll = static_cast<int>(time_.count());
+    return mark(option::busy_poll);
+  }
+
+  /**
+   * Merges the options set in @a other_ into this set of options, overriding
+   * the options set in both.
+   */
+  socket_options& merge(const socket_options& other_)
+  {
+    auto set = m_set | other_.m_set;
+    auto mine = m_set & ~other_.m_set;
+    auto aux = other_;
+    if (mine & static_cast<unsigned int>(option::no_delay))       aux.m_no_delay = m_no_delay;
+    if (mine & static_cast<unsigned int>(option::send_buffer))    aux.m_send_buffer = m_send_buffer;
+    if (mine & static_cast<unsigned int>(option::receive_buffer)) aux.m_receive_buffer = m_receive_buffer;
+    if (mine & static_cast<unsigned int>(option::quick_ack))      aux.m_quick_ack = m_quick_ack;
+    if (mine & static_cast<unsigned int>(option::cork))           aux.m_cork = m_cork;
+    if (mine & static_cast<unsigned int>(option::keep_alive))
+    {
+      aux.m_keep_alive = m_keep_alive;
+      aux.m_ka_idle = m_ka_idle;
+      aux.m_ka_interval = m_ka_interval;
+      aux.m_ka_count = m_ka_count;
+    }
+    if (mine & static_cast<unsigned int>(option::busy_poll))      aux.m_busy_poll = m_busy_poll;
+    *this = aux;
+    m_set = set;
+    return *this;
+  }
+
+  /**
+   * Returns true if the option @a opt_ was set.
+   */
+  bool is_set(option opt_) const
+  {
+    return (m_set & static_cast<unsigned int>(opt_)) != 0;
+  }
+  /**
+   * Returns true if no option was set.
+   */
+  bool empty() const
+  {
+    return m_set == 0;
+  }
+
+  bool no_delay() const       { return m_no_delay; }
+  int send_buffer() const     { return m_send_buffer; }
+  int receive_buffer() const  { return m_receive_buffer; }
+  bool quick_ack() const      { return m_quick_ack; }
+  bool cork() const           { return m_cork; }
+  bool keep_alive() const     { return m_keep_alive; }
+  int keep_alive_idle() const      { return m_ka_idle; }
+  int keep_alive_interval() const  { return m_ka_interval; }
+  int keep_alive_count() const     { return m_ka_count; }
+  int busy_poll() const       { return m_busy_poll; }
+
+ private:
+  socket_options& mark(option opt_)
+  {
+    m_set |= static_cast<unsigned int>(opt_);
+    return *this;
+  }
+
+ private:
+  unsigned int m_set;
+  bool m_no_delay;
+  int  m_send_buffer;
+  int  m_receive_buffer;
+  bool m_quick_ack;
+  bool m_cork;
+  bool m_keep_alive;
+  int  m_ka_idle;       // seconds
+  int  m_ka_interval;   // seconds
+  int  m_ka_count;
+  int  m_busy_poll;     // microseconds
+};
+
+} } } } // namespace
+
+#endif
@@ -28,13 +28,18 @@
 #include <memory>
 #include <functional>
 #include <cstdint>
+#include <vector>
+#include <chrono>
 
 #include "cool/ng/bases.h"
+#include "cool/ng/exception.h"
 #include "cool/ng/ip_address.h"
+#include "cool/ng/local_address.h"
 #include "cool/ng/impl/platform.h"
 
 #include "cool/ng/impl/async/event_sources_types.h"
 #include "cool/ng/impl/async/net_stream.h"
+#include "cool/ng/async/net/socket_options.h"
 
 namespace cool { namespace ng {
 
@@ -45,6 +50,116 @@ namespace impl {
 class server;
 
 } // namespace impl
+
+/**
+ * Immutable, reference counted data buffer.
+ *
+ * The payload is intended for the fan-out writes where the same data is to be
+ * sent to many @ref stream "streams". The data is copied into the payload
+ * exactly once, at the payload construction, and is never modified afterwards.
+ * Each @ref stream::write(const payload&) "write" of the payload only takes
+ * another reference to the shared data, which is released when the write
+ * operation on that stream completes. The memory is thus released when the
+ * last of the streams completes its write operation and the last user copy
+ * of the payload is destroyed.
+ *
+ * @note Payload objects created via copy construction or copy assignment
+ *   are clones and refer to the same data buffer.
+ * @see broadcast()
+ */
+class payload
+{
+ public:
+  /**
+   * Constructs an empty payload.
+   */
+  payload() { /* noop */ }
+  /**
+   * Constructs a payload with the copy of the specified data.
+   *
+   * @param data_ pointer to the data to copy into the payload
+   * @param size_ number of bytes to copy
+   */
+  payload(const void* data_, std::size_t size_)
+    : m_data(std::make_shared<const std::vector<uint8_t>>(
+          static_cast<const uint8_t*>(data_)
+        , static_cast<const uint8_t*>(data_) + size_))
+  { /* noop */ }
+  /**
+   * Constructs a payload by taking over the contents of the vector.
+   *
+   * @param data_ vector whose contents are moved into the payload
+   */
+  explicit payload(std::vector<uint8_t>&& data_)
+    : m_data(std::make_shared<const std::vector<uint8_t>>(std::move(data_)))
+  { /* noop */ }
+
+  /**
+   * Returns pointer to the payload data, or @c nullptr if payload is empty.
+   */
+  const void* data() const
+  {
+    return m_data ? m_data->data() : nullptr;
+  }
+  /**
+   * Returns the size of the payload data, in bytes.
+   */
+  std::size_t size() const
+  {
+    return m_data ? m_data->size() : 0;
+  }
+  /**
+   * Returns the number of payload objects, including those held by the
+   * pending write operations, that share the same data buffer.
+   */
+  long use_count() const
+  {
+    return m_data.use_count();
+  }
+  /**
+   * Empty payload predicate.
+   *
+   * @return true if the payload holds data, false if empty.
+   */
+  explicit operator bool() const
+  {
+    return !!m_data;
+  }
+
+ private:
+  std::shared_ptr<const std::vector<uint8_t>> m_data;
+};
+
+/**
+ * Per-stream timeouts.
+ *
+ * Each timeout is specified in milliseconds; the value of zero disables the
+ * respective timeout. The timeouts are checked with a granularity of about
+ * ten milliseconds.
+ *
+ *  Timeout       | Description
+ *  --------------|------------
+ *  @c connect     | the maximal time the connect operation may take before it is aborted
+ *  @c read_idle   | the maximal time the connected stream may go without receiving any data
+ *  @c write_stall | the maximal time the pending write operation may go without any progress
+ *
+ * @see stream::set_timeouts()
+ */
+struct timeouts
+{
+  timeouts() : connect(0), read_idle(0), write_stall(0)
+  { /* noop */ }
+  timeouts(const std::chrono::milliseconds& connect_
+         , const std::chrono::milliseconds& read_idle_
+         , const std::chrono::milliseconds& write_stall_)
+      : connect(connect_), read_idle(read_idle_), write_stall(write_stall_)
+  { /* noop */ }
+
+  std::chrono::milliseconds connect;
+  std::chrono::milliseconds read_idle;
+  std::chrono::milliseconds write_stall;
+};
+
 /**
  * Connection-based network input/output stream.
  *
@@ -125,8 +240,9 @@ class stream
    *          Value                         | Description
    *          ------------------------------|------------
    *          detail::oob_event::connect    | The stream successfully connected
-   *          detail::oob_event::failure    | The stream failed to connect to network peer
+   *          detail::oob_event::failure    | The stream failed to connect to network peer, or the write to the connected peer failed
    *          detail::oob_event::disconnect | The network peer closed the connection
+   *          detail::oob_event::timeout    | The read idle or write stall timeout expired, see @ref set_timeouts()
    *
    * @param r_  weak pointer to @ref cool::ng::async::runner "runner" to use to
    *            schedule asynchronous notifications for execution.
@@ -232,13 +348,95 @@ class stream
     m_impl = impl;
     impl->initialize(addr_, port_, buf_, sz_);
   }
+  /**
+   * Constructs a new instance of asynchronous connection-oriented
+   * input/output stream and connects it to the specified local (Unix domain)
+   * socket.
+   *
+   * <b>Template Parameters</b><br>
+   * See the first constructor for details on the template parameters.
+   *
+   * @param r_  weak pointer to @ref cool::ng::async::runner "runner" to use to
+   *            schedule asynchronous notifications for execution.
+   * @param addr_ local address of the peer to connect to
+   * @param hr_ read handler to be called from the scheduled task when data has
+   *            been read from the connection
+   * @param hw_ write handler to be called from the scheduled task when the @ref
+   *            write operation has completed
+   * @param he_ event handler to be called from the scheduled tash when an
+   *            stream related event occurs
+   * @param buf_ data optional data buffer to be used to read received data
+   *            into - if set to @c nullptr the stream will allocate
+   *            its own buffer internally
+   * @param sz_ size of the user provided buffer or, if stream is to allocate
+   *            buffer internally, the size of the buffer to allocate
+   *
+   * @throw cool::ng::exception::socket_failure if any socket operations failed
+   * @throw cool::ng::exception::illegal_argument if the local address is empty
+   *        or too long
+   * @throw cool::ng::exception::operation_failed with error code @c not_available
+   *        if the platform does not support the local sockets or the requested
+   *        address namespace
+   * @throw cool::ng::exception::runner_not_available if the @ref cool::ng::async::runner
+   *        "runner" specified via parameter @a r_ is no longer available
+   * @throw std::bad_alloc if the internal memory allocation failed
+   */
+  template <typename RunnerT, typename ReadHandlerT, typename WriteHandlerT, typename OobHandlerT>
+  stream(const std::weak_ptr<RunnerT>& r_
+       , const cool::ng::net::local::address& addr_
+       , const ReadHandlerT& hr_
+       , const WriteHandlerT& hw_
+       , const OobHandlerT& he_
+       , void* buf_ = nullptr
+       , std::size_t sz_ = 16384)
+  {
+    using read_handler  = typename detail::types<RunnerT>::read_handler;
+    using write_handler = typename detail::types<RunnerT>::write_handler;
+    using event_handler = typename detail::types<RunnerT>::event_handler;
+
+    auto impl = cool::ng::util::shared_new<detail::stream<RunnerT>>(
+        r_
+      , static_cast<read_handler>(hr_)
+      , static_cast<write_handler>(hw_)
+      , static_cast<event_handler>(he_));
+
+    m_impl = impl;
+    impl->initialize(addr_, buf_, sz_);
+  }
 
   dlldecl const std::string& name() const;
 
   /**
    * Send data to the connected peer.
+   *
+   * The stream does not copy the data and the data must remain valid until the
+   * stream reports the completion of write via write handler. Only one such
+   * write can be pending at any time.
+   *
+   * @throw cool::ng::exception::invalid_state if the stream is not connected.
+   * @throw cool::ng::exception::operation_failed with error code
+   *   @c resource_busy if the previous write is not yet completed.
    */
   dlldecl void write(const void* data_, std::size_t size_);
+  /**
+   * Send payload to the connected peer.
+   *
+   * Unlike the write of the raw data, the payload writes are queued by the
+   * stream and are sent to the peer in the order of the calls to this method.
+   * The stream keeps the reference to the payload until its write completes
+   * and then reports the completion via the write handler, with the payload's
+   * data address and size as parameters.
+   *
+   * @param data_ payload to send
+   *
+   * @throw cool::ng::exception::invalid_state if the stream is not connected.
+   * @throw cool::ng::exception::illegal_argument if the payload is empty.
+   *
+   * @note The raw data @ref write(const void*, std::size_t) "write" will fail
+   *   with @c resource_busy error while there are queued payload writes.
+   * @see broadcast()
+   */
+  dlldecl void write(const payload& data_);
 
   /**
    * Connects the unconnected stream to the remote peer.
@@ -257,6 +455,20 @@ class stream
    * @throw cool::ng::exception::invalid_state if the stream is not disconnected.
    */
   dlldecl void connect(const cool::ng::net::ip::address& addr_, uint16_t port_);
+  /**
+   * Connects the unconnected stream to the peer listening on the local
+   * (Unix domain) socket.
+   *
+   * @param addr_ local address of the peer to connect to.
+   *
+   * @throw cool::ng::exception::invalid_state if the stream is not disconnected.
+   * @throw cool::ng::exception::illegal_argument if the local address is empty
+   *        or too long
+   * @throw cool::ng::exception::operation_failed with error code @c not_available
+   *        if the platform does not support the local sockets or the requested
+   *        address namespace
+   */
+  dlldecl void connect(const cool::ng::net::local::address& addr_);
 
   /**
    * Disconnects the connected stream from the remote peer.
@@ -267,6 +479,58 @@ class stream
    */
   dlldecl void disconnect();
 
+  /**
+   * Sets the socket options of the stream.
+   *
+   * If the stream is connected the options are applied to its socket
+   * immediately. The options are also remembered and applied to the
+   * socket at each subsequent connect. The options set in @a opts_ are merged
+   * with the options set in previous calls.
+   *
+   * @param opts_ socket options to apply
+   *
+   * @throw cool::ng::exception::socket_failure if the options could not be
+   *        applied to the connected socket
+   * @throw cool::ng::exception::operation_failed with error code @c not_available
+   *        if the platform does not support one of the requested options
+   *
+   * @note To affect the connection set up, such as the TCP window scaling
+   *   which depends on the receive buffer size, set the options on the not
+   *   yet connected stream.
+   */
+  dlldecl void options(const socket_options& opts_);
+
+  /**
+   * Sets the timeouts of the stream.
+   *
+   * The connect timeout applies to the subsequent @ref connect() calls. If
+   * the connection is not established in time, the connect is aborted and
+   * the event handler is called with @c oob_event::failure and error code
+   * @c errc::timed_out.
+   *
+   * The read idle and the write stall timeouts apply to the connected stream
+   * and take effect immediately. When either expires, the event handler is
+   * called with @c oob_event::timeout and error code @c errc::read_idle or
+   * @c errc::write_stalled, respectively. The stream remains connected and
+   * it is up to the application to decide whether to @ref disconnect() it.
+   * The read idle timeout is reported once per idle period; it is re-armed
+   * when the data is received. The write stall timeout is reported once
+   * per stall and is re-armed when the write makes progress.
+   *
+   * @param t_ timeouts to use; the zero values disable respective timeouts
+   *
+   * @throw cool::ng::exception::operation_failed with error code @c not_available
+   *        if any of the timeouts is set and the platform does not support
+   *        stream timeouts
+   *
+   * @note The @c oob_event::timeout event is new with the stream timeouts. It
+   *   is only reported to the streams with the read idle or the write stall
+   *   timeout set, but the event handlers that switch over all events must
+   *   handle it.
+   * @note The stream timeouts are not available on Microsoft Windows.
+   */
+  dlldecl void set_timeouts(const timeouts& t_);
+
   /**
    * Empty stream predicate.
    *
@@ -283,6 +547,47 @@ class stream
   std::shared_ptr<detail::itf::connected_writable> m_impl;
 };
 
+/**
+ * Queue the payload for write on a range of streams.
+ *
+ * Fan-out helper that queues the same @ref payload on every @ref stream in
+ * the range <tt>[first_, last_)</tt>. The payload data is shared among all
+ * streams and is held in memory only once.
+ *
+ * @tparam InputIteratorT input iterator type that dereferences to @ref stream
+ *
+ * @param data_ payload to send
+ * @param first_ the beginning of the range of streams
+ * @param last_ the end of the range of streams
+ *
+ * @return the number of streams the payload was queued on
+ *
+ * @throw any exception other than those derived from
+ *   cool::ng::exception::base, such as @c std::bad_alloc, is propagated
+ *   to the caller and the remaining streams are not written to
+ *
+ * @note Streams that fail to accept the payload with an exception derived
+ *   from cool::ng::exception::base, for instance because they are empty or
+ *   not connected, are skipped and do not prevent the payload from being
+ *   queued on the remaining streams.
+ */
+template <typename InputIteratorT>
+std::size_t broadcast(const payload& data_, InputIteratorT first_, InputIteratorT last_)
+{
+  std::size_t count = 0;
+  for ( ; first_ != last_; ++first_)
+  {
+    try
+    {
+      first_->write(data_);
+      ++count;
+    }
+    catch (const cool::ng::exception::base&)
+    { /* noop - the stream failure only affects this stream */ }
+  }
+  return count;
+}
+
 } } } } // namespace
 
 #endif
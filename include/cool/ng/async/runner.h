@@ -24,8 +24,11 @@
 #if !defined(cool_ng_c5876e46_c998_4b2f_9c82_7cf2076f24ac)
 #define      cool_ng_c5876e46_c998_4b2f_9c82_7cf2076f24ac
 
+#include <chrono>
+#include <cstddef>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "cool/ng/impl/platform.h"
 #include "cool/ng/exception.h"
@@ -60,7 +63,205 @@ enum class RunPolicy {
   /**
    * Concurrent scheduling policy where runner may execute several tasks in parallel.
    */
-  CONCURRENT
+  CONCURRENT,
+  /**
+   * Sequential scheduling policy where runner executes the task with the
+   * earliest @ref deadline first. The tasks without the deadline are
+   * executed after all tasks with the deadline, in submission order.
+   */
+  EARLIEST_DEADLINE,
+  /**
+   * Sequential scheduling policy where runner has a dedicated thread that
+   * spins on the task queue for the @ref runner::spin_period() "spin period"
+   * after the last task before it parks. The tasks submitted while the
+   * thread spins start without the wakeup latency of the thread pool, at
+   * the cost of a CPU core. The event sources of the runner still deliver
+   * their events through the thread pool; for the sockets combine this
+   * policy with the @c busy_poll socket option.
+   */
+  BUSY_POLL,
+  /**
+   * Sequential scheduling policy where runner has no threads of its own and
+   * executes the tasks only when its owner calls @ref runner::run_one(),
+   * @ref runner::poll() or @ref runner::run_until_idle(). The tasks execute
+   * on the calling thread, which allows embedding the runner into another
+   * event loop. The event sources of the runner still deliver their events
+   * through the thread pool.
+   */
+  MANUAL
+};
+
+/**
+ * Task scheduling priorities for @ref cool::ng::async::runner "runner".
+ *
+ * The priority of the runner determines the order in which the runners
+ * compete for the worker threads. The runners with higher priority get their
+ * tasks executed first while the runners with lower priority wait, but never
+ * indefinitely; the platform bounds the time a runner with lower priority
+ * may be starved by the runners with higher priority.
+ *
+ * Like the RunPolicy, the priority is only indicative and the platforms may
+ * map several priorities onto the same level.
+ */
+enum class RunPriority {
+  /**
+   * Priority for latency critical tasks.
+   */
+  HIGH,
+  /**
+   * Priority of regular runners.
+   */
+  DEFAULT,
+  /**
+   * Priority for tasks that can wait for the tasks with default priority.
+   */
+  LOW,
+  /**
+   * The lowest priority, for housekeeping tasks.
+   */
+  BACKGROUND
+};
+
+/**
+ * Deadline of the tasks submitted from the current thread.
+ *
+ * While the deadline object exists, the @ref task "tasks" submitted from the
+ * current thread via @ref task::run() "run()" carry its deadline. The
+ * runners with the RunPolicy::EARLIEST_DEADLINE policy execute the tasks
+ * with the earlier deadline first and may @ref runner::shed_expired() "shed"
+ * the tasks whose deadline has passed before they started. The runners with
+ * other policies ignore the deadline.
+ *
+ * The deadline propagates: the tasks submitted from a task executing on the
+ * runner with the EARLIEST_DEADLINE policy inherit its deadline, unless a
+ * new deadline object is created. The deadline objects nest; destroying the
+ * deadline object restores the previous deadline of the thread.
+ *
+ * @code
+ *   {
+ *     deadline d(std::chrono::milliseconds(50));
+ *     handle_request.run(req);
+ *   }
+ * @endcode
+ */
+class deadline
+{
+ public:
+  using clock = std::chrono::steady_clock;
+
+ public:
+  deadline(const deadline&) = delete;
+  deadline& operator=(const deadline&) = delete;
+  /**
+   * Set the absolute deadline for the current thread.
+   */
+  dlldecl explicit deadline(const clock::time_point& when_);
+  /**
+   * Set the deadline relative to now for the current thread.
+   */
+  dlldecl explicit deadline(const clock::duration& timeout_);
+  /**
+   * Restore the previous deadline of the current thread.
+   */
+  dlldecl ~deadline();
+  /**
+   * Return the current deadline of the current thread, or
+   * <tt>clock::time_point::max()</tt> if the thread has no deadline.
+   */
+  dlldecl static clock::time_point current();
+
+ private:
+  friend class impl::executor;
+  static void set(const clock::time_point& when_);
+
+ private:
+  clock::time_point m_previous;
+};
+
+/**
+ * Priority of the tasks submitted from the current thread.
+ *
+ * While the task_priority object exists, the @ref task "tasks" submitted
+ * from the current thread via @ref task::run() "run()" carry its priority.
+ * The sequential runners keep a lane for each priority and execute the
+ * waiting tasks from the lane with higher priority first, either strictly
+ * or @ref runner::weighted_lanes() "weighted". The tasks submitted without
+ * the task_priority object have the RunPriority::DEFAULT priority. All
+ * steps of a compound task keep the priority of its run() call.
+ *
+ * The runners with the concurrent or the earliest deadline first
+ * RunPolicy ignore the task priority.
+ *
+ * @note The runners on Microsoft Windows ignore the task priority.
+ *
+ * @code
+ *   {
+ *     task_priority p(RunPriority::HIGH);
+ *     health_check.run();
+ *   }
+ * @endcode
+ */
+class task_priority
+{
+ public:
+  task_priority(const task_priority&) = delete;
+  task_priority& operator=(const task_priority&) = delete;
+  /**
+   * Set the priority for the current thread.
+   */
+  dlldecl explicit task_priority(RunPriority priority_);
+  /**
+   * Restore the previous priority of the current thread.
+   */
+  dlldecl ~task_priority();
+  /**
+   * Return the current task priority of the current thread.
+   */
+  dlldecl static RunPriority current();
+
+ private:
+  RunPriority m_previous;
+};
+
+/**
+ * Policies for the @ref runner with the limited @ref runner::capacity()
+ * "capacity" of its task queue, applied when a new @ref task is submitted
+ * while the queue is full.
+ */
+enum class OverflowPolicy {
+  /**
+   * Reject the new task; @ref task::run() "run()" returns @c false.
+   */
+  REJECT,
+  /**
+   * Block the submitting thread until the queue has room for the new task.
+   * Only the application's own threads are blocked. The tasks submitted
+   * from the tasks and event handlers of any runner, from the threads of
+   * the @ref runner::worker_pool() "worker pool", and to the runner with the
+   * RunPolicy::MANUAL policy are queued over the capacity instead, as the
+   * blocked thread could be the one the full runner needs to make room.
+   */
+  BLOCK,
+  /**
+   * Accept the new task and discard the oldest task, in the order of
+   * submission, that was submitted via @ref task::run() "run()" and did not
+   * start to execute yet. The continuations of the running tasks are never
+   * discarded; if there is no task to discard, the new task is rejected.
+   * The discarded task is not executed but reports the
+   * cool::ng::exception::operation_failed exception with
+   * @c errc::request_rejected through its exception reporter, if any.
+   *
+   * @note The runner that executes the tasks concurrently rejects the new
+   *   task instead.
+   */
+  DROP_OLDEST,
+  /**
+   * Execute the new task immediately on the submitting thread. On the
+   * runner that executes the tasks sequentially the new task is serialized
+   * with the runner's other tasks, thus the submitting thread may first
+   * wait for the runner to complete the tasks it is currently executing.
+   */
+  CALLER_RUNS
 };
 
 /**
@@ -103,14 +304,20 @@ class runner
    * scheduling policy.
    *
    * @param policy_ optional parameter, set to RunPolicy::SEQUENTIAL by default.
+   * @param priority_ optional parameter, set to RunPriority::DEFAULT by default.
    *
    * @exception cool::exception::create_failure thrown if a new instance cannot
    *   be created.
+   * @exception cool::ng::exception::operation_failed if the platform does not
+   *   support the scheduling policy
    *
    * @note The runner object is created in started state and is immediately
    *   capable of executing tasks.
+   * @note The RunPolicy::EARLIEST_DEADLINE, RunPolicy::BUSY_POLL and
+   *   RunPolicy::MANUAL policies are not available on Microsoft Windows.
    */
-  dlldecl runner(RunPolicy policy_ = RunPolicy::SEQUENTIAL);
+  dlldecl runner(RunPolicy policy_ = RunPolicy::SEQUENTIAL
+               , RunPriority priority_ = RunPriority::DEFAULT);
 
   /**
    * Copy constructor.
@@ -150,52 +357,232 @@ class runner
    */
   dlldecl const std::string& name() const;
   /**
-   * Return the task queue implementation.
+   * Return the scheduling priority of this runner.
+   */
+  dlldecl RunPriority priority() const;
+  /**
+   * Pin this runner to the set of CPUs.
    *
-   * Returns a reference to the internal task queue implementation. Portable
-   * applications should avoid using the internal implementation directly.
+   * The tasks of the pinned runner are executed only on the listed CPUs,
+   * regardless of the thread that executes them. Pinning the runner to the
+   * CPUs of a single NUMA node, as returned by numa_cpus(), keeps its tasks
+   * and, with the first-touch allocation policy of the kernel, also the
+   * memory they allocate local to that node.
+   *
+   * @param cpus_ the numbers of the CPUs; the empty set removes the pinning
+   *
+   * @exception cool::ng::exception::illegal_argument if a CPU number is out
+   *   of range
+   * @exception cool::ng::exception::operation_failed if the platform does not
+   *   support CPU affinity
+   *
+   * @note CPU affinity is only supported on Linux.
    */
-  const std::shared_ptr<impl::executor>& impl() const;
-
- private:
-  std::shared_ptr<impl::executor> m_impl;
-};
-
-
-#if 0
-
-
+  dlldecl void affinity(const std::vector<unsigned int>& cpus_);
+  /**
+   * Return the set of CPUs this runner is pinned to.
+   *
+   * Returns the empty set if the runner is not pinned.
+   */
+  dlldecl std::vector<unsigned int> affinity() const;
+  /**
+   * Return the number of tasks waiting in the task queue.
+   *
+   * Counts the @ref task "tasks" submitted to this runner that did not start
+   * to execute yet. The returned value is only a snapshot and may change
+   * as soon as it is returned; it is meant for load balancing decisions
+   * rather than for synchronization.
+   */
+  dlldecl std::size_t queue_depth() const;
+  /**
+   * Limit the number of tasks waiting in the task queue.
+   *
+   * Once the @ref queue_depth() "queue depth" reaches the capacity, the new
+   * tasks submitted to this runner are treated as set by the overflow
+   * policy. The limit only applies to the new tasks submitted via
+   * @ref task::run() "run()"; the continuations of the tasks already
+   * running, such as the next steps of the compound tasks, are always
+   * accepted.
+   *
+   * @param capacity_ the maximum number of waiting tasks; 0 removes the limit
+   * @param policy_   the policy applied when the queue is full
+   *
+   * @exception cool::ng::exception::operation_failed if the platform does not
+   *   support the overflow policy
+   *
+   * @note On Microsoft Windows only the OverflowPolicy::REJECT policy is
+   *   available.
+   */
+  dlldecl void capacity(std::size_t capacity_, OverflowPolicy policy_ = OverflowPolicy::REJECT);
+  /**
+   * Return the capacity of the task queue, or 0 if unlimited.
+   */
+  dlldecl std::size_t capacity() const;
+  /**
+   * Enable or disable shedding of the expired tasks.
+   *
+   * When enabled, the runner with the RunPolicy::EARLIEST_DEADLINE policy
+   * discards, rather than executes, the tasks whose @ref deadline passed
+   * while they were waiting in the queue. The discarded task fails with
+   * the exception::operation_failed exception carrying the
+   * error::errc::timed_out error code, which is reported to its exception
+   * handlers as if the task threw it. Has no effect on the runners with the
+   * other policies.
+   */
+  dlldecl void shed_expired(bool enable_);
+  /**
+   * Return the number of tasks discarded because their deadline passed.
+   */
+  dlldecl std::size_t shed_count() const;
+  /**
+   * Select strict or weighted draining of the task priority lanes.
+   *
+   * With strict lanes, which is the default, the runner always executes
+   * the waiting task with the highest @ref task_priority "task priority"
+   * first. With weighted lanes the runner executes up to 8, 4, 2 and 1 task
+   * from the lanes with the high, default, low and background priority,
+   * respectively, in each round, which prevents the starvation of the lower
+   * lanes.
+   *
+   * @exception cool::ng::exception::operation_failed if the platform does not
+   *   support the task priority lanes
+   *
+   * @note The task priority lanes are not available on Microsoft Windows.
+   */
+  dlldecl void weighted_lanes(bool enable_);
+  /**
+   * Set the time the thread of the busy polling runner spins without work
+   * before it parks. Has no effect on the runners with other policies.
+   */
+  dlldecl void spin_period(const std::chrono::microseconds& period_);
+  /**
+   * Execute the next task of the manually stepped runner, if any.
+   *
+   * @return true if a task was executed, false if the queue was empty
+   *
+   * @exception cool::ng::exception::invalid_state if the runner does not use
+   *   the RunPolicy::MANUAL policy or if called from the runner's own task
+   */
+  dlldecl bool run_one();
+  /**
+   * Execute the tasks waiting in the queue of the manually stepped runner.
+   * The tasks submitted by these tasks are left for the next call.
+   *
+   * @return the number of executed tasks
+   *
+   * @exception cool::ng::exception::invalid_state if the runner does not use
+   *   the RunPolicy::MANUAL policy or if called from the runner's own task
+   */
+  dlldecl std::size_t poll();
+  /**
+   * Execute the tasks of the manually stepped runner until its queue is
+   * empty, including the tasks submitted meanwhile.
+   *
+   * @return the number of executed tasks
+   *
+   * @exception cool::ng::exception::invalid_state if the runner does not use
+   *   the RunPolicy::MANUAL policy or if called from the runner's own task
+   */
+  dlldecl std::size_t run_until_idle();
+  /**
+   * Configure the process-wide worker pool.
+   *
+   * Once configured, the tasks of all sequential runners are executed by a
+   * shared pool of worker threads, which bounds the number of threads that
+   * run the tasks regardless of the number of runners. The pool starts
+   * @c min_threads_ threads immediately and adds new threads, up to
+   * @c max_threads_, when all threads are busy. The threads above the minimum
+   * exit after being idle for a while. The pool may be reconfigured at any
+   * time but cannot be removed once configured.
+   *
+   * @param min_threads_ the number of threads kept running
+   * @param max_threads_ the maximum number of threads
+   *
+   * @exception cool::ng::exception::illegal_argument if @c max_threads_ is 0
+   *   or less than @c min_threads_
+   *
+   * @note On Microsoft Windows the limits are applied to the thread pool that
+   *   executes the tasks of all runners.
+   */
+  dlldecl static void worker_pool(std::size_t min_threads_, std::size_t max_threads_);
+  /**
+   * Return the number of threads in the process-wide worker pool.
+   *
+   * Returns 0 if the worker pool was not configured.
+   *
+   * @note On Microsoft Windows the number of threads in the thread pool is
+   *   not observable and this method always returns 0.
+   */
+  dlldecl static std::size_t worker_threads();
+  /**
+   * Pin the threads of the process-wide worker pool to the set of CPUs.
+   *
+   * The setting applies to the threads of the @ref worker_pool() "worker
+   * pool" only, and takes effect even if set before the pool is configured.
+   * The tasks of the runners with their own @ref affinity() "affinity"
+   * execute on the CPUs of the runner.
+   *
+   * @param cpus_ the numbers of the CPUs; the empty set removes the pinning
+   *
+   * @exception cool::ng::exception::illegal_argument if a CPU number is out
+   *   of range
+   * @exception cool::ng::exception::operation_failed if the platform does not
+   *   support CPU affinity
+   *
+   * @note CPU affinity is only supported on Linux.
+   */
+  dlldecl static void worker_affinity(const std::vector<unsigned int>& cpus_);
+  /**
+   * Return the CPUs of the NUMA node.
+   *
+   * @exception cool::ng::exception::illegal_argument if there is no such node
+   * @exception cool::ng::exception::operation_failed if the platform does not
+   *   report the NUMA topology
+   *
+   * @note The NUMA topology is only reported on Linux.
+   */
+  dlldecl static std::vector<unsigned int> numa_cpus(unsigned int node_);
   /**
    * Returns system-wide runner object with the high priority.
    *
    * @note This runner may execute tasks concurrently.
    */
-  dlldecl static ptr sys_high();
+  dlldecl static std::shared_ptr<runner> sys_high();
   /**
    * Returns system-wide runner object with the default priority.
    *
    * @note This runner may execute tasks concurrently.
    */
-  dlldecl static ptr sys_default();
+  dlldecl static std::shared_ptr<runner> sys_default();
   /**
    * Returns system-wide runner object with the low priority.
    *
    * @note This runner may execute tasks concurrently.
    */
-  dlldecl static ptr sys_low();
+  dlldecl static std::shared_ptr<runner> sys_low();
   /**
    * Returns system-wide runner object with the background (lowest) priority.
    *
    * @note This runner may execute tasks concurrently.
    */
-  dlldecl static ptr sys_background();
+  dlldecl static std::shared_ptr<runner> sys_background();
   /**
    * Returns library default runner.
    *
    * @note This runner executes tasks sequentially.
    */
-  dlldecl static ptr cool_default();
-#endif
+  dlldecl static std::shared_ptr<runner> cool_default();
+  /**
+   * Return the task queue implementation.
+   *
+   * Returns a reference to the internal task queue implementation. Portable
+   * applications should avoid using the internal implementation directly.
+   */
+  const std::shared_ptr<impl::executor>& impl() const;
+
+ private:
+  std::shared_ptr<impl::executor> m_impl;
+};
 
 } } } // namespace
 
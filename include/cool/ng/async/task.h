@@ -768,30 +768,36 @@ class task
   }
  /**
   * Schedule task for execution.
+  *
+  * @return @c false if the @ref runner with the limited @ref runner::capacity()
+  *   "capacity" rejected the task, @c true otherwise
   */
   template <typename T = InputT>
-  void run(const typename std::decay<typename std::enable_if<
+  bool run(const typename std::decay<typename std::enable_if<
       !std::is_same<T, void>::value && !std::is_rvalue_reference<T>::value
     , T>::type>::type& arg_) const
   {
-    m_impl->run(m_impl, arg_);
+    return m_impl->run(m_impl, arg_);
   }
 
   // rvalue reference
   template <typename T = InputT>
-  void run(typename std::enable_if<
+  bool run(typename std::enable_if<
       !std::is_same<T, void>::value && std::is_rvalue_reference<T>::value
     , T>::type arg_) const
   {
-    m_impl->run(m_impl, std::move(arg_));
+    return m_impl->run(m_impl, std::move(arg_));
   }
  /**
   * Schedule task for execution.
+  *
+  * @return @c false if the @ref runner with the limited @ref runner::capacity()
+  *   "capacity" rejected the task, @c true otherwise
   */
   template <typename T = InputT>
-  typename std::enable_if<std::is_same<T, void>::value, void>::type run() const
+  typename std::enable_if<std::is_same<T, void>::value, bool>::type run() const
   {
-    m_impl->run(m_impl);
+    return m_impl->run(m_impl);
   }
 
  private:
@@ -0,0 +1,242 @@
+/* 
+ * Copyright (c) 2017 Leon Mlakar.
+ * Copyright (c) 2017 Digiverse d.o.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. The
+ * license should be included in the source distribution of the Software;
+ * if not, you may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and licensing terms shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#if !defined(cool_ng_2822428b_0cf3_401f_a6cb_03834de7e22a)
+#define      cool_ng_2822428b_0cf3_401f_a6cb_03834de7e22a
+
+#include <string>
+#include <memory>
+#include <functional>
+#include <cstddef>
+
+#include "cool/ng/bases.h"
+#include "cool/ng/ip_address.h"
+#include "cool/ng/impl/platform.h"
+
+#include "cool/ng/impl/async/event_sources_types.h"
+#include "cool/ng/impl/async/fd_watcher.h"
+
+namespace cool { namespace ng { namespace async {
+
+/**
+ * File descriptor readiness event source.
+ *
+ * The watcher observes an arbitrary file descriptor, such as a pipe, an
+ * eventfd, an inotify descriptor or a terminal, and calls the user handler
+ * from its @ref runner "runner's" context when the descriptor becomes
+ * readable or writable. This allows the auxiliary I/O to be handled by the
+ * same runners as the rest of the application, without dedicated polling
+ * threads. The watcher only reports the readiness; reading from and writing
+ * to the descriptor is left to the handlers.
+ *
+ * The readiness is level triggered. The handler is called again and again for
+ * as long as the descriptor remains ready, thus the read handler is expected
+ * to consume the available data and the write interest should only be @ref
+ * start() "started" while there is data to write. The handlers are called one
+ * at a time, and the next call is not made before the previous call returns.
+ *
+ * @note Upon creation the watcher is inactive and must be explicitly
+ *   started using @ref start().
+ * @note Watcher objects created via copy construction or copy assignment
+ *   are clones and refer to the same underlying watcher implementation.
+ * @note When the peer closes a pipe or a socket, the descriptor stays readable
+ *   and the read handler should @ref stop() the watcher once it detects the
+ *   end of the data.
+ * @note The watcher is not available on Microsoft Windows.
+ */
+class watcher
+{
+ public:
+  /**
+   * Default constructor to allow @ref watcher "watchers" to be stored in standard
+   * library containers.
+   *
+   * This constructor constructs an empty, non-functional @ref watcher. The only
+   * way to make it functional is to replace it with a functional watcher using
+   * copy assignment or move assignment operator.
+   *
+   * @note The only permitted operations on an empty watcher are copy assignment
+   *   and the @ref operator bool() "bool" conversion operator. Any other
+   *   operation will throw @ref cool::ng::exception::empty_object "empty_object"
+   *   exception.
+   */
+  watcher() { /* noop */ }
+
+  /**
+   * Creates a watcher.
+   *
+   * @tparam RunnerT <b>RunnerT</b> is the concrete type of the @ref cool::ng::async::runner "runner"
+   *         to be used to call the handlers.
+   * @tparam ReadHandlerT <b>ReadHandlerT</b> is the concrete type of the user provided
+   *         @em Callable that will be called when the descriptor becomes readable.
+   *         This type must be assignable to the following functional type:
+   * ~~~{.c}
+   *     std::function<void(const std::shared_ptr<RunnerT>&, cool::ng::net::handle, std::size_t)>
+   * ~~~
+   *         The first parameter is a shared pointer to the @ref runner, the
+   *         second parameter is the watched descriptor and the third parameter
+   *         is the amount of data available to read, as estimated by the
+   *         system. The estimate is 0 if the system cannot tell.
+   * @tparam WriteHandlerT <b>WriteHandlerT</b> is the concrete type of the user provided
+   *         @em Callable that will be called when the descriptor becomes writable.
+   *         It must be assignable to the same functional type as the read
+   *         handler. The third parameter is the estimate of the space
+   *         available for writing.
+   *
+   * @param r_     weak pointer to @ref cool::ng::async::runner "runner" to use
+   *               to call the handlers
+   * @param fd_    file descriptor to watch. The descriptor should be in the
+   *               non-blocking mode.
+   * @param hr_    read handler, or @c nullptr if the readability is not of interest
+   * @param hw_    write handler, or @c nullptr if the writability is not of interest
+   * @param owner_ if @c true, the watcher closes the descriptor when it is
+   *               destroyed. Otherwise the descriptor must remain open until
+   *               the watcher no longer uses it, see the note below.
+   *
+   * @throw cool::ng::exception::illegal_argument if both handlers are empty
+   *        or if the descriptor is not valid
+   * @throw cool::ng::exception::runner_not_available if the @ref cool::ng::async::runner
+   *        "runner" specified via parameter @a r_ is no longer available
+   * @throw cool::ng::exception::operation_failed with error code @c not_available
+   *        if the platform does not support the watcher
+   *
+   * @note The destruction of the watcher only starts the release of the
+   *   descriptor, which completes asynchronously, after the handler call in
+   *   progress, if any, returns. Closing the descriptor not owned by the
+   *   watcher before the release is complete is undefined and may affect
+   *   the descriptor reused by another file. Use the constructor with the
+   *   release handler to learn when it is safe to close the descriptor.
+   */
+  template <typename RunnerT, typename ReadHandlerT, typename WriteHandlerT>
+  watcher(const std::weak_ptr<RunnerT>& r_
+        , cool::ng::net::handle fd_
+        , const ReadHandlerT& hr_
+        , const WriteHandlerT& hw_
+        , bool owner_ = false)
+  {
+    using handler = typename detail::watcher<RunnerT>::handler;
+
+    auto impl = cool::ng::util::shared_new<detail::watcher<RunnerT>>(
+        r_
+      , fd_
+      , static_cast<handler>(hr_)
+      , static_cast<handler>(hw_));
+
+    m_impl = impl;
+    impl->initialize(owner_);
+  }
+
+  /**
+   * Creates a watcher with the release handler.
+   *
+   * Same as the constructor above, except that the watcher also calls the
+   * release handler once the watcher is destroyed and no longer uses the
+   * descriptor.
+   *
+   * @tparam ReleaseHandlerT <b>ReleaseHandlerT</b> is the concrete type of the user
+   *         provided @em Callable that will be called when the watcher
+   *         released the descriptor. This type must be assignable to the
+   *         following functional type:
+   * ~~~{.c}
+   *     std::function<void(const std::shared_ptr<RunnerT>&, cool::ng::net::handle)>
+   * ~~~
+   *         The first parameter is a shared pointer to the @ref runner, which
+   *         may be @c nullptr if the runner no longer exists, and the second
+   *         parameter is the released descriptor. The handler is called from
+   *         the runner's context. Unless the watcher owns the descriptor, the
+   *         handler may close it; otherwise the descriptor is already closed.
+   *
+   * @param r_     weak pointer to @ref cool::ng::async::runner "runner" to use
+   *               to call the handlers
+   * @param fd_    file descriptor to watch
+   * @param hr_    read handler, or @c nullptr if the readability is not of interest
+   * @param hw_    write handler, or @c nullptr if the writability is not of interest
+   * @param owner_ if @c true, the watcher closes the descriptor before it
+   *               calls the release handler
+   * @param hc_    release handler
+   *
+   * @throw cool::ng::exception::illegal_argument if both read and write
+   *        handlers are empty or if the descriptor is not valid
+   * @throw cool::ng::exception::runner_not_available if the @ref cool::ng::async::runner
+   *        "runner" specified via parameter @a r_ is no longer available
+   * @throw cool::ng::exception::operation_failed with error code @c not_available
+   *        if the platform does not support the watcher
+   */
+  template <typename RunnerT, typename ReadHandlerT, typename WriteHandlerT, typename ReleaseHandlerT>
+  watcher(const std::weak_ptr<RunnerT>& r_
+        , cool::ng::net::handle fd_
+        , const ReadHandlerT& hr_
+        , const WriteHandlerT& hw_
+        , bool owner_
+        , const ReleaseHandlerT& hc_)
+  {
+    using handler = typename detail::watcher<RunnerT>::handler;
+    using release_handler = typename detail::watcher<RunnerT>::release_handler;
+
+    auto impl = cool::ng::util::shared_new<detail::watcher<RunnerT>>(
+        r_
+      , fd_
+      , static_cast<handler>(hr_)
+      , static_cast<handler>(hw_));
+
+    m_impl = impl;
+    impl->initialize(owner_, static_cast<release_handler>(hc_));
+  }
+
+  /**
+   * Starts watching the descriptor.
+   *
+   * @param r_ the readiness to start watching. The directions without a
+   *           handler are ignored.
+   */
+  dlldecl void start(readiness r_ = readiness::any);
+  /**
+   * Stops watching the descriptor.
+   *
+   * The handlers are not called after the watcher is stopped, except for the
+   * call that may already be in progress.
+   *
+   * @param r_ the readiness to stop watching
+   */
+  dlldecl void stop(readiness r_ = readiness::any);
+  /**
+   * Return watcher's name.
+   *
+   * Each watcher instance, except empty watchers, has a unique name.
+   */
+  dlldecl const std::string& name() const;
+  /**
+   * Empty watcher predicate.
+   *
+   * @return true if this @ref watcher is properly created and functional, false if empty.
+   */
+  dlldecl explicit operator bool() const;
+
+ private:
+  std::shared_ptr<detail::itf::watcher> m_impl;
+};
+
+} } } // namespace
+
+#endif
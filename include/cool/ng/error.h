@@ -48,7 +48,11 @@ enum class errc
   request_aborted = 13,
   request_rejected = 14,
   destination_unreachable = 15,
-  request_failed = 16
+  request_failed = 16,
+  timed_out = 17,
+  read_idle = 18,
+  write_stalled = 19,
+  name_not_found = 20
 };
 
 struct library_category : std::error_category
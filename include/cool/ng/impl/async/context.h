@@ -24,11 +24,16 @@
 #if !defined(cool_ng_41352af7_f2d7_4732_8200_beef75dc84b2)
 #define      cool_ng_41352af7_f2d7_4732_8200_beef75dc84b2
 
+#include <atomic>
+#include <chrono>
 #include <cstddef>
+#include <exception>
 #include <memory>
 #include <functional>
 #include <type_traits>
 
+#include "cool/ng/async/runner.h"
+
 // Visual Studio has broken std::is_copy_constructible trait
 #if _MSC_VER == 1800
 #include "boost/type_traits.hpp"
@@ -205,8 +210,12 @@ enum class work_type {
 class work
 {
  public:
+  work() : m_next(nullptr) { /* noop */ }
   virtual ~work() { /* noop */ }
   virtual work_type type() const = 0;
+
+  // link used by the executors that keep the work in an intrusive queue
+  std::atomic<work*> m_next;
 };
 
 class event_context : public work
@@ -251,6 +260,10 @@ public:
   virtual void set_input(const any&) = 0;
   virtual void set_res_reporter(const result_reporter& arg_) = 0;
   virtual void set_exc_reporter(const exception_reporter& arg_) = 0;
+  // reports the exception through the exception reporter, if set, in place
+  // of entering the context that will not execute; like the failed entry
+  // point it removes the context from its stack and destroys it
+  virtual void report_exception(const std::exception_ptr&) = 0;
 };
 
 // ---- execution context stack interface
@@ -259,6 +272,12 @@ public:
 class context_stack : public  work
 {
  public:
+  context_stack()
+    : m_deadline(std::chrono::steady_clock::time_point::max())
+    , m_priority(RunPriority::DEFAULT)
+    , m_droppable(false)
+    , m_dropped(false)
+  { /* noop */ }
   work_type type() const override
   {
     return work_type::task_work;
@@ -272,6 +291,17 @@ class context_stack : public  work
   virtual context* pop() = 0;
   // returns true if stack is empty
   virtual bool empty() const = 0;
+
+  // deadline of the run() call that created the stack, used by the runners
+  // with the earliest deadline first policy; max() if none
+  std::chrono::steady_clock::time_point m_deadline;
+  // priority of the run() call that created the stack, selects the lane of
+  // the sequential runners
+  RunPriority m_priority;
+  // set by the runner that may discard the stack of the new submission
+  // before it starts to execute, and guarded by it
+  bool m_droppable;
+  bool m_dropped;
 };
 
 
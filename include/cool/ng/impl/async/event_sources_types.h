@@ -26,15 +26,26 @@
 
 #include <memory>
 #include <cstdint>
+#include <cstddef>
 #include <functional>
+#include <chrono>
 #include <system_error>
 
 #include "cool/ng/ip_address.h"
+#include "cool/ng/local_address.h"
 #include "cool/ng/async/runner.h"
 #include "cool/ng/async/task.h"
 
 namespace cool { namespace ng { namespace async {
 
+/**
+ * Readiness of the file descriptor observed by the @ref watcher.
+ */
+enum class readiness {
+  readable = 1,  //!< The descriptor is ready for reading
+  writable = 2,  //!< The descriptor is ready for writing
+  any      = 3   //!< Either of the above
+};
 
 namespace detail {
 
@@ -70,6 +81,31 @@ class timer : public startable
   virtual void period(uint64_t, uint64_t) = 0;
 };
 
+//--- notifier event source interface
+class notifier : public startable
+{
+ public:
+  using task_type = cool::ng::async::task<std::size_t, void>;
+
+ public:
+  virtual void signal(std::size_t) = 0;
+};
+
+//--- POSIX signal event source interface
+class signal : public startable
+{
+ public:
+  using task_type = cool::ng::async::task<std::size_t, void>;
+};
+
+//--- file descriptor watcher interface
+class watcher : public event_source
+{
+ public:
+  virtual void start(readiness) = 0;
+  virtual void stop(readiness) = 0;
+};
+
 //--- writable event source interface
 class writable : public event_source
 {
@@ -90,6 +126,19 @@ class timer
   virtual void expired() = 0;
 };
 
+// callback interface required by the implementation of the watcher
+class watcher
+{
+ public:
+  using weak_ptr = std::weak_ptr<watcher>;
+
+ public:
+  virtual ~watcher() { /* noop */}
+  // called with either readable or writable, and the amount of data
+  // available to read or space available to write, as estimated by the system
+  virtual void on_ready(readiness, std::size_t) = 0;
+};
+
 
 } // namespace cb
 
@@ -104,6 +153,28 @@ dlldecl std::shared_ptr<detail::itf::timer> create_timer(
   , uint64_t l_
 );
 
+dlldecl std::shared_ptr<detail::itf::notifier> create_notifier(
+    const detail::itf::notifier::task_type& t_
+);
+
+dlldecl std::shared_ptr<detail::itf::signal> create_signal(
+    int signo_
+  , const detail::itf::signal::task_type& t_
+);
+
+// readiness_ tells which directions have a handler; if owner_ is set the
+// watcher closes the descriptor when it is destroyed. The release_, if set,
+// is called from the runner's context once the watcher no longer uses the
+// descriptor.
+dlldecl std::shared_ptr<detail::itf::watcher> create_watcher(
+    const std::shared_ptr<runner>& r_
+  , cool::ng::net::handle fd_
+  , readiness readiness_
+  , bool owner_
+  , const cb::watcher::weak_ptr& cb_
+  , const std::function<void()>& release_
+);
+
 } // namespace impl
 
 // --- ============================================
@@ -112,10 +183,24 @@ dlldecl std::shared_ptr<detail::itf::timer> create_timer(
 namespace net  {
 
 class stream;
+class payload;
+class socket_options;
+struct timeouts;
+
+/**
+ * Strategies of the @ref server to assign the @ref runner "runners" to the
+ * accepted connections.
+ */
+enum class assignment {
+  round_robin,   //!< Assign the runners in turn
+  least_loaded,  //!< Assign the runner with the fewest tasks waiting in its queue
+  peer_hash,     //!< Assign the runner selected by the hash of the peer address
+  incoming_cpu   //!< Assign the runner pinned to the CPU that received the connection
+};
 
 namespace detail {
 
-enum class oob_event { connect, disconnect, failure, internal };
+enum class oob_event { connect, disconnect, failure, internal, timeout };
 
 namespace ip = cool::ng::net::ip;
 
@@ -143,10 +228,25 @@ namespace itf {
 class connected_writable : public async::detail::itf::writable
 {
  public:
+  using async::detail::itf::writable::write;
+  virtual void write(const cool::ng::async::net::payload&) = 0;
   virtual void connect(const ip::address&, uint16_t) = 0;
+  virtual void connect(const cool::ng::net::local::address&) = 0;
   virtual void disconnect() = 0;
-  virtual void set_handle(cool::ng::net::handle h_) = 0;
+  // the stream keeps slot_ alive while the socket h_ is open
+  virtual void set_handle(cool::ng::net::handle h_, const std::shared_ptr<void>& slot_) = 0;
+  virtual void options(const cool::ng::async::net::socket_options&) = 0;
+  virtual void set_timeouts(const cool::ng::async::net::timeouts&) = 0;
+};
 
+//--- server event source interface
+class server : public async::detail::itf::startable
+{
+ public:
+  virtual void options(const cool::ng::async::net::socket_options&) = 0;
+  virtual void max_connections(std::size_t) = 0;
+  virtual std::size_t connections() const = 0;
+  virtual void drain(const std::function<void()>&, const std::chrono::milliseconds&) = 0;
 };
 
 } // namespace itf
@@ -171,7 +271,8 @@ class server
 
  public:
   virtual ~server() { /* noop */ }
-  virtual cool::ng::async::net::stream manufacture(const ip::address&, uint16_t) = 0;
+  // the CPU is the one that received the connection, or -1 if not known
+  virtual cool::ng::async::net::stream manufacture(const ip::address&, uint16_t, int) = 0;
   virtual void on_connect(const cool::ng::async::net::stream&) = 0;
   virtual void on_event(const std::error_code&) = 0;
 };
@@ -195,11 +296,15 @@ class stream
 
 // factories for implementation classes
 
-dlldecl std::shared_ptr<async::detail::itf::startable> create_server(
+dlldecl std::shared_ptr<detail::itf::server> create_server(
     const std::shared_ptr<runner>& r_
   , const cool::ng::net::ip::address& addr_
   , uint16_t port_
   , const cb::server::weak_ptr& cb_);
+dlldecl std::shared_ptr<detail::itf::server> create_server(
+    const std::shared_ptr<runner>& r_
+  , const cool::ng::net::local::address& addr_
+  , const cb::server::weak_ptr& cb_);
 
 dlldecl std::shared_ptr<detail::itf::connected_writable> create_stream(
     const std::shared_ptr<runner>& runner_
@@ -208,6 +313,12 @@ dlldecl std::shared_ptr<detail::itf::connected_writable> create_stream(
   , const cb::stream::weak_ptr& cb_
   , void* buf_
   , std::size_t bufsz_);
+dlldecl std::shared_ptr<detail::itf::connected_writable> create_stream(
+    const std::shared_ptr<runner>& runner_
+  , const cool::ng::net::local::address& addr_
+  , const cb::stream::weak_ptr& cb_
+  , void* buf_
+  , std::size_t bufsz_);
 dlldecl std::shared_ptr<detail::itf::connected_writable> create_stream(
     const std::shared_ptr<runner>& runner_
   , const cb::stream::weak_ptr& cb_
@@ -217,6 +328,34 @@ dlldecl std::shared_ptr<detail::itf::connected_writable> create_stream(
 
 } // namespace impl
 
+} // namespace net
+
+// --- ============================================
+// --- Interprocess communication event sources
+//
+namespace ipc {
+
+/**
+ * The role of the @ref channel at its construction.
+ */
+enum class mode {
+  create, //!< Create the channel and wait for the peer to open it
+  open    //!< Open the channel created by the peer
+};
+
+namespace impl {
+
+// the channel implementation reports to the same callback interface as the
+// network stream
+dlldecl std::shared_ptr<async::detail::itf::writable> create_channel(
+    const std::shared_ptr<runner>& r_
+  , const std::string& name_
+  , mode mode_
+  , std::size_t capacity_
+  , const net::impl::cb::stream::weak_ptr& cb_);
+
+} // namespace impl
+
 } } } } // namespace
 
 #endif
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2017 Leon Mlakar.
+ * Copyright (c) 2017 Digiverse d.o.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. The
+ * license should be included in the source distribution of the Software;
+ * if not, you may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and licensing terms shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#if !defined(cool_ng_7397277d_97c5_4622_ab0e_ffee3766567d)
+#define      cool_ng_7397277d_97c5_4622_ab0e_ffee3766567d
+
+#include <memory>
+#include <functional>
+#include <cstddef>
+
+#include "cool/ng/bases.h"
+#include "cool/ng/ip_address.h"
+#include "cool/ng/impl/platform.h"
+#include "cool/ng/async/runner.h"
+
+#include "event_sources_types.h"
+
+namespace cool { namespace ng { namespace async {
+
+namespace detail {
+
+// --- template wrapper around platform dependent watcher implementation -
+//     template parameter preserves actual runner type that is passed to
+//     the user callbacks
+template <typename RunnerT>
+class watcher : public itf::watcher
+              , public impl::cb::watcher
+              , public cool::ng::util::self_aware<watcher<RunnerT>>
+{
+ public:
+  using handler = std::function<void(const std::shared_ptr<RunnerT>&, cool::ng::net::handle, std::size_t)>;
+  using release_handler = std::function<void(const std::shared_ptr<RunnerT>&, cool::ng::net::handle)>;
+
+ public:
+  watcher(const std::weak_ptr<RunnerT>& runner_
+        , cool::ng::net::handle fd_
+        , const handler& hr_
+        , const handler& hw_)
+      : m_runner(runner_), m_handle(fd_), m_rhandler(hr_), m_whandler(hw_)
+  { /* noop */ }
+
+  void initialize(bool owner_, const release_handler& hc_ = release_handler())
+  {
+    auto r = m_runner.lock();
+    if (!r)
+      throw cool::ng::exception::runner_not_available();
+
+    int dirs = (m_rhandler ? static_cast<int>(readiness::readable) : 0)
+             | (m_whandler ? static_cast<int>(readiness::writable) : 0);
+    if (dirs == 0 || m_handle == cool::ng::net::invalid_handle)
+      throw cool::ng::exception::illegal_argument();
+
+    // the release handler outlives this object, which is usually gone by
+    // the time the watcher releases the descriptor
+    std::function<void()> release;
+    if (hc_)
+    {
+      auto runner = m_runner;
+      auto handle = m_handle;
+      release = [runner, handle, hc_] ()
+      {
+        try { hc_(runner.lock(), handle); } catch (...) { /* noop */ }
+      };
+    }
+
+    m_impl = impl::create_watcher(r, m_handle, static_cast<readiness>(dirs), owner_, this->self(), release);
+  }
+
+  ~watcher()
+  {
+    if (m_impl)
+      m_impl->shutdown();
+  }
+
+  //--- watcher interface
+  void start(readiness r_) override        { m_impl->start(r_); }
+  void stop(readiness r_) override         { m_impl->stop(r_); }
+  void shutdown() override                 { m_impl->shutdown(); }
+  const std::string& name() const override { return m_impl->name(); }
+
+  //--- cb::watcher interface
+  void on_ready(readiness r_, std::size_t size_) override
+  {
+    auto& h = r_ == readiness::readable ? m_rhandler : m_whandler;
+    if (!h)
+      return;
+
+    auto r = m_runner.lock();
+    if (r)
+      try { h(r, m_handle, size_); } catch (...) { /* noop */ }
+  }
+
+ private:
+  std::shared_ptr<itf::watcher> m_impl;
+  std::weak_ptr<RunnerT>        m_runner;
+  cool::ng::net::handle         m_handle;
+  handler                       m_rhandler;
+  handler                       m_whandler;
+};
+
+} } } } // namespace
+
+#endif
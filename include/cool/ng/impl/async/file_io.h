@@ -0,0 +1,89 @@
+/* 
+ * Copyright (c) 2017 Leon Mlakar.
+ * Copyright (c) 2017 Digiverse d.o.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. The
+ * license should be included in the source distribution of the Software;
+ * if not, you may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and licensing terms shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#if !defined(cool_ng_da5a11b2_7e9d_4c1b_852e_b8484589e916)
+#define      cool_ng_da5a11b2_7e9d_4c1b_852e_b8484589e916
+
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <system_error>
+
+#include "cool/ng/ip_address.h"
+#include "cool/ng/impl/platform.h"
+#include "cool/ng/async/task.h"
+
+namespace cool { namespace ng { namespace async {
+
+namespace detail { namespace itf {
+
+//--- asynchronous file interface
+class file
+{
+ public:
+  // input of the completion task
+  struct completion
+  {
+    completion() : buffer(nullptr), size(0), offset(0)
+    { /* noop */ }
+
+    void*           buffer;   // buffer passed to read or write
+    std::size_t     size;     // number of bytes transferred
+    uint64_t        offset;   // file offset passed to read or write
+    std::error_code error;
+  };
+  using task_type = cool::ng::async::task<completion, void>;
+
+ public:
+  virtual ~file() { /* noop */ }
+  virtual void read(uint64_t offset_, void* buf_, std::size_t size_, const task_type& t_) = 0;
+  virtual void write(uint64_t offset_, const void* buf_, std::size_t size_, const task_type& t_) = 0;
+  virtual void sync(const task_type& t_) = 0;
+  virtual std::size_t pending() const = 0;
+  virtual cool::ng::net::handle native_handle() const = 0;
+};
+
+} } // namespace detail::itf
+
+namespace impl {
+
+// if owner_ is set the file closes the descriptor when the last request
+// completes after the file is destroyed
+dlldecl std::shared_ptr<detail::itf::file> create_file(
+    cool::ng::net::handle fd_
+  , bool owner_
+  , std::size_t threads_);
+
+dlldecl std::shared_ptr<detail::itf::file> create_file(
+    const std::string& path_
+  , int flags_
+  , int mode_
+  , std::size_t threads_);
+
+} // namespace impl
+
+} } } // namespace
+
+#endif
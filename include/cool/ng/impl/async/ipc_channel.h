@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2017 Leon Mlakar.
+ * Copyright (c) 2017 Digiverse d.o.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. The
+ * license should be included in the source distribution of the Software;
+ * if not, you may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and licensing terms shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#if !defined(cool_ng_3e9a61d4_2b7c_4f08_a5d1_6c0e8f4b2a97)
+#define      cool_ng_3e9a61d4_2b7c_4f08_a5d1_6c0e8f4b2a97
+
+#include <memory>
+#include <functional>
+#include <string>
+
+#include "cool/ng/bases.h"
+#include "cool/ng/impl/platform.h"
+#include "cool/ng/async/runner.h"
+
+#include "event_sources_types.h"
+
+namespace cool { namespace ng { namespace async { namespace ipc {
+
+namespace detail {
+
+// --- template wrapper around platform dependent channel implementation -
+//     template parameter preserves actual runner type that is passed to
+//     the user callbacks
+template <typename RunnerT>
+class channel : public async::detail::itf::writable
+              , public net::impl::cb::stream
+              , public cool::ng::util::self_aware<channel<RunnerT>>
+{
+ public:
+  using wr_handler    = typename net::detail::types<RunnerT>::write_handler;
+  using rd_handler    = typename net::detail::types<RunnerT>::read_handler;
+  using event_handler = typename net::detail::types<RunnerT>::event_handler;
+
+ public:
+  channel(const std::weak_ptr<RunnerT>& runner_
+        , const rd_handler& rh_
+        , const wr_handler& wh_
+        , const event_handler& eh_)
+      : m_runner(runner_), m_rhandler(rh_), m_whandler(wh_), m_oob(eh_)
+  { /* noop */ }
+
+  void initialize(const std::string& name_, mode mode_, std::size_t capacity_)
+  {
+    auto r = m_runner.lock();
+    if (r)
+      m_impl = impl::create_channel(r, name_, mode_, capacity_, this->self());
+    else
+      throw cool::ng::exception::runner_not_available();
+  }
+
+  ~channel()
+  {
+    if (m_impl)
+      m_impl->shutdown();
+  }
+
+  //--- writable interface
+  void shutdown() override
+  {
+    m_impl->shutdown();
+  }
+  const std::string& name() const override
+  {
+    return m_impl->name();
+  }
+  inline void write(const void* data, std::size_t size) override
+  {
+    m_impl->write(data, size);
+  }
+
+  //--- cb::stream interface
+  void on_read(void*& buf_, std::size_t& size_) override
+  {
+    if (!m_rhandler)
+      return;
+
+    auto r = m_runner.lock();
+    if (r)
+      try { m_rhandler(r, buf_, size_); } catch (...) { /* noop */ }
+  }
+  void on_write(const void* buf_, std::size_t size_) override
+  {
+    if (!m_whandler)
+      return;
+
+    auto r = m_runner.lock();
+    if (r)
+      try { m_whandler(r, buf_, size_); } catch (...) { /* noop */ }
+  }
+  void on_event(net::detail::oob_event evt, const std::error_code& e) override
+  {
+    if (!m_oob)
+      return;
+
+    auto r = m_runner.lock();
+    if (r)
+      try { m_oob(r, evt, e); } catch (...) { /* noop */ }
+  }
+
+ private:
+  std::shared_ptr<async::detail::itf::writable> m_impl;
+  std::weak_ptr<RunnerT> m_runner;
+  rd_handler             m_rhandler;
+  wr_handler             m_whandler;
+  event_handler          m_oob;
+};
+
+} } } } } // namespace
+
+#endif
@@ -0,0 +1,71 @@
+/* 
+ * Copyright (c) 2017 Leon Mlakar.
+ * Copyright (c) 2017 Digiverse d.o.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. The
+ * license should be included in the source distribution of the Software;
+ * if not, you may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and licensing terms shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#if !defined(cool_ng_58986dbe_d892_4ff3_9f75_36bb237dd0e0)
+#define      cool_ng_58986dbe_d892_4ff3_9f75_36bb237dd0e0
+
+#include <memory>
+#include <functional>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstddef>
+#include <system_error>
+
+#include "cool/ng/ip_address.h"
+#include "cool/ng/impl/platform.h"
+
+namespace cool { namespace ng { namespace async { namespace net {
+
+namespace detail { namespace itf {
+
+//--- name resolver interface
+class resolver
+{
+ public:
+  // called from the resolver's thread, or from the caller's thread if the
+  // result was cached
+  using callback = std::function<void(const std::vector<cool::ng::net::ip::host_container>&, const std::error_code&)>;
+
+ public:
+  virtual ~resolver() { /* noop */ }
+  virtual void lookup(const std::string& name_, const callback& cb_) = 0;
+  virtual void flush() = 0;
+  virtual std::size_t lookups() const = 0;
+};
+
+} } // namespace detail::itf
+
+namespace impl {
+
+dlldecl std::shared_ptr<detail::itf::resolver> create_resolver(
+    std::size_t threads_
+  , const std::chrono::milliseconds& ttl_
+  , const std::chrono::milliseconds& negative_ttl_);
+
+} // namespace impl
+
+} } } } // namespace
+
+#endif
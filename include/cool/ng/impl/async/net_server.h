@@ -24,8 +24,13 @@
 #if !defined(cool_ng_f36abcb0_cce1_42a3_b25a_9beef951523a)
 #define      cool_ng_f36abcb0_cce1_42a3_b25a_9beef951523a
 
+#include <algorithm>
 #include <memory>
 #include <functional>
+#include <mutex>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
 
 #if !defined(WINDOWS_TARGET)
 #include <dispatch/dispatch.h>
@@ -48,7 +53,7 @@ namespace detail {
 //     template parameter preserves actual runner type that is passed to
 //     the user callback
 template <typename RunnerT>
-class server : public async::detail::itf::startable
+class server : public itf::server
              , public impl::cb::server
              , public cool::ng::util::self_aware<server<RunnerT>>
 {
@@ -64,7 +69,12 @@ class server : public async::detail::itf::startable
        , const stream_factory& sf_
        , const connect_handler& hc_
        , const error_handler& he_)
-    : m_runner(runner_), m_factory(sf_), m_handler(hc_), m_err_handler(he_)
+    : m_runner(runner_)
+    , m_factory(sf_)
+    , m_handler(hc_)
+    , m_err_handler(he_)
+    , m_strategy(assignment::round_robin)
+    , m_next(0)
   { /* noop */ }
 
   void initialize(const cool::ng::net::ip::address& addr_, uint16_t port_)
@@ -76,6 +86,15 @@ class server : public async::detail::itf::startable
       throw cool::ng::exception::runner_not_available();
   }
 
+  void initialize(const cool::ng::net::local::address& addr_)
+  {
+    auto r = m_runner.lock();
+    if (r)
+      m_impl = impl::create_server(r, addr_, this->self());
+    else
+      throw cool::ng::exception::runner_not_available();
+  }
+
   void initialize(cool::ng::net::handle h_)
   {
     auto r = m_runner.lock();
@@ -97,6 +116,21 @@ class server : public async::detail::itf::startable
   void stop() override                     { m_impl->stop();  }
   void shutdown() override                 { m_impl->stop();  }
   const std::string& name() const override { return m_impl->name(); }
+  void options(const socket_options& opts_) override { m_impl->options(opts_); }
+  void max_connections(std::size_t max_) override    { m_impl->max_connections(max_); }
+  std::size_t connections() const override          { return m_impl->connections(); }
+  void drain(const std::function<void()>& handler_, const std::chrono::milliseconds& grace_) override
+  {
+    m_impl->drain(handler_, grace_);
+  }
+
+  void runners(const std::vector<std::weak_ptr<RunnerT>>& pool_, assignment strategy_)
+  {
+    std::unique_lock<std::mutex> l(m_pool_lock);
+    m_pool = pool_;
+    m_strategy = strategy_;
+    m_next = 0;
+  }
 
   //--- cb::server interface
   void on_connect(const cool::ng::async::net::stream& s_) override
@@ -123,20 +157,88 @@ class server : public async::detail::itf::startable
       try { m_err_handler(r, err); } catch (...) { /* noop */ }
   }
 
-  cool::ng::async::net::stream manufacture(const ip::address& addr_, uint16_t port_) override
+  cool::ng::async::net::stream manufacture(const ip::address& addr_, uint16_t port_, int cpu_) override
   {
-    auto r = m_runner.lock();
+    auto r = select_runner(addr_, cpu_);
     if (!r)
       throw cool::ng::exception::runner_not_available();
     return m_factory(r, addr_, port_);
   }
 
+ private:
+  // picks the runner for the new connection from the pool, or the server's
+  // runner if there is no pool; the expired runners are skipped
+  std::shared_ptr<RunnerT> select_runner(const ip::address& addr_, int cpu_)
+  {
+    std::unique_lock<std::mutex> l(m_pool_lock);
+    if (m_pool.empty())
+      return m_runner.lock();
+
+    if (m_strategy == assignment::incoming_cpu && cpu_ >= 0)
+    {
+      for (auto& w : m_pool)
+      {
+        auto r = w.lock();
+        if (!r)
+          continue;
+        auto cpus = r->affinity();
+        if (std::find(cpus.begin(), cpus.end(), static_cast<unsigned int>(cpu_)) != cpus.end())
+          return r;
+      }
+    }
+
+    std::size_t start = 0;
+    switch (m_strategy)
+    {
+      case assignment::round_robin:
+      case assignment::least_loaded:
+      case assignment::incoming_cpu:
+        // rotating start also spreads connections among equally loaded runners
+        start = m_next++;
+        break;
+
+      case assignment::peer_hash:
+      {
+        // FNV-1a over the address bytes
+        uint64_t hash = 14695981039346656037ULL;
+        auto data = static_cast<const uint8_t*>(addr_);
+        for (std::size_t i = 0; i < addr_.size(); ++i)
+          hash = (hash ^ data[i]) * 1099511628211ULL;
+        start = static_cast<std::size_t>(hash % m_pool.size());
+        break;
+      }
+    }
+
+    std::shared_ptr<RunnerT> ret;
+    for (std::size_t i = 0; i < m_pool.size(); ++i)
+    {
+      auto r = m_pool[(start + i) % m_pool.size()].lock();
+      if (!r)
+        continue;
+      if (m_strategy == assignment::round_robin || m_strategy == assignment::incoming_cpu)
+      {
+        m_next += i;   // the next turn goes to the runner after this one
+        return r;
+      }
+      if (m_strategy == assignment::peer_hash)
+        return r;
+      if (!ret || r->queue_depth() < ret->queue_depth())
+        ret = r;
+    }
+    return ret;
+  }
+
  private:
   std::weak_ptr<RunnerT> m_runner;
   stream_factory         m_factory;
   connect_handler        m_handler;
   error_handler          m_err_handler;
-  std::shared_ptr<async::detail::itf::startable> m_impl;
+  std::shared_ptr<itf::server> m_impl;
+
+  std::mutex             m_pool_lock;
+  std::vector<std::weak_ptr<RunnerT>> m_pool;
+  assignment             m_strategy;
+  std::size_t            m_next;
 };
 
 
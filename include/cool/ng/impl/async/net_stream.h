@@ -70,6 +70,17 @@ class stream : public itf::connected_writable
       throw cool::ng::exception::runner_not_available();
   }
  
+  void initialize(const cool::ng::net::local::address& addr_, void* buf_, std::size_t bufsz_)
+  {
+    auto r = m_runner.lock();
+    if (r)
+    {
+      m_impl = impl::create_stream(r, addr_, this->self(), buf_, bufsz_);
+    }
+    else
+      throw cool::ng::exception::runner_not_available();
+  }
+
   void initialize(void* buf_, std::size_t bufsz_)
   {
     auto r = m_runner.lock();
@@ -102,17 +113,33 @@ class stream : public itf::connected_writable
   {
     m_impl->write(data, size);
   }
+  inline void write(const cool::ng::async::net::payload& data) override
+  {
+    m_impl->write(data);
+  }
   inline void connect(const cool::ng::net::ip::address& addr_, uint16_t port_) override
   {
     m_impl->connect(addr_, port_);
   }
+  inline void connect(const cool::ng::net::local::address& addr_) override
+  {
+    m_impl->connect(addr_);
+  }
   inline void disconnect() override
   {
     m_impl->disconnect();
   }
-  inline void set_handle(cool::ng::net::handle h_) override
+  inline void set_handle(cool::ng::net::handle h_, const std::shared_ptr<void>& slot_) override
+  {
+    m_impl->set_handle(h_, slot_);
+  }
+  inline void options(const cool::ng::async::net::socket_options& opts_) override
+  {
+    m_impl->options(opts_);
+  }
+  inline void set_timeouts(const cool::ng::async::net::timeouts& t_) override
   {
-    m_impl->set_handle(h_);
+    m_impl->set_timeouts(t_);
   }
   //--- cb::stream interface
   void on_read(void*& buf_, std::size_t& size_) override
@@ -195,6 +195,15 @@ class task_context_base : public context
   {
     m_exc_reporter = arg_;
   }
+  void report_exception(const std::exception_ptr& e_) override
+  {
+    if (m_stack != nullptr)
+      m_stack->pop();
+    if (m_exc_reporter)
+      m_exc_reporter(e_);
+    if (m_stack != nullptr)
+      delete this;
+  }
   void set_input(const any& input_) override
   {
     m_input = input_;
@@ -213,8 +222,9 @@ class task_context_base : public context
   exception_reporter    m_exc_reporter; // exception reporter if set
 };
 
-// ---- Task execution kick-starter
-dlldecl void kickstart(context_stack*);
+// ---- Task execution kick-starter; returns false if the runner rejected
+//      the task, in which case the context stack is deleted
+dlldecl bool kickstart(context_stack*);
 
 // ---- Default implementation of task stack
 class default_task_stack : public context_stack
@@ -247,7 +257,7 @@ class taskinfo : public detail::task
   using input_type    = InputT;
 
   template <typename T = InputT>
-  inline void run(
+  inline bool run(
       const std::shared_ptr<this_type>& self_
     , const typename std::decay<typename std::enable_if<
           !std::is_same<T, void>::value && !std::is_rvalue_reference<T>::value
@@ -256,12 +266,12 @@ class taskinfo : public detail::task
     any input = i_;
     auto stack = new default_task_stack();
     create_context(stack, self_, input);
-    kickstart(stack);
+    return kickstart(stack);
   }
 
   // rvalue reference argument
   template <typename T = InputT>
-  inline void run(
+  inline bool run(
       const std::shared_ptr<this_type>& self_
     , typename std::enable_if<
         !std::is_same<T, void>::value && std::is_rvalue_reference<T>::value
@@ -270,15 +280,15 @@ class taskinfo : public detail::task
     any input(std::move(i_));
     auto stack = new default_task_stack();
     create_context(stack, self_, input);
-    kickstart(stack);
+    return kickstart(stack);
   }
 
   template <typename T = InputT>
-  typename std::enable_if<std::is_same<T, void>::value, void>::type run(const std::shared_ptr<this_type>& self_)
+  typename std::enable_if<std::is_same<T, void>::value, bool>::type run(const std::shared_ptr<this_type>& self_)
   {
     auto stack = new default_task_stack();
     create_context(stack, self_, any());
-    kickstart(stack);
+    return kickstart(stack);
   }
 };
 
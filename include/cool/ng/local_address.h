@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2017 Leon Mlakar.
+ * Copyright (c) 2017 Digiverse d.o.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. The
+ * license should be included in the source distribution of the Software;
+ * if not, you may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and licensing terms shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#if !defined(cool_ng_7c41d2e6_3a90_4f5b_8e12_c4a5b19d0f63)
+#define      cool_ng_7c41d2e6_3a90_4f5b_8e12_c4a5b19d0f63
+
+#include <iostream>
+#include <string>
+
+#include "cool/ng/impl/platform.h"
+
+namespace cool { namespace ng {
+
+namespace net {
+
+/**
+ * This namespace contains local (Unix domain) socket related classes.
+ */
+namespace local {
+
+/**
+ * Namespace of the local socket address.
+ */
+enum class style {
+  filesystem, //!< Socket is bound to the path in the filesystem
+  abstract    //!< Socket is bound to the name in the abstract namespace (Linux only)
+};
+
+/**
+ * Address of the local (Unix domain) stream socket.
+ *
+ * The local address can be used in place of the IP address and port pair
+ * for the @ref cool::ng::async::net::server "server" and the
+ * @ref cool::ng::async::net::stream "stream" when both network peers are
+ * on the same host. The communication over local sockets does not pass the
+ * TCP/IP stack.
+ *
+ * The address either represents a path in the filesystem, or, on Linux, a
+ * name in the abstract socket namespace. The abstract names are not visible
+ * in the filesystem and disappear when the last socket bound to them
+ * is closed. The name of the abstract address is specified without the
+ * leading null character.
+ *
+ * @note The length of the path is limited by the platform's
+ *   <tt>sockaddr_un</tt> structure, which is typically around 100 characters.
+ *   The length is checked when the address is used.
+ */
+class address
+{
+ public:
+  /**
+   * Constructs an empty local address.
+   */
+  address() : m_style(style::filesystem)
+  { /* noop */ }
+  /**
+   * Constructs a local address.
+   *
+   * @param path_  filesystem path or the name in the abstract namespace
+   * @param style_ namespace of the local address
+   */
+  explicit address(const std::string& path_, style style_ = style::filesystem)
+    : m_path(path_), m_style(style_)
+  { /* noop */ }
+
+  /**
+   * Returns the filesystem path or the abstract name of the local address.
+   */
+  const std::string& path() const
+  {
+    return m_path;
+  }
+  /**
+   * Returns true if the address is in the abstract namespace.
+   */
+  bool is_abstract() const
+  {
+    return m_style == style::abstract;
+  }
+  /**
+   * Empty address predicate.
+   *
+   * @return true if the address is not empty, false if empty.
+   */
+  explicit operator bool() const
+  {
+    return !m_path.empty();
+  }
+
+ private:
+  std::string m_path;
+  style       m_style;
+};
+
+/**
+ * Binary compare two local addresses.
+ */
+inline bool operator ==(const address& lhs, const address& rhs)
+{
+  return lhs.is_abstract() == rhs.is_abstract() && lhs.path() == rhs.path();
+}
+/**
+ * Binary compare two local addresses.
+ */
+inline bool operator !=(const address& lhs, const address& rhs)
+{
+  return !(lhs == rhs);
+}
+/**
+ * Display local address to the character stream. The names in the abstract
+ * namespace are prefixed with the @c @ character.
+ */
+inline std::ostream& operator <<(std::ostream& os, const address& val)
+{
+  if (val.is_abstract())
+    os << '@';
+  return os << val.path();
+}
+
+} } } } // namespace
+
+#endif
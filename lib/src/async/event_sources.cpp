@@ -95,6 +95,116 @@ timer::operator bool() const
   return !!m_impl;
 }
 
+// --------------------------------------------------------------------------
+// -----
+// ----- notifier
+// ------
+
+notifier::notifier(const task_type& task_)
+{
+  m_impl = impl::create_notifier(task_);
+}
+
+void notifier::signal(std::size_t count_)
+{
+  if (!*this)
+    throw cool::ng::exception::empty_object();
+  m_impl->signal(count_);
+}
+
+void notifier::start()
+{
+  if (!*this)
+    throw cool::ng::exception::empty_object();
+  m_impl->start();
+}
+
+void notifier::stop()
+{
+  if (!*this)
+    throw cool::ng::exception::empty_object();
+  m_impl->stop();
+}
+
+const std::string& notifier::name() const
+{
+  if (!*this)
+    throw cool::ng::exception::empty_object();
+  return m_impl->name();
+}
+
+notifier::operator bool() const
+{
+  return !!m_impl;
+}
+
+// --------------------------------------------------------------------------
+// -----
+// ----- signal
+// ------
+
+signal::signal(int signo_, const task_type& task_)
+{
+  m_impl = impl::create_signal(signo_, task_);
+}
+
+void signal::start()
+{
+  if (!*this)
+    throw cool::ng::exception::empty_object();
+  m_impl->start();
+}
+
+void signal::stop()
+{
+  if (!*this)
+    throw cool::ng::exception::empty_object();
+  m_impl->stop();
+}
+
+const std::string& signal::name() const
+{
+  if (!*this)
+    throw cool::ng::exception::empty_object();
+  return m_impl->name();
+}
+
+signal::operator bool() const
+{
+  return !!m_impl;
+}
+
+// --------------------------------------------------------------------------
+// -----
+// ----- watcher
+// ------
+
+void watcher::start(readiness r_)
+{
+  if (!*this)
+    throw cool::ng::exception::empty_object();
+  m_impl->start(r_);
+}
+
+void watcher::stop(readiness r_)
+{
+  if (!*this)
+    throw cool::ng::exception::empty_object();
+  m_impl->stop(r_);
+}
+
+const std::string& watcher::name() const
+{
+  if (!*this)
+    throw cool::ng::exception::empty_object();
+  return m_impl->name();
+}
+
+watcher::operator bool() const
+{
+  return !!m_impl;
+}
+
 #if 0
 namespace detail {
 
@@ -182,6 +292,34 @@ const std::string& server::name() const
   return m_impl->name();
 }
 
+void server::options(const socket_options& opts_)
+{
+  if (!*this)
+    throw cool::ng::exception::empty_object();
+  m_impl->options(opts_);
+}
+
+void server::max_connections(std::size_t max_)
+{
+  if (!*this)
+    throw cool::ng::exception::empty_object();
+  m_impl->max_connections(max_);
+}
+
+std::size_t server::connections() const
+{
+  if (!*this)
+    throw cool::ng::exception::empty_object();
+  return m_impl->connections();
+}
+
+void server::drain(const std::function<void()>& handler_, const std::chrono::milliseconds& grace_)
+{
+  if (!*this)
+    throw cool::ng::exception::empty_object();
+  m_impl->drain(handler_, grace_);
+}
+
 server::operator bool() const
 {
   return !!m_impl;
@@ -202,6 +340,13 @@ void stream::write(const void* data_, std::size_t size_)
   m_impl->write(data_, size_);
 }
 
+void stream::write(const payload& data_)
+{
+  if (!*this)
+    throw cool::ng::exception::empty_object();
+  m_impl->write(data_);
+}
+
 void stream::connect(const cool::ng::net::ip::address& addr_, uint16_t port_)
 {
   if (!*this)
@@ -209,6 +354,13 @@ void stream::connect(const cool::ng::net::ip::address& addr_, uint16_t port_)
   m_impl->connect(addr_, port_);
 }
 
+void stream::connect(const cool::ng::net::local::address& addr_)
+{
+  if (!*this)
+    throw cool::ng::exception::empty_object();
+  m_impl->connect(addr_);
+}
+
 void stream::disconnect()
 {
   if (!*this)
@@ -216,6 +368,20 @@ void stream::disconnect()
   m_impl->disconnect();
 }
 
+void stream::options(const socket_options& opts_)
+{
+  if (!*this)
+    throw cool::ng::exception::empty_object();
+  m_impl->options(opts_);
+}
+
+void stream::set_timeouts(const timeouts& t_)
+{
+  if (!*this)
+    throw cool::ng::exception::empty_object();
+  m_impl->set_timeouts(t_);
+}
+
 stream::operator bool() const
 {
   return !!m_impl;
@@ -228,7 +394,7 @@ namespace impl {
 // ----- Factory methods
 // ------
 
-std::shared_ptr<async::detail::itf::startable> create_server(
+std::shared_ptr<detail::itf::server> create_server(
     const std::shared_ptr<runner>& r_
   , const ip::address& addr_
   , uint16_t port_
@@ -239,6 +405,16 @@ std::shared_ptr<async::detail::itf::startable> create_server(
   return ret;
 }
 
+std::shared_ptr<detail::itf::server> create_server(
+    const std::shared_ptr<runner>& r_
+  , const cool::ng::net::local::address& addr_
+  , const cb::server::weak_ptr& cb_)
+{
+  auto ret = cool::ng::util::shared_new<server>(r_->impl(), cb_);
+  ret->initialize(addr_);
+  return ret;
+}
+
 std::shared_ptr<detail::itf::connected_writable> create_stream(
     const std::shared_ptr<runner>& r_
   , const cool::ng::net::ip::address& addr_
@@ -252,6 +428,18 @@ std::shared_ptr<detail::itf::connected_writable> create_stream(
   return ret;
 }
 
+std::shared_ptr<detail::itf::connected_writable> create_stream(
+    const std::shared_ptr<runner>& r_
+  , const cool::ng::net::local::address& addr_
+  , const cb::stream::weak_ptr& cb_
+  , void* buf_
+  , std::size_t bufsz_)
+{
+  auto ret = cool::ng::util::shared_new<stream>(r_->impl(), cb_);
+  ret->initialize(addr_, buf_, bufsz_);
+  return ret;
+}
+
 std::shared_ptr<detail::itf::connected_writable> create_stream(
     const std::shared_ptr<runner>& r_
   , const cb::stream::weak_ptr& cb_
@@ -264,6 +452,47 @@ std::shared_ptr<detail::itf::connected_writable> create_stream(
 }
 
 
-} } } } }
+} } // namespace net::impl
 
+// --------------------------------------------------------------------------
+// -----
+// ----- interprocess communication sources
+// ------
+// --------------------------------------------------------------------------
+
+namespace ipc {
+
+const std::string& channel::name() const
+{
+  if (!*this)
+    throw cool::ng::exception::empty_object();
+  return m_impl->name();
+}
+
+void channel::write(const void* data_, std::size_t size_)
+{
+  if (!*this)
+    throw cool::ng::exception::empty_object();
+  m_impl->write(data_, size_);
+}
+
+channel::operator bool() const
+{
+  return !!m_impl;
+}
+
+namespace impl {
+
+std::shared_ptr<async::detail::itf::writable> create_channel(
+    const std::shared_ptr<runner>& r_
+  , const std::string& name_
+  , mode mode_
+  , std::size_t capacity_
+  , const net::impl::cb::stream::weak_ptr& cb_)
+{
+  auto ret = cool::ng::util::shared_new<channel>(r_->impl(), cb_);
+  ret->initialize(name_, mode_, capacity_);
+  return ret;
+}
 
+} } } } } // namespace
@@ -0,0 +1,313 @@
+/*
+ * Copyright (c) 2017 Leon Mlakar.
+ * Copyright (c) 2017 Digiverse d.o.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. The
+ * license should be included in the source distribution of the Software;
+ * if not, you may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and licensing terms shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#if !defined(WINDOWS_TARGET)
+# include <unistd.h>
+# include <fcntl.h>
+# include <errno.h>
+#endif
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "cool/ng/error.h"
+#include "cool/ng/exception.h"
+#include "cool/ng/async/file.h"
+
+namespace cool { namespace ng { namespace async {
+
+using cool::ng::net::handle;
+using cool::ng::net::invalid_handle;
+
+namespace exc = cool::ng::exception;
+
+namespace impl {
+
+#if !defined(WINDOWS_TARGET)
+
+namespace {
+
+class file : public detail::itf::file
+{
+  using task_type = detail::itf::file::task_type;
+  using completion = detail::itf::file::completion;
+
+  enum class kind { read, write, sync };
+
+  struct request
+  {
+    kind        op;
+    uint64_t    offset;
+    void*       buffer;
+    std::size_t size;
+    task_type   task;
+  };
+
+  // shared with the worker threads, which complete the queued requests and
+  // close the descriptor after the file is destroyed
+  struct state
+  {
+    state(handle fd_, bool owner_) : fd(fd_), owner(owner_), stopped(false), pending(0)
+    { /* noop */ }
+    ~state()
+    {
+      if (owner)
+        ::close(fd);
+    }
+
+    const handle            fd;
+    const bool              owner;
+    mutable std::mutex      lock;
+    std::condition_variable cv;
+    std::deque<request>     queue;
+    bool                    stopped;
+    std::size_t             pending;
+  };
+
+ public:
+  file(handle fd_, bool owner_, std::size_t threads_)
+    : m_state(std::make_shared<state>(fd_, owner_))
+  {
+    for (std::size_t i = 0; i < threads_; ++i)
+      std::thread(worker, m_state).detach();
+  }
+
+  ~file()
+  {
+    {
+      std::unique_lock<std::mutex> l(m_state->lock);
+      m_state->stopped = true;
+    }
+    m_state->cv.notify_all();
+  }
+
+  void read(uint64_t offset_, void* buf_, std::size_t size_, const task_type& t_) override
+  {
+    submit(kind::read, offset_, buf_, size_, t_);
+  }
+
+  void write(uint64_t offset_, const void* buf_, std::size_t size_, const task_type& t_) override
+  {
+    submit(kind::write, offset_, const_cast<void*>(buf_), size_, t_);
+  }
+
+  void sync(const task_type& t_) override
+  {
+    if (!t_)
+      throw exc::illegal_argument();
+    submit(kind::sync, 0, nullptr, 0, t_);
+  }
+
+  std::size_t pending() const override
+  {
+    std::unique_lock<std::mutex> l(m_state->lock);
+    return m_state->pending;
+  }
+
+  handle native_handle() const override
+  {
+    return m_state->fd;
+  }
+
+ private:
+  void submit(kind op_, uint64_t offset_, void* buf_, std::size_t size_, const task_type& t_)
+  {
+    if (!t_ || (op_ != kind::sync && buf_ == nullptr))
+      throw exc::illegal_argument();
+
+    {
+      std::unique_lock<std::mutex> l(m_state->lock);
+      m_state->queue.push_back(request { op_, offset_, buf_, size_, t_ });
+      ++m_state->pending;
+    }
+    m_state->cv.notify_one();
+  }
+
+  // transfers the whole request unless the end of file is reached or the
+  // operation fails; the partial transfers and interrupted calls are resumed
+  static void execute(handle fd_, const request& req_, completion& res_)
+  {
+    res_.buffer = req_.buffer;
+    res_.offset = req_.offset;
+
+    if (req_.op == kind::sync)
+    {
+      if (::fsync(fd_) != 0)
+        res_.error = std::error_code(errno, std::system_category());
+      return;
+    }
+
+    auto ptr = static_cast<uint8_t*>(req_.buffer);
+    while (res_.size < req_.size)
+    {
+      auto off = static_cast<off_t>(req_.offset + res_.size);
+      auto n = req_.op == kind::read
+          ? ::pread(fd_, ptr + res_.size, req_.size - res_.size, off)
+          : ::pwrite(fd_, ptr + res_.size, req_.size - res_.size, off);
+      if (n < 0)
+      {
+        if (errno == EINTR)
+          continue;
+        res_.error = std::error_code(errno, std::system_category());
+        return;
+      }
+      if (n == 0)
+        return;   // end of file
+      res_.size += static_cast<std::size_t>(n);
+    }
+  }
+
+  static void worker(std::shared_ptr<state> s_)
+  {
+    std::unique_lock<std::mutex> l(s_->lock);
+    while (true)
+    {
+      s_->cv.wait(l, [&s_] () { return s_->stopped || !s_->queue.empty(); });
+      if (s_->queue.empty())
+        return;   // stopped and drained
+
+      auto req = s_->queue.front();
+      s_->queue.pop_front();
+      l.unlock();
+
+      completion res;
+      execute(s_->fd, req, res);
+
+      l.lock();
+      --s_->pending;
+      l.unlock();
+
+      try { req.task.run(res); } catch (...) { /* noop */ }
+
+      l.lock();
+    }
+  }
+
+ private:
+  std::shared_ptr<state> m_state;
+};
+
+} // anonymous namespace
+
+std::shared_ptr<detail::itf::file> create_file(handle fd_, bool owner_, std::size_t threads_)
+{
+  if (threads_ == 0 || fd_ == invalid_handle)
+    throw exc::illegal_argument();
+  return std::make_shared<file>(fd_, owner_, threads_);
+}
+
+std::shared_ptr<detail::itf::file> create_file(const std::string& path_, int flags_, int mode_, std::size_t threads_)
+{
+  if (threads_ == 0)
+    throw exc::illegal_argument();
+
+  auto fd = ::open(path_.c_str(), flags_ | O_CLOEXEC, mode_);
+  if (fd < 0)
+    throw std::system_error(errno, std::system_category());
+
+  try
+  {
+    return std::make_shared<file>(fd, true, threads_);
+  }
+  catch (...)
+  {
+    ::close(fd);
+    throw;
+  }
+}
+
+#else
+
+std::shared_ptr<detail::itf::file> create_file(handle, bool, std::size_t)
+{
+  throw exc::operation_failed(cool::ng::error::errc::not_available);
+}
+
+std::shared_ptr<detail::itf::file> create_file(const std::string&, int, int, std::size_t)
+{
+  throw exc::operation_failed(cool::ng::error::errc::not_available);
+}
+
+#endif
+
+} // namespace impl
+
+// --------------------------------------------------------------------------
+// -----
+// ----- file
+// ------
+
+file::file(const std::string& path_, int flags_, int mode_, const options& opts_)
+{
+  m_impl = impl::create_file(path_, flags_, mode_, opts_.threads);
+}
+
+file::file(handle fd_, bool owner_, const options& opts_)
+{
+  m_impl = impl::create_file(fd_, owner_, opts_.threads);
+}
+
+void file::read(uint64_t offset_, void* buf_, std::size_t size_, const task_type& t_)
+{
+  if (!*this)
+    throw exc::empty_object();
+  m_impl->read(offset_, buf_, size_, t_);
+}
+
+void file::write(uint64_t offset_, const void* buf_, std::size_t size_, const task_type& t_)
+{
+  if (!*this)
+    throw exc::empty_object();
+  m_impl->write(offset_, buf_, size_, t_);
+}
+
+void file::sync(const task_type& t_)
+{
+  if (!*this)
+    throw exc::empty_object();
+  m_impl->sync(t_);
+}
+
+std::size_t file::pending() const
+{
+  if (!*this)
+    throw exc::empty_object();
+  return m_impl->pending();
+}
+
+handle file::native_handle() const
+{
+  if (!*this)
+    throw exc::empty_object();
+  return m_impl->native_handle();
+}
+
+file::operator bool() const
+{
+  return !!m_impl;
+}
+
+} } } // namespace
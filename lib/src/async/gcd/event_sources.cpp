@@ -23,14 +23,26 @@
 
 #include <unistd.h>
 #include <fcntl.h>
-#if defined(OSX_TARGET)
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/ioctl.h>
-#endif
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/uio.h>
+#include <signal.h>
+#include <pthread.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <errno.h>
 #include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <map>
+#include <algorithm>
+#include <chrono>
 #include "cool/ng/error.h"
 #include "cool/ng/exception.h"
 
@@ -64,6 +76,7 @@ timer::context::context(const timer::weak_ptr& t_)
 {
   auto tm_ = t_.lock();
   m_queue = ::dispatch_queue_create(tm_->name().c_str(), NULL);
+  executor::mark_queue(m_queue);
   m_source = ::dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0 , m_queue);
   m_source.cancel_handler(on_cancel);
   m_source.event_handler(on_event);
@@ -166,245 +179,1238 @@ std::shared_ptr<detail::itf::timer> create_timer(
   return impl_;
 }
 
-} // namespace impl
-
-
-
-
 // ==========================================================================
 // ======
 // ======
-// ====== Network event sources
+// ====== Timeout wheel
 // ======
 // ======
 // ==========================================================================
-namespace net { namespace impl {
 
-// --------------------------------------------------------------------------
-// --------------------------------------------------------------------------
-// --------------------------------------------------------------------------
-// --------------------------------------------------------------------------
-// --------------------------------------------------------------------------
-// -----
-// ----- server class implementation
-// -----
-// --------------------------------------------------------------------------
-// --------------------------------------------------------------------------
-// --------------------------------------------------------------------------
-// --------------------------------------------------------------------------
-// --------------------------------------------------------------------------
-server::context::context(const server::ptr& s_
-                       , const std::shared_ptr<async::impl::executor>& ex_
-                       , const ip::address& addr_
-                       , uint16_t port_)
-  : m_server(s_), m_handle(invalid_handle)
+// the wheel is never destroyed since the entries may still be armed at
+// the process exit
+timeout_wheel& timeout_wheel::instance()
 {
-  try
-  {
-    m_handle = ::socket(addr_.version() == ip::version::ipv4 ? AF_INET : AF_INET6, SOCK_STREAM, 0);
-    if (m_handle == ::cool::ng::net::invalid_handle)
-      throw exc::socket_failure();
-    {
-      const int enable = 1;
-      if (::setsockopt(m_handle, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&enable), sizeof(enable)) != 0)
-        throw exc::socket_failure();
-    }
-    {
-      struct sockaddr* addr;
-      std::size_t sz;
-      sockaddr_in  addr4;
-      sockaddr_in6 addr6;
+  static timeout_wheel* wheel = new timeout_wheel();
+  return *wheel;
+}
 
-      if (addr_.version() == ip::version::ipv4)
-      {
-        sz = sizeof(addr4);
-        addr = reinterpret_cast<struct sockaddr*>(&addr4);
-        std::memset(&addr4, 0, sizeof(addr4));
-        addr4.sin_family = AF_INET;
-        addr4.sin_addr = static_cast<in_addr>(addr_);
-        addr4.sin_port = ntohs(port_);
-      }
-      else
-      {
-        sz = sizeof(addr6);
-        addr = reinterpret_cast<struct sockaddr*>(&addr6);
-        std::memset(&addr6, 0, sizeof(addr6));
-        addr6.sin6_family = AF_INET6;
-        addr6.sin6_addr = static_cast<in6_addr>(addr_);
-        addr6.sin6_port = ntohs(port_);
-      }
+uint64_t timeout_wheel::now()
+{
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
 
-      if (::bind(m_handle, addr, sz) != 0)
-        throw exc::socket_failure();
-    }
+timeout_wheel::timeout_wheel()
+    : m_current(0)
+    , m_count(0)
+{
+  m_queue = ::dispatch_queue_create("si.digiverse.ng.cool.timeout-wheel", NULL);
+  executor::mark_queue(m_queue);
+  m_source = ::dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0 , m_queue);
+  m_source.event_handler(on_event);
+  m_source.context(this);
+  ::dispatch_source_set_timer(
+      m_source.source()
+    , ::dispatch_time(DISPATCH_TIME_NOW, tick * 1000000)
+    , tick * 1000000
+    , tick * 100000);
+}
 
-    if (::listen(m_handle, 10) != 0)
-      throw exc::socket_failure();
+void timeout_wheel::arm(const std::weak_ptr<entry>& e_, uint64_t tag_, uint64_t due_)
+{
+  uint64_t due = (due_ + tick - 1) / tick;
 
-    m_source = ::dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, m_handle, 0 , ex_->queue());
-    m_source.cancel_handler(on_cancel);
-    m_source.event_handler(on_event);
-    m_source.context(this);
-  }
-  catch (...)
-  {
-    m_source.destroy();
-    if (m_handle != invalid_handle)
-      ::close(m_handle);
-    throw;
-  }
+  std::unique_lock<std::mutex> l(m_lock);
+  if (m_count == 0)
+    m_current = now() / tick;
+  if (due <= m_current)
+    due = m_current + 1;
+
+  m_slots[due % slots].push_back({ e_, tag_, due });
+  if (m_count++ == 0)
+    m_source.resume();
 }
 
-void server::context::start_accept()
+void timeout_wheel::on_event(void* ctx)
 {
-  m_source.resume();
+  static_cast<timeout_wheel*>(ctx)->process_tick();
 }
 
-void server::context::stop_accept()
+// visits all slots between the last processed and the current tick, but at
+// most one revolution of the wheel if the timer was late; the items due in
+// the later revolutions remain in their slots
+void timeout_wheel::process_tick()
 {
-  m_source.suspend();
+  std::vector<item> fired;
+  {
+    std::unique_lock<std::mutex> l(m_lock);
+    uint64_t now_tick = now() / tick;
+    uint64_t last = std::min(now_tick, m_current + slots);
+
+    for (uint64_t t = m_current + 1; t <= last; ++t)
+    {
+      auto& slot = m_slots[t % slots];
+      for (std::size_t i = 0; i < slot.size(); )
+      {
+        if (slot[i].m_due <= now_tick)
+        {
+          fired.push_back(std::move(slot[i]));
+          slot[i] = std::move(slot.back());
+          slot.pop_back();
+          --m_count;
+        }
+        else
+        {
+          ++i;
+        }
+      }
+    }
+    if (now_tick > m_current)
+      m_current = now_tick;
+    if (m_count == 0)
+      m_source.suspend();
+  }
+
+  for (auto& i : fired)
+  {
+    auto e = i.m_entry.lock();
+    if (e)
+      try { e->expired(i.m_tag); } catch (...) { /* noop */ }
+  }
 }
 
-void server::context::shutdown()
+} // namespace impl
+
+// ==========================================================================
+// ======
+// ======
+// ====== Notifier event source
+// ======
+// ======
+// ==========================================================================
+
+namespace impl {
+
+notifier::context::context(const task_type& t_, const std::string& name_)
+    : m_task(t_)
 {
-  start_accept();
-  m_source.cancel();
+  m_queue = ::dispatch_queue_create(name_.c_str(), NULL);
+  executor::mark_queue(m_queue);
+  m_source = ::dispatch_source_create(DISPATCH_SOURCE_TYPE_DATA_ADD, 0, 0 , m_queue);
+  m_source.cancel_handler(on_cancel);
+  m_source.event_handler(on_event);
+  m_source.context(this);
 }
 
-void server::context::on_cancel(void* ctx)
+void notifier::context::on_cancel(void* ctx)
 {
   auto self = static_cast<context*>(ctx);
   self->m_source.release();
-
-  ::close(self->m_handle);
+  ::dispatch_release(self->m_queue);
 
   delete self;
 }
 
-void server::context::on_event(void* ctx)
+void notifier::context::on_event(void* ctx)
 {
   auto self = static_cast<context*>(ctx);
-  std::size_t size = self->m_source.get_data();
-
-  for (std::size_t i = 0; i < size; ++i)
+  try
   {
-    struct sockaddr_storage addr;
-    socklen_t len = sizeof(addr);
-    handle clt = accept(self->m_handle, reinterpret_cast<sockaddr*>(&addr), &len);
-
-    if (clt != invalid_handle)
-    {
-      ip::host_container address(addr);
-      uint16_t port = (static_cast<const ip::address&>(address).version() == ip::version::ipv4)
-         ? ntohs(reinterpret_cast<sockaddr_in*>(&addr)->sin_port)
-         : ntohs(reinterpret_cast<sockaddr_in6*>(&addr)->sin6_port);
-
-      self->m_server->process_accept(clt, address, port);
-    }
-    else
-    {
-      // TODO: error logic
-    }
+    self->m_task.run(static_cast<std::size_t>(self->m_source.get_data()));
   }
+  catch (...)
+  { /* noop */ }
 }
 
-// ---------------------------
-// server class implementation
-
-server::server(const std::shared_ptr<async::impl::executor>& ex_
-             , const cb::server::weak_ptr& cb_)
-  : named("si.digiverse.ng.cool.server")
-  , m_state(state::stopped)
+notifier::notifier(const task_type& t_)
+  : named("si.digiverse.ng.cool.notifier")
   , m_context(nullptr)
-  , m_handler(cb_)
-  , m_exec(ex_)
-{ /* noop */ }
+  , m_source(nullptr)
+  , m_task(t_)
+{
+  if (!m_task)
+    throw exc::illegal_argument();
+}
 
-server::~server()
-{ /* noop */ }
+notifier::~notifier()
+{
+  shutdown();
+  if (m_source != nullptr)
+    ::dispatch_release(m_source);
+}
 
-void server::initialize(const cool::ng::net::ip::address& addr_, uint16_t port_)
+// the notifier keeps its own reference to the dispatch source so that the
+// signals need not synchronize with the shutdown; merging the data into the
+// cancelled source has no effect
+void notifier::initialize()
 {
-  auto e = m_exec.lock();
-  if (!e)
-    throw exc::runner_not_available();
+  m_context = new context(m_task, name());
+  m_source = m_context->m_source.source();
+  ::dispatch_retain(m_source);
+}
 
-  m_context = new context(self().lock(), e, addr_, port_);
+// merging the data into the source neither allocates nor blocks, and the
+// data is accumulated even while the source is suspended
+void notifier::signal(std::size_t count_)
+{
+  if (count_ != 0)
+    ::dispatch_source_merge_data(m_source, count_);
 }
 
+void notifier::start()
+{
+  std::unique_lock<std::mutex> l(m_lock);
+  if (m_context != nullptr)
+    m_context->m_source.resume();
+}
 
-void server::start()
+void notifier::stop()
 {
-  state expect = state::stopped;
+  std::unique_lock<std::mutex> l(m_lock);
+  if (m_context != nullptr)
+    m_context->m_source.suspend();
+}
 
-  if (m_state.compare_exchange_strong(expect, state::starting))
-  {
-    m_context->start_accept();
-    expect = state::starting;
-    m_state.compare_exchange_strong(expect, state::accepting); // TODO: any action if it fails
+void notifier::shutdown()
+{
+  std::unique_lock<std::mutex> l(m_lock);
+  if (m_context == nullptr)
     return;
-  }
 
-  if (expect == state::accepting)  // was already accepting
-    return;
+  m_context->m_source.resume();
+  m_context->m_source.cancel();
+  m_context = nullptr;
+}
 
-  throw exc::invalid_state();
+// --- factory
+std::shared_ptr<detail::itf::notifier> create_notifier(const detail::itf::notifier::task_type& t_)
+{
+  auto impl_ = cool::ng::util::shared_new<notifier>(t_);
+  impl_->initialize();
+  return impl_;
 }
 
-void server::stop()
+} // namespace impl
+
+// ==========================================================================
+// ======
+// ======
+// ====== Signal event source
+// ======
+// ======
+// ==========================================================================
+
+namespace impl {
+
+namespace {
+
+#if defined(LINUX_TARGET)
+
+// On Linux libdispatch receives the signals through signalfd, which only
+// sees the signals that are blocked; the kernel discards the ignored signal
+// that is not blocked before signalfd gets to see it, and delivers the signal
+// that is neither ignored nor blocked to the thread that does not block it.
+// The signal is thus blocked in the thread that creates the first signal
+// source for it and, unless it was blocked before, unblocked in the same
+// thread once the last source for it is shut down. The disposition of the
+// signal is not changed.
+class disposition
 {
-  state expect = state::accepting;
+  struct entry
+  {
+    std::size_t m_count;
+    bool        m_unblock;   // the signal was not blocked before
+    pthread_t   m_thread;    // the thread that blocked the signal
+  };
 
-  if (m_state.compare_exchange_strong(expect, state::stopping))
+ public:
+  static void acquire(int signo_)
   {
-    m_context->stop_accept();
-    expect = state::stopping;
-    m_state.compare_exchange_strong(expect, state::stopped); // TODO: any action if it fails
-    return;
+    std::unique_lock<std::mutex> l(lock());
+    auto& e = table()[signo_];
+    if (e.m_count++ == 0)
+    {
+      sigset_t set;
+      sigset_t old;
+      ::sigemptyset(&set);
+      ::sigaddset(&set, signo_);
+      ::pthread_sigmask(SIG_BLOCK, &set, &old);
+      e.m_unblock = ::sigismember(&old, signo_) == 0;
+      e.m_thread = ::pthread_self();
+    }
   }
 
-  if (expect == state::stopped)  // was already accepting
-    return;
+  static void release(int signo_)
+  {
+    std::unique_lock<std::mutex> l(lock());
+    auto it = table().find(signo_);
+    if (it == table().end())
+      return;
+    if (--it->second.m_count == 0)
+    {
+      if (it->second.m_unblock && ::pthread_equal(it->second.m_thread, ::pthread_self()))
+      {
+        sigset_t set;
+        ::sigemptyset(&set);
+        ::sigaddset(&set, signo_);
+        ::pthread_sigmask(SIG_UNBLOCK, &set, nullptr);
+      }
+      table().erase(it);
+    }
+  }
 
-  throw exc::invalid_state();
-}
+ private:
+  static std::mutex& lock()
+  {
+    static std::mutex instance;
+    return instance;
+  }
+  static std::map<int, entry>& table()
+  {
+    static std::map<int, entry> instance;
+    return instance;
+  }
+};
 
-void server::shutdown()
-{
-  m_context->shutdown();
-}
+#else
 
-void server::process_accept(cool::ng::net::handle h_
-                          , const cool::ng::net::ip::address& addr_
-                          , uint16_t port_)
+// The default disposition of the signal is ignored while there are signal
+// sources for it, otherwise the signals that terminate the process by default
+// would do so before the dispatch source gets to see them. The original
+// disposition is restored once the last source for the signal is gone.
+class disposition
 {
-  auto cb = m_handler.lock();
+  struct entry
+  {
+    std::size_t      m_count;
+    struct sigaction m_action;
+  };
 
-  if (!cb || m_state != state::accepting)
+ public:
+  static void acquire(int signo_)
   {
-    // user handler no longer exists, close connection and be done
-    ::close(h_);
-    return;
+    std::unique_lock<std::mutex> l(lock());
+    auto& e = table()[signo_];
+    if (e.m_count++ == 0)
+    {
+      struct sigaction act;
+      std::memset(&act, 0, sizeof(act));
+      act.sa_handler = SIG_IGN;
+      ::sigemptyset(&act.sa_mask);
+      ::sigaction(signo_, &act, &e.m_action);
+    }
   }
 
-  try
+  static void release(int signo_)
   {
-    auto stream = cb->manufacture(addr_, port_);
-    stream.m_impl->set_handle(h_);
-    try { cb->on_connect(stream); } catch (...) { /* noop */ }
+    std::unique_lock<std::mutex> l(lock());
+    auto it = table().find(signo_);
+    if (it == table().end())
+      return;
+    if (--it->second.m_count == 0)
+    {
+      ::sigaction(signo_, &it->second.m_action, nullptr);
+      table().erase(it);
+    }
   }
-  catch (...)
+
+ private:
+  static std::mutex& lock()
   {
-    ::close(h_);
+    static std::mutex instance;
+    return instance;
+  }
+  static std::map<int, entry>& table()
+  {
+    static std::map<int, entry> instance;
+    return instance;
   }
+};
 
-}
+#endif
 
+} // anonymous namespace
+
+signal::context::context(int signo_, const task_type& t_, const std::string& name_)
+    : m_signo(signo_)
+    , m_task(t_)
+{
+  disposition::acquire(m_signo);
+  m_queue = ::dispatch_queue_create(name_.c_str(), NULL);
+  executor::mark_queue(m_queue);
+  m_source = ::dispatch_source_create(DISPATCH_SOURCE_TYPE_SIGNAL, m_signo, 0 , m_queue);
+  m_source.cancel_handler(on_cancel);
+  m_source.event_handler(on_event);
+  m_source.context(this);
+}
+
+void signal::context::on_cancel(void* ctx)
+{
+  auto self = static_cast<context*>(ctx);
+  self->m_source.release();
+  ::dispatch_release(self->m_queue);
+#if !defined(LINUX_TARGET)
+  // the signal must remain ignored until the source is gone
+  disposition::release(self->m_signo);
+#endif
+
+  delete self;
+}
+
+void signal::context::on_event(void* ctx)
+{
+  auto self = static_cast<context*>(ctx);
+  try
+  {
+    self->m_task.run(static_cast<std::size_t>(self->m_source.get_data()));
+  }
+  catch (...)
+  { /* noop */ }
+}
+
+signal::signal(int signo_, const task_type& t_)
+  : named("si.digiverse.ng.cool.signal")
+  , m_context(nullptr)
+  , m_signo(signo_)
+  , m_task(t_)
+{
+  if (!m_task || m_signo <= 0 || m_signo >= NSIG || m_signo == SIGKILL || m_signo == SIGSTOP)
+    throw exc::illegal_argument();
+}
+
+signal::~signal()
+{
+  shutdown();
+}
+
+void signal::initialize()
+{
+  m_context = new context(m_signo, m_task, name());
+}
+
+void signal::start()
+{
+  std::unique_lock<std::mutex> l(m_lock);
+  if (m_context != nullptr)
+    m_context->m_source.resume();
+}
+
+void signal::stop()
+{
+  std::unique_lock<std::mutex> l(m_lock);
+  if (m_context != nullptr)
+    m_context->m_source.suspend();
+}
+
+void signal::shutdown()
+{
+  std::unique_lock<std::mutex> l(m_lock);
+  if (m_context == nullptr)
+    return;
+
+  m_context->m_source.resume();
+  m_context->m_source.cancel();
+  m_context = nullptr;
+#if defined(LINUX_TARGET)
+  // the signal mask is per thread, thus it is restored by the calling thread
+  disposition::release(m_signo);
+#endif
+}
+
+// --- factory
+std::shared_ptr<detail::itf::signal> create_signal(int signo_, const detail::itf::signal::task_type& t_)
+{
+  auto impl_ = cool::ng::util::shared_new<signal>(signo_, t_);
+  impl_->initialize();
+  return impl_;
+}
+
+} // namespace impl
+
+// ==========================================================================
+// ======
+// ======
+// ====== File descriptor watcher
+// ======
+// ======
+// ==========================================================================
+
+namespace impl {
+
+// the last of the dispatch sources is gone only after the cancel handlers
+// of both ran, thus the descriptor may now be safely closed by either party
+watcher::handle_owner::~handle_owner()
+{
+  if (m_owner && m_handle != invalid_handle)
+    ::close(m_handle);
+  if (m_release)
+    m_release();
+}
+
+void watcher::context::on_cancel(void* ctx)
+{
+  auto self = static_cast<context*>(ctx);
+  self->m_source.release();
+
+  delete self;
+}
+
+void watcher::context::on_event(void* ctx)
+{
+  auto self = static_cast<context*>(ctx);
+  auto cb = self->m_handler.lock();
+  if (cb)
+    cb->on_ready(self->m_readiness, self->m_source.get_data());
+}
+
+watcher::watcher(const std::shared_ptr<executor>& ex_, const cb::watcher::weak_ptr& cb_)
+  : named("si.digiverse.ng.cool.watcher")
+  , m_executor(ex_)
+  , m_handler(cb_)
+  , m_rd(nullptr)
+  , m_wr(nullptr)
+{ /* noop */ }
+
+watcher::~watcher()
+{
+  shutdown();
+}
+
+void watcher::initialize(handle fd_, readiness r_, bool owner_, const std::function<void()>& release_)
+{
+  auto ex_ = m_executor.lock();
+  if (!ex_)
+    throw exc::runner_not_available();
+
+  // the descriptor is closed when the last of the dispatch sources is gone
+  auto h = std::make_shared<handle_owner>(fd_, owner_, release_);
+  auto dirs = static_cast<int>(r_);
+
+  if (dirs & static_cast<int>(readiness::readable))
+    m_rd = create_source(readiness::readable, h, ex_);
+
+  if (dirs & static_cast<int>(readiness::writable))
+    m_wr = create_source(readiness::writable, h, ex_);
+}
+
+watcher::context* watcher::create_source(
+    readiness r_
+  , const std::shared_ptr<handle_owner>& h_
+  , const std::shared_ptr<executor>& ex_)
+{
+  auto ctx = new context(r_, h_, m_handler);
+  ctx->m_source = ::dispatch_source_create(
+      r_ == readiness::readable ? DISPATCH_SOURCE_TYPE_READ : DISPATCH_SOURCE_TYPE_WRITE
+    , h_->m_handle
+    , 0
+    , ex_->queue());
+  ctx->m_source.cancel_handler(context::on_cancel);
+  ctx->m_source.event_handler(context::on_event);
+  ctx->m_source.context(ctx);
+
+  return ctx;
+}
+
+// the cancel handler only runs once the source is resumed; it releases the
+// source and deletes the context
+void watcher::cancel_source(context*& ctx_)
+{
+  if (ctx_ == nullptr)
+    return;
+
+  ctx_->m_source.resume();
+  ctx_->m_source.cancel();
+  ctx_ = nullptr;
+}
+
+void watcher::start(readiness r_)
+{
+  std::unique_lock<std::mutex> l(m_lock);
+  auto dirs = static_cast<int>(r_);
+
+  if (m_rd != nullptr && (dirs & static_cast<int>(readiness::readable)))
+    m_rd->m_source.resume();
+  if (m_wr != nullptr && (dirs & static_cast<int>(readiness::writable)))
+    m_wr->m_source.resume();
+}
+
+void watcher::stop(readiness r_)
+{
+  std::unique_lock<std::mutex> l(m_lock);
+  auto dirs = static_cast<int>(r_);
+
+  if (m_rd != nullptr && (dirs & static_cast<int>(readiness::readable)))
+    m_rd->m_source.suspend();
+  if (m_wr != nullptr && (dirs & static_cast<int>(readiness::writable)))
+    m_wr->m_source.suspend();
+}
+
+void watcher::shutdown()
+{
+  std::unique_lock<std::mutex> l(m_lock);
+
+  cancel_source(m_rd);
+  cancel_source(m_wr);
+}
+
+// --- factory
+std::shared_ptr<detail::itf::watcher> create_watcher(
+    const std::shared_ptr<runner>& r_
+  , handle fd_
+  , readiness readiness_
+  , bool owner_
+  , const cb::watcher::weak_ptr& cb_
+  , const std::function<void()>& release_)
+{
+  auto impl_ = cool::ng::util::shared_new<watcher>(r_->impl(), cb_);
+  impl_->initialize(fd_, readiness_, owner_, release_);
+  return impl_;
+}
+
+} // namespace impl
+
+
+
+
+// ==========================================================================
+// ======
+// ======
+// ====== Network event sources
+// ======
+// ======
+// ==========================================================================
+namespace net { namespace impl {
+
+namespace {
+
+// fills in the sockaddr_un structure for the local address and returns the
+// size of its used part; names in the abstract namespace start with the
+// null character and are not null terminated
+socklen_t make_sockaddr(const cool::ng::net::local::address& addr_, sockaddr_un& sa_)
+{
+  const auto& path = addr_.path();
+  if (path.empty())
+    throw exc::illegal_argument();
+
+  std::memset(&sa_, 0, sizeof(sa_));
+  sa_.sun_family = AF_UNIX;
+
+  if (addr_.is_abstract())
+  {
+#if defined(LINUX_TARGET)
+    if (path.size() + 1 > sizeof(sa_.sun_path))
+      throw exc::illegal_argument();
+    std::memcpy(sa_.sun_path + 1, path.data(), path.size());
+    return static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + 1 + path.size());
+#else
+    throw exc::operation_failed(cool::ng::error::errc::not_available);
+#endif
+  }
+
+  if (path.size() + 1 > sizeof(sa_.sun_path))
+    throw exc::illegal_argument();
+  std::memcpy(sa_.sun_path, path.data(), path.size());
+  return static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + path.size() + 1);
+}
+
+void set_option(handle h_, int level_, int name_, int value_)
+{
+  if (::setsockopt(h_, level_, name_, &value_, sizeof(value_)) != 0)
+    throw exc::socket_failure();
+}
+
+// applies the options that were set to the socket; the TCP options are
+// skipped for the local sockets
+void apply_options(handle h_, const cool::ng::async::net::socket_options& opts_)
+{
+  using option = cool::ng::async::net::socket_options::option;
+
+  if (opts_.empty())
+    return;
+
+  if (opts_.is_set(option::send_buffer))
+    set_option(h_, SOL_SOCKET, SO_SNDBUF, opts_.send_buffer());
+  if (opts_.is_set(option::receive_buffer))
+    set_option(h_, SOL_SOCKET, SO_RCVBUF, opts_.receive_buffer());
+  if (opts_.is_set(option::busy_poll))
+  {
+#if defined(LINUX_TARGET) && defined(SO_BUSY_POLL)
+    set_option(h_, SOL_SOCKET, SO_BUSY_POLL, opts_.busy_poll());
+#else
+    throw exc::operation_failed(cool::ng::error::errc::not_available);
+#endif
+  }
+  if (opts_.is_set(option::keep_alive))
+    set_option(h_, SOL_SOCKET, SO_KEEPALIVE, opts_.keep_alive() ? 1 : 0);
+
+  sockaddr_storage addr;
+  socklen_t len = sizeof(addr);
+  if (::getsockname(h_, reinterpret_cast<sockaddr*>(&addr), &len) != 0)
+    throw exc::socket_failure();
+  if (addr.ss_family != AF_INET && addr.ss_family != AF_INET6)
+    return;
+
+  if (opts_.is_set(option::no_delay))
+    set_option(h_, IPPROTO_TCP, TCP_NODELAY, opts_.no_delay() ? 1 : 0);
+  if (opts_.is_set(option::quick_ack))
+  {
+#if defined(LINUX_TARGET)
+    set_option(h_, IPPROTO_TCP, TCP_QUICKACK, opts_.quick_ack() ? 1 : 0);
+#else
+    throw exc::operation_failed(cool::ng::error::errc::not_available);
+#endif
+  }
+  if (opts_.is_set(option::cork))
+  {
+#if defined(LINUX_TARGET)
+    set_option(h_, IPPROTO_TCP, TCP_CORK, opts_.cork() ? 1 : 0);
+#else
+    set_option(h_, IPPROTO_TCP, TCP_NOPUSH, opts_.cork() ? 1 : 0);
+#endif
+  }
+  if (opts_.is_set(option::keep_alive) && opts_.keep_alive())
+  {
+    if (opts_.keep_alive_idle() > 0)
+#if defined(OSX_TARGET)
+      set_option(h_, IPPROTO_TCP, TCP_KEEPALIVE, opts_.keep_alive_idle());
+#else
+      set_option(h_, IPPROTO_TCP, TCP_KEEPIDLE, opts_.keep_alive_idle());
+#endif
+    if (opts_.keep_alive_interval() > 0)
+      set_option(h_, IPPROTO_TCP, TCP_KEEPINTVL, opts_.keep_alive_interval());
+    if (opts_.keep_alive_count() > 0)
+      set_option(h_, IPPROTO_TCP, TCP_KEEPCNT, opts_.keep_alive_count());
+  }
+}
+
+} // anonymous namespace
+
+// --------------------------------------------------------------------------
+// --------------------------------------------------------------------------
+// --------------------------------------------------------------------------
+// --------------------------------------------------------------------------
+// --------------------------------------------------------------------------
+// -----
+// ----- server class implementation
+// -----
+// --------------------------------------------------------------------------
+// --------------------------------------------------------------------------
+// --------------------------------------------------------------------------
+// --------------------------------------------------------------------------
+// --------------------------------------------------------------------------
+server::context::context(const server::ptr& s_
+                       , const std::shared_ptr<async::impl::executor>& ex_
+                       , const ip::address& addr_
+                       , uint16_t port_)
+  : m_server(s_), m_handle(invalid_handle)
+{
+  try
+  {
+    m_handle = ::socket(addr_.version() == ip::version::ipv4 ? AF_INET : AF_INET6, SOCK_STREAM, 0);
+    if (m_handle == ::cool::ng::net::invalid_handle)
+      throw exc::socket_failure();
+    {
+      const int enable = 1;
+      if (::setsockopt(m_handle, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&enable), sizeof(enable)) != 0)
+        throw exc::socket_failure();
+    }
+    {
+      struct sockaddr* addr;
+      std::size_t sz;
+      sockaddr_in  addr4;
+      sockaddr_in6 addr6;
+
+      if (addr_.version() == ip::version::ipv4)
+      {
+        sz = sizeof(addr4);
+        addr = reinterpret_cast<struct sockaddr*>(&addr4);
+        std::memset(&addr4, 0, sizeof(addr4));
+        addr4.sin_family = AF_INET;
+        addr4.sin_addr = static_cast<in_addr>(addr_);
+        addr4.sin_port = ntohs(port_);
+      }
+      else
+      {
+        sz = sizeof(addr6);
+        addr = reinterpret_cast<struct sockaddr*>(&addr6);
+        std::memset(&addr6, 0, sizeof(addr6));
+        addr6.sin6_family = AF_INET6;
+        addr6.sin6_addr = static_cast<in6_addr>(addr_);
+        addr6.sin6_port = ntohs(port_);
+      }
+
+      if (::bind(m_handle, addr, sz) != 0)
+        throw exc::socket_failure();
+    }
+
+    listen(ex_);
+  }
+  catch (...)
+  {
+    m_source.destroy();
+    if (m_handle != invalid_handle)
+      ::close(m_handle);
+    throw;
+  }
+}
+
+server::context::context(const server::ptr& s_
+                       , const std::shared_ptr<async::impl::executor>& ex_
+                       , const cool::ng::net::local::address& addr_)
+  : m_server(s_), m_handle(invalid_handle)
+{
+  try
+  {
+    sockaddr_un addr;
+    auto sz = make_sockaddr(addr_, addr);
+
+    m_handle = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (m_handle == ::cool::ng::net::invalid_handle)
+      throw exc::socket_failure();
+
+    if (::bind(m_handle, reinterpret_cast<sockaddr*>(&addr), sz) != 0)
+      throw exc::socket_failure();
+    if (!addr_.is_abstract())
+      m_path = addr_.path();
+
+    listen(ex_);
+  }
+  catch (...)
+  {
+    m_source.destroy();
+    if (m_handle != invalid_handle)
+      ::close(m_handle);
+    if (!m_path.empty())
+      ::unlink(m_path.c_str());
+    throw;
+  }
+}
+
+void server::context::listen(const std::shared_ptr<async::impl::executor>& ex_)
+{
+  if (::listen(m_handle, 10) != 0)
+    throw exc::socket_failure();
+
+  m_source = ::dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, m_handle, 0 , ex_->queue());
+  m_source.cancel_handler(on_cancel);
+  m_source.event_handler(on_event);
+  m_source.context(this);
+}
+
+void server::context::start_accept()
+{
+  m_source.resume();
+}
+
+void server::context::stop_accept()
+{
+  m_source.suspend();
+}
+
+void server::context::shutdown()
+{
+  start_accept();
+  m_source.cancel();
+}
+
+void server::context::on_cancel(void* ctx)
+{
+  auto self = static_cast<context*>(ctx);
+  self->m_source.release();
+
+  ::close(self->m_handle);
+  if (!self->m_path.empty())
+    ::unlink(self->m_path.c_str());
+
+  delete self;
+}
+
+void server::context::on_event(void* ctx)
+{
+  auto self = static_cast<context*>(ctx);
+  std::size_t size = self->m_source.get_data();
+
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    // at the connection limit the listen source is suspended and the
+    // remaining connection requests are left in the backlog
+    auto slot = self->m_server->acquire_connection();
+    if (!slot)
+      break;
+
+    struct sockaddr_storage addr;
+    socklen_t len = sizeof(addr);
+    handle clt = accept(self->m_handle, reinterpret_cast<sockaddr*>(&addr), &len);
+
+    if (clt != invalid_handle && addr.ss_family == AF_UNIX)
+    {
+      // local socket clients have no network address
+      self->m_server->process_accept(clt, ipv4::any, 0, slot);
+    }
+    else if (clt != invalid_handle)
+    {
+      ip::host_container address(addr);
+      uint16_t port = (static_cast<const ip::address&>(address).version() == ip::version::ipv4)
+         ? ntohs(reinterpret_cast<sockaddr_in*>(&addr)->sin_port)
+         : ntohs(reinterpret_cast<sockaddr_in6*>(&addr)->sin6_port);
+
+      self->m_server->process_accept(clt, address, port, slot);
+    }
+    else
+    {
+      // TODO: error logic
+    }
+  }
+}
+
+// ---------------------------
+// server class implementation
+
+server::server(const std::shared_ptr<async::impl::executor>& ex_
+             , const cb::server::weak_ptr& cb_)
+  : named("si.digiverse.ng.cool.server")
+  , m_state(state::stopped)
+  , m_context(nullptr)
+  , m_handler(cb_)
+  , m_exec(ex_)
+  , m_connections(0)
+  , m_max_connections(0)
+  , m_paused(false)
+  , m_draining(false)
+  , m_drain_id(0)
+{ /* noop */ }
+
+server::~server()
+{ /* noop */ }
+
+void server::initialize(const cool::ng::net::ip::address& addr_, uint16_t port_)
+{
+  auto e = m_exec.lock();
+  if (!e)
+    throw exc::runner_not_available();
+
+  m_context = new context(self().lock(), e, addr_, port_);
+}
+
+void server::initialize(const cool::ng::net::local::address& addr_)
+{
+  auto e = m_exec.lock();
+  if (!e)
+    throw exc::runner_not_available();
+
+  m_context = new context(self().lock(), e, addr_);
+}
+
+
+void server::start()
+{
+  {
+    std::unique_lock<std::mutex> l(m_conn_lock);
+    if (m_draining)
+      throw exc::invalid_state();
+  }
+
+  state expect = state::stopped;
+
+  if (m_state.compare_exchange_strong(expect, state::starting))
+  {
+    {
+      std::unique_lock<std::mutex> l(m_conn_lock);
+      m_context->start_accept();
+      m_paused = false;
+    }
+    expect = state::starting;
+    m_state.compare_exchange_strong(expect, state::accepting); // TODO: any action if it fails
+    return;
+  }
+
+  if (expect == state::accepting)  // was already accepting
+    return;
+
+  throw exc::invalid_state();
+}
+
+void server::stop()
+{
+  state expect = state::accepting;
+
+  if (m_state.compare_exchange_strong(expect, state::stopping))
+  {
+    {
+      std::unique_lock<std::mutex> l(m_conn_lock);
+      m_context->stop_accept();
+      m_paused = false;
+    }
+    expect = state::stopping;
+    m_state.compare_exchange_strong(expect, state::stopped); // TODO: any action if it fails
+    return;
+  }
+
+  if (expect == state::stopped)  // was already accepting
+    return;
+
+  throw exc::invalid_state();
+}
+
+void server::shutdown()
+{
+  // the context is gone once cancelled; the connection slots released
+  // afterwards must not touch it
+  std::unique_lock<std::mutex> l(m_conn_lock);
+  m_state = state::destroying;
+  m_context->shutdown();
+}
+
+void server::max_connections(std::size_t max_)
+{
+  std::unique_lock<std::mutex> l(m_conn_lock);
+  m_max_connections = max_;
+  if (m_paused && (m_max_connections == 0 || m_connections < m_max_connections))
+  {
+    m_paused = false;
+    if (m_state == state::accepting)
+      m_context->start_accept();
+  }
+}
+
+std::size_t server::connections() const
+{
+  std::unique_lock<std::mutex> l(m_conn_lock);
+  return m_connections;
+}
+
+void server::drain(const std::function<void()>& handler_, const std::chrono::milliseconds& grace_)
+{
+  auto ex_ = m_exec.lock();
+  if (!ex_)
+    throw exc::runner_not_available();
+
+  std::vector<std::shared_ptr<stream>> streams;
+  {
+    std::unique_lock<std::mutex> l(m_conn_lock);
+    if (m_draining || m_state == state::destroying)
+      throw exc::invalid_state();
+
+    m_context->stop_accept();
+    m_paused = false;
+    m_state = state::stopped;
+
+    m_draining = true;
+    m_drain_handler = handler_;
+    ++m_drain_id;
+
+    if (m_connections == 0)
+    {
+      complete_drain();
+      return;
+    }
+
+    for (auto slot : m_slots)
+    {
+      auto s = slot->m_stream.lock();
+      if (s)
+        streams.push_back(s);
+    }
+
+    if (grace_.count() > 0)
+      ::dispatch_after_f(
+          ::dispatch_time(DISPATCH_TIME_NOW, grace_.count() * 1000000)
+        , ex_->queue()
+        , new std::pair<server::weak_ptr, uint64_t>(self(), m_drain_id)
+        , on_drain_timeout);
+  }
+
+  for (auto& s : streams)
+    s->quiesce(false);
+}
+
+void server::on_drain_timeout(void* ctx)
+{
+  std::unique_ptr<std::pair<server::weak_ptr, uint64_t>> arg(static_cast<std::pair<server::weak_ptr, uint64_t>*>(ctx));
+  auto self = arg->first.lock();
+  if (!self)
+    return;
+
+  std::vector<std::shared_ptr<stream>> streams;
+  {
+    std::unique_lock<std::mutex> l(self->m_conn_lock);
+    if (!self->m_draining || self->m_drain_id != arg->second)
+      return;   // drain completed in time
+
+    for (auto slot : self->m_slots)
+    {
+      auto s = slot->m_stream.lock();
+      if (s)
+        streams.push_back(s);
+    }
+  }
+
+  for (auto& s : streams)
+    s->quiesce(true);
+}
+
+// must be called with m_conn_lock held
+void server::complete_drain()
+{
+  m_draining = false;
+  auto ex_ = m_exec.lock();
+  if (ex_ && m_drain_handler)
+    ::dispatch_async_f(ex_->queue(), new std::function<void()>(std::move(m_drain_handler)), on_drained);
+  m_drain_handler = std::function<void()>();
+}
+
+void server::on_drained(void* ctx)
+{
+  std::unique_ptr<std::function<void()>> handler(static_cast<std::function<void()>*>(ctx));
+  try { (*handler)(); } catch (...) { /* noop */ }
+}
+
+connection_slot::~connection_slot()
+{
+  auto s = m_server.lock();
+  if (s)
+    s->release_connection(this);
+}
+
+// called from the listen source's event handler; suspending the source from
+// its own handler only prevents the subsequent events
+std::shared_ptr<connection_slot> server::acquire_connection()
+{
+  std::unique_lock<std::mutex> l(m_conn_lock);
+  if (m_draining)
+    return std::shared_ptr<connection_slot>();
+
+  if (m_max_connections != 0 && m_connections >= m_max_connections)
+  {
+    if (!m_paused && m_state != state::destroying)
+    {
+      m_paused = true;
+      m_context->stop_accept();
+    }
+    return std::shared_ptr<connection_slot>();
+  }
+
+  ++m_connections;
+  l.unlock();
+
+  try
+  {
+    return std::make_shared<connection_slot>(self());
+  }
+  catch (...)
+  {
+    release_connection(nullptr);
+    throw;
+  }
+}
+
+void server::release_connection(connection_slot* slot_)
+{
+  std::unique_lock<std::mutex> l(m_conn_lock);
+  m_slots.erase(slot_);
+  --m_connections;
+  if (m_paused && (m_max_connections == 0 || m_connections < m_max_connections))
+  {
+    m_paused = false;
+    if (m_state == state::accepting)
+      m_context->start_accept();
+  }
+  if (m_draining && m_connections == 0)
+    complete_drain();
+}
+
+void server::options(const cool::ng::async::net::socket_options& opts_)
+{
+  using option = cool::ng::async::net::socket_options::option;
+
+  // buffer sizes set on the listening socket are inherited by the accepted
+  // sockets before the connection is established
+  cool::ng::async::net::socket_options listen_opts;
+  if (opts_.is_set(option::send_buffer))
+    listen_opts.send_buffer(opts_.send_buffer());
+  if (opts_.is_set(option::receive_buffer))
+    listen_opts.receive_buffer(opts_.receive_buffer());
+  apply_options(m_context->m_handle, listen_opts);
+
+  std::unique_lock<std::mutex> l(m_opt_lock);
+  m_options.merge(opts_);
+}
+
+void server::process_accept(cool::ng::net::handle h_
+                          , const cool::ng::net::ip::address& addr_
+                          , uint16_t port_
+                          , const std::shared_ptr<connection_slot>& slot_)
+{
+  auto cb = m_handler.lock();
+
+  if (!cb || m_state != state::accepting)
+  {
+    // user handler no longer exists, close connection and be done
+    ::close(h_);
+    return;
+  }
+
+  try
+  {
+    cool::ng::async::net::socket_options opts;
+    {
+      std::unique_lock<std::mutex> l(m_opt_lock);
+      opts = m_options;
+    }
+    apply_options(h_, opts);
+  }
+  catch (const cool::ng::exception::base& e)
+  {
+    ::close(h_);
+    try { cb->on_event(e.code()); } catch (...) { /* noop */ }
+    return;
+  }
+
+  int cpu = -1;
+#if defined(LINUX_TARGET) && defined(SO_INCOMING_CPU)
+  {
+    socklen_t len = sizeof(cpu);
+    if (::getsockopt(h_, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) != 0)
+      cpu = -1;
+  }
+#endif
+
+  try
+  {
+    auto stream = cb->manufacture(addr_, port_, cpu);
+
+    // the stream owns the handle from here on, even if set_handle fails
+    auto h = h_;
+    h_ = cool::ng::net::invalid_handle;
+    stream.m_impl->set_handle(h, slot_);
+
+    bool draining;
+    std::shared_ptr<impl::stream> impl_;
+    {
+      std::unique_lock<std::mutex> l(m_conn_lock);
+      m_slots.insert(slot_.get());
+      draining = m_draining;
+      impl_ = slot_->m_stream.lock();
+    }
+
+    try { cb->on_connect(stream); } catch (...) { /* noop */ }
+    if (draining && impl_)
+      impl_->quiesce(false);
+  }
+  catch (...)
+  {
+    if (h_ != cool::ng::net::invalid_handle)
+      ::close(h_);
+  }
+
+}
+
+// --------------------------------------------------------------------------
+// --------------------------------------------------------------------------
 // --------------------------------------------------------------------------
 // --------------------------------------------------------------------------
 // --------------------------------------------------------------------------
-// --------------------------------------------------------------------------
-// --------------------------------------------------------------------------
 // -----
 // ----- stream class  implementation
 // -----
@@ -423,6 +1429,19 @@ stream::stream(const std::weak_ptr<async::impl::executor>& ex_
     , m_reader(nullptr)
     , m_writer(nullptr)
     , m_wr_busy(false)
+    , m_wr_data(nullptr)
+    , m_wr_size(0)
+    , m_wr_pos(0)
+    , m_tmo_connect(0)
+    , m_tmo_read(0)
+    , m_tmo_write(0)
+    , m_tmo_due(0)
+    , m_conn_start(0)
+    , m_last_read(0)
+    , m_wr_since(0)
+    , m_timed_out(false)
+    , m_quiesce(false)
+    , m_quiesce_force(false)
 { /* noop */ }
 
 stream::~stream()
@@ -439,24 +1458,54 @@ void stream::initialize(const cool::ng::net::ip::address& addr_
   connect(addr_, port_);
 }
 
-void stream::set_handle(cool::ng::net::handle h_)
+void stream::initialize(const cool::ng::net::local::address& addr_
+                      , void* buf_
+                      , std::size_t bufsz_)
 {
+  m_size = bufsz_;
+  m_buf = buf_;
 
-  m_state = state::connected;
+  connect(addr_);
+}
 
-#if defined(OSX_TARGET)
-  // on OSX accepted socket does not preserve non-blocking properties of the listen socket
+void stream::set_handle(cool::ng::net::handle h_, const std::shared_ptr<void>& slot_)
+{
+  // only the server passes the slots to its streams
+  if (slot_)
+    static_cast<connection_slot*>(slot_.get())->m_stream = self();
+  m_quiesce = false;
+  m_quiesce_force = false;
+
+  // the socket is closed when the event sources, if created, and the local
+  // owner are all gone, thus never before the sources' cancel handlers ran
+  auto sock = std::make_shared<socket_owner>(h_);
+  sock->m_slot = slot_;
+
+  attach_socket(sock);
+
+  // accepted socket does not preserve non-blocking properties of the listen
+  // socket, neither on OSX nor on Linux; the blocking write would stall the
+  // runner's queue until the peer reads all pending data
   int option = 1;
   if (ioctl(h_, FIONBIO, &option) != 0)
     throw exc::socket_failure();
-#endif
 
-  auto rh = ::dup(h_);
-  if (rh == cool::ng::net::invalid_handle)
-    throw exc::socket_failure();
+  m_state = state::connected;
+  try
+  {
+    create_write_source(sock, false);
+    create_read_source(sock, m_buf, m_size);
+  }
+  catch (...)
+  {
+    context* aux;
+    cancel_write_source(aux);
+    m_state = state::disconnected;
+    throw;
+  }
 
-  create_write_source(h_, false);
-  create_read_source(rh, m_buf, m_size);
+  m_last_read = async::impl::timeout_wheel::now();
+  schedule_timeout();
 }
 
 void stream::initialize(void* buf_, std::size_t bufsz_)
@@ -465,14 +1514,36 @@ void stream::initialize(void* buf_, std::size_t bufsz_)
   m_buf = buf_;
 }
 
-void stream::create_write_source(cool::ng::net::handle h_, bool  start_)
+stream::socket_owner::~socket_owner()
+{
+  if (m_handle != ::cool::ng::net::invalid_handle)
+    ::close(m_handle);
+}
+
+// the options set later apply to this socket for as long as it is open
+void stream::attach_socket(const std::shared_ptr<socket_owner>& s_)
+{
+  std::unique_lock<std::mutex> l(m_opt_lock);
+  apply_options(s_->m_handle, m_options);
+  m_socket = s_;
+}
+
+void stream::create_write_source(const std::shared_ptr<socket_owner>& s_, bool  start_)
 {
   auto ex_ = m_executor.lock();
   if (!ex_)
     throw exc::runner_not_available();
 
+#if defined(SO_NOSIGPIPE)
+  // the failed write to the disconnected peer must not raise SIGPIPE; on
+  // Linux the writes use MSG_NOSIGNAL instead
+  int option = 1;
+  ::setsockopt(s_->m_handle, SOL_SOCKET, SO_NOSIGPIPE, &option, sizeof(option));
+#endif
+
   auto writer = new context;
-  writer->m_handle = h_;
+  writer->m_handle = s_->m_handle;
+  writer->m_socket = s_;
   writer->m_stream = self().lock();
 
   // prepare write event source
@@ -487,7 +1558,7 @@ void stream::create_write_source(cool::ng::net::handle h_, bool  start_)
     writer->m_source.resume();
 }
 
-void stream::create_read_source(cool::ng::net::handle h_, void* buf_, std::size_t bufsz_)
+void stream::create_read_source(const std::shared_ptr<socket_owner>& s_, void* buf_, std::size_t bufsz_)
 {
   auto ex_ = m_executor.lock();
   if (!ex_)
@@ -505,7 +1576,8 @@ void stream::create_read_source(cool::ng::net::handle h_, void* buf_, std::size_
     reader->m_rd_is_mine = true;
   }
 
-  reader->m_handle = h_;
+  reader->m_handle = s_->m_handle;
+  reader->m_socket = s_;
   reader->m_stream = self().lock();
 
   // prepare read event source
@@ -533,6 +1605,16 @@ bool stream::cancel_write_source(stream::context*& writer)
   return true;
 }
 
+// the cancelled source must not remain suspended or its cancel handler will
+// never run; cancel_write_source() detaches the context before it resumes the
+// source, hence the source is resumed again if the suspend raced with it
+void stream::suspend_write_source(context* ctx)
+{
+  ctx->m_source.suspend();
+  if (m_writer.load() != ctx)
+    ctx->m_source.resume();
+}
+
 bool stream::cancel_read_source(stream::rd_context*& reader)
 {
   reader = m_reader.load();
@@ -588,13 +1670,180 @@ void stream::disconnect()
     throw exc::operation_failed(cool::ng::error::errc::concurrency_problem);
 }
 
+void stream::options(const cool::ng::async::net::socket_options& opts_)
+{
+  std::unique_lock<std::mutex> l(m_opt_lock);
+  m_options.merge(opts_);
+
+  // the event sources may be cancelled concurrently, but the socket remains
+  // open for as long as the owner is held
+  auto sock = m_socket.lock();
+  if (sock)
+    apply_options(sock->m_handle, opts_);
+}
+
+void stream::set_timeouts(const cool::ng::async::net::timeouts& t_)
+{
+  if (t_.connect.count() < 0 || t_.read_idle.count() < 0 || t_.write_stall.count() < 0)
+    throw exc::illegal_argument();
+
+  m_tmo_connect = t_.connect.count();
+  m_tmo_read = t_.read_idle.count();
+  m_tmo_write = t_.write_stall.count();
+
+  auto now = async::impl::timeout_wheel::now();
+  m_last_read = now;
+  m_wr_since = m_wr_busy ? now : 0;
+  schedule_timeout();
+}
+
+// arms the timeout wheel only if the next deadline is earlier than the one
+// already armed; the later deadlines are picked up by process_timeout()
+// when the armed one expires
+void stream::schedule_timeout()
+{
+  uint64_t due = 0;
+  auto earliest = [&due](uint64_t start_, uint64_t timeout_)
+  {
+    if (start_ != 0 && timeout_ != 0 && (due == 0 || start_ + timeout_ < due))
+      due = start_ + timeout_;
+  };
+
+  switch (static_cast<state>(m_state))
+  {
+    case state::connecting:
+      earliest(m_conn_start, m_tmo_connect);
+      break;
+
+    case state::connected:
+      earliest(m_last_read, m_tmo_read);
+      earliest(m_wr_since, m_tmo_write);
+      break;
+
+    default:
+      return;
+  }
+  if (due == 0)
+    return;
+
+  auto armed = m_tmo_due.load();
+  do
+  {
+    if (armed != 0 && armed <= due)
+      return;
+  }
+  while (!m_tmo_due.compare_exchange_weak(armed, due));
+
+  async::impl::timeout_wheel::instance().arm(self(), due, due);
+}
+
+// called from the wheel's queue; the deadline serves as a tag and the stale
+// expirations do not match the currently armed deadline
+void stream::expired(uint64_t tag_)
+{
+  uint64_t expect = tag_;
+  if (!m_tmo_due.compare_exchange_strong(expect, 0))
+    return;
+
+  auto ex_ = m_executor.lock();
+  auto self_ = self().lock();
+  if (!ex_ || !self_)
+    return;
+  ::dispatch_async_f(ex_->queue(), new stream::ptr(self_), on_timeout);
+}
+
+void stream::on_timeout(void* ctx)
+{
+  std::unique_ptr<stream::ptr> self(static_cast<stream::ptr*>(ctx));
+  (*self)->process_timeout();
+}
+
+void stream::process_timeout()
+{
+  auto now = async::impl::timeout_wheel::now();
+
+  switch (static_cast<state>(m_state))
+  {
+    case state::connecting:
+    {
+      uint64_t start = m_conn_start;
+      uint64_t tmo = m_tmo_connect;
+      if (start != 0 && tmo != 0 && now >= start + tmo)
+      {
+        // on_wr_cancel will report the failure
+        m_timed_out = true;
+        try { disconnect(); } catch (...) { m_timed_out = false; }
+        return;
+      }
+      break;
+    }
+
+    case state::connected:
+    {
+      auto cb = m_handler.lock();
+
+      uint64_t last = m_last_read;
+      uint64_t tmo = m_tmo_read;
+      if (last != 0 && tmo != 0 && now >= last + tmo && m_last_read.compare_exchange_strong(last, 0))
+      {
+        if (cb)
+          try { cb->on_event(detail::oob_event::timeout, error::make_error_code(error::errc::read_idle)); } catch (...) { }
+      }
+
+      last = m_wr_since;
+      tmo = m_tmo_write;
+      if (last != 0 && tmo != 0 && now >= last + tmo && m_wr_since.compare_exchange_strong(last, 0))
+      {
+        if (cb)
+          try { cb->on_event(detail::oob_event::timeout, error::make_error_code(error::errc::write_stalled)); } catch (...) { }
+      }
+      break;
+    }
+
+    default:
+      return;
+  }
+
+  schedule_timeout();
+}
+
 void stream::connect(const cool::ng::net::ip::address& addr_, uint16_t port_)
+{
+  if (addr_.version() == ip::version::ipv4)
+  {
+    sockaddr_in addr4;
+    std::memset(&addr4, 0, sizeof(addr4));
+    addr4.sin_family = AF_INET;
+    addr4.sin_addr = static_cast<in_addr>(addr_);
+    addr4.sin_port = htons(port_);
+    connect(AF_INET, reinterpret_cast<sockaddr*>(&addr4), sizeof(addr4));
+  }
+  else
+  {
+    sockaddr_in6 addr6;
+    std::memset(&addr6, 0, sizeof(addr6));
+    addr6.sin6_family = AF_INET6;
+    addr6.sin6_addr = static_cast<in6_addr>(addr_);
+    addr6.sin6_port = htons(port_);
+    connect(AF_INET6, reinterpret_cast<sockaddr*>(&addr6), sizeof(addr6));
+  }
+}
+
+void stream::connect(const cool::ng::net::local::address& addr_)
+{
+  sockaddr_un addr;
+  auto size = make_sockaddr(addr_, addr);
+  connect(AF_UNIX, reinterpret_cast<sockaddr*>(&addr), size);
+}
+
+void stream::connect(int domain_, const sockaddr* addr_, socklen_t size_)
 {
   if (m_size == 0)
     throw exc::illegal_argument();
 
 
   cool::ng::net::handle handle = cool::ng::net::invalid_handle;
+  std::shared_ptr<socket_owner> sock;
 
   if (m_state != state::disconnected)
     throw exc::invalid_state();
@@ -602,16 +1851,13 @@ void stream::connect(const cool::ng::net::ip::address& addr_, uint16_t port_)
   try
   {
 #if defined(LINUX_TARGET)
-    handle = addr_.version() == ip::version::ipv6 ?
-          ::socket(AF_INET6, SOCK_STREAM | SOCK_NONBLOCK, 0)
-        : ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    handle = ::socket(domain_, SOCK_STREAM | SOCK_NONBLOCK, 0);
 #else
-    handle = addr_.version() == ip::version::ipv6 ?
-        ::socket(AF_INET6, SOCK_STREAM, 0)
-      : ::socket(AF_INET, SOCK_STREAM, 0);
+    handle = ::socket(domain_, SOCK_STREAM, 0);
 #endif
     if (handle == cool::ng::net::invalid_handle)
       throw exc::socket_failure();
+    sock = std::make_shared<socket_owner>(handle);
 
 #if !defined(LINUX_TARGET)
     int option = 1;
@@ -619,50 +1865,33 @@ void stream::connect(const cool::ng::net::ip::address& addr_, uint16_t port_)
       throw exc::socket_failure();
 #endif
 
-    create_write_source(handle);
+    attach_socket(sock);
+    create_write_source(sock);
 
-    sockaddr* p;
-    std::size_t size;
-    sockaddr_in addr4;
-    sockaddr_in6 addr6;
-    if (addr_.version() == ip::version::ipv4)
-    {
-      addr4.sin_family = AF_INET;
-      addr4.sin_addr = static_cast<in_addr>(addr_);
-      addr4.sin_port = htons(port_);
-      p = reinterpret_cast<sockaddr*>(&addr4);
-      size = sizeof(addr4);
-    }
-    else
-    {
-      addr6.sin6_family = AF_INET6;
-      addr6.sin6_addr = static_cast<in6_addr>(addr_);
-      addr6.sin6_port = htons(port_);
-      p = reinterpret_cast<sockaddr*>(&addr6);
-      size = sizeof(addr6);
-    }
+    m_timed_out = false;
+    m_quiesce = false;
+    m_quiesce_force = false;
+    m_conn_start = async::impl::timeout_wheel::now();
 
     // Linux may sometimes do immediate connect with connect returning 0.
     // Nevertheless, we will consider this as async connect and let the
-    // on_write event handler handle this in an usual way.
+    // on_write event handler handle this in an usual way. Note that the
+    // local sockets always connect immediately or fail with EAGAIN if the
+    // peer's backlog is full.
     m_state = state::connecting;
-    if (::connect(handle, p, size) == -1)
+    if (::connect(handle, addr_, size_) == -1)
     {
       if (errno != EINPROGRESS)
         throw exc::socket_failure();
     }
+    schedule_timeout();
   }
   catch (...)
   {
+    // the socket is closed when the write source, if created, and the
+    // local owner are both gone
     context* prev;
-    if (cancel_write_source(prev))
-    {
-      if (prev == nullptr)
-      {
-        if (handle != cool::ng::net::invalid_handle)
-          ::close(handle);
-      }
-    }
+    cancel_write_source(prev);
 
     m_state = state::disconnected;
 
@@ -676,16 +1905,19 @@ void stream::on_wr_cancel(void* ctx)
 {
   auto self = static_cast<context*>(ctx);
   self->m_source.release();
-  ::close(self->m_handle);
 
   self->m_stream->m_writer = nullptr;
+  self->m_stream->clear_write_queue();
 
   state expect = state::connecting;
   if (self->m_stream->m_state.compare_exchange_strong(expect, state::disconnected))
   {
+    auto code = self->m_stream->m_timed_out.exchange(false)
+        ? error::errc::timed_out
+        : error::errc::request_aborted;
     auto cb = self->m_stream->m_handler.lock();
     if (cb)
-      try { cb->on_event(detail::oob_event::failure, error::make_error_code(error::errc::request_aborted)); } catch (...) { /* noop */ }
+      try { cb->on_event(detail::oob_event::failure, error::make_error_code(code)); } catch (...) { /* noop */ }
   }
   delete self;
 }
@@ -695,8 +1927,6 @@ void stream::on_rd_cancel(void* ctx)
   auto self = static_cast<rd_context*>(ctx);
   self->m_source.release();
 
-  ::close(self->m_handle);
-
   if (self->m_rd_is_mine)
     delete [] static_cast<uint8_t*>(self->m_rd_data);
   self->m_stream->m_reader = nullptr;
@@ -717,6 +1947,13 @@ void stream::on_rd_event(void* ctx)
 
   size = ::read(self->m_handle, self->m_rd_data, self->m_rd_size);
   auto buf = self->m_rd_data;
+
+  // the read idle timeout is lazily re-armed, except after it was reported
+  if (self->m_stream->m_tmo_read != 0)
+  {
+    if (self->m_stream->m_last_read.exchange(async::impl::timeout_wheel::now()) == 0)
+      self->m_stream->schedule_timeout();
+  }
   try
   {
     auto aux = self->m_stream->m_handler.lock();
@@ -771,46 +2008,226 @@ void stream::on_wr_event(void* ctx)
       self->m_stream->process_connecting_event(self, size);
       break;
 
-    case state::connected:
-      self->m_stream->process_write_event(self, size);
-      break;
+    case state::connected:
+      self->m_stream->process_write_event(self, size);
+      break;
+
+    case state::disconnected:
+    case state::disconnecting:
+      break;
+  }
+}
+
+void stream::write(const void* data, std::size_t size)
+{
+  if (m_state != state::connected)
+    throw exc::invalid_state();
+
+  bool expected = false;
+  if (!m_wr_busy.compare_exchange_strong(expected, true))
+    throw exc::operation_failed(cool::ng::error::errc::resource_busy);
+
+  m_wr_data = static_cast<const uint8_t*>(data);
+  m_wr_size = size;
+  m_wr_pos = 0;
+  if (m_tmo_write != 0)
+  {
+    m_wr_since = async::impl::timeout_wheel::now();
+    schedule_timeout();
+  }
+  m_writer.load()->m_source.resume();
+}
+
+// payload writes are queued while the stream is busy writing; the busy flag
+// is only cleared by the write completion when there is nothing left in the
+// queue, hence both are manipulated under the lock
+void stream::write(const cool::ng::async::net::payload& data_)
+{
+  if (!data_ || data_.size() == 0)
+    throw exc::illegal_argument();
+  if (m_state != state::connected)
+    throw exc::invalid_state();
+
+  {
+    std::unique_lock<std::mutex> l(m_wr_lock);
+    bool expected = false;
+    if (!m_wr_busy.compare_exchange_strong(expected, true))
+    {
+      m_wr_queue.push_back(data_);
+      return;
+    }
+  }
+
+  m_wr_payload = data_;
+  m_wr_data = static_cast<const uint8_t*>(data_.data());
+  m_wr_size = data_.size();
+  m_wr_pos = 0;
+  if (m_tmo_write != 0)
+  {
+    m_wr_since = async::impl::timeout_wheel::now();
+    schedule_timeout();
+  }
+  m_writer.load()->m_source.resume();
+}
+
+// the payloads queued behind the current write are gathered into a single
+// writev() call, thus one write event may complete several of them
+void stream::process_write_event(context* ctx, std::size_t size)
+{
+  // cancel_write_source() resumes the source to cancel it, which may deliver
+  // the write event while there is nothing to write
+  if (!m_wr_busy)
+  {
+    suspend_write_source(ctx);
+    return;
+  }
+
+  // only the write event handler removes the payloads from the queue, thus
+  // the gathered payloads stay in place after the lock is released
+  ::iovec iov[write_batch];
+  int count = 1;
+  iov[0].iov_base = const_cast<uint8_t*>(m_wr_data + m_wr_pos);
+  iov[0].iov_len = m_wr_size - m_wr_pos;
+  {
+    std::unique_lock<std::mutex> l(m_wr_lock);
+    for (auto it = m_wr_queue.begin(); it != m_wr_queue.end() && count < write_batch; ++it, ++count)
+    {
+      iov[count].iov_base = const_cast<void*>(it->data());
+      iov[count].iov_len = it->size();
+    }
+  }
+
+  ::msghdr msg;
+  std::memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = count;
+#if defined(MSG_NOSIGNAL)
+  auto res = ::sendmsg(ctx->m_handle, &msg, MSG_NOSIGNAL);
+#else
+  auto res = ::sendmsg(ctx->m_handle, &msg, 0);
+#endif
+  if (res < 0)
+  {
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+      fail_write(ctx, errno);
+    return;   // retry on the next event
+  }
+
+  // any progress re-arms the write stall timeout
+  if (m_tmo_write != 0 && res > 0)
+  {
+    if (m_wr_since.exchange(async::impl::timeout_wheel::now()) == 0)
+      schedule_timeout();
+  }
+
+  std::size_t left = res;
+  while (true)
+  {
+    auto n = std::min(left, m_wr_size - m_wr_pos);
+    m_wr_pos += n;
+    left -= n;
+
+    if (m_wr_pos < m_wr_size || !complete_write(ctx))
+      break;
+  }
+}
+
+// the write failed with the error other than EAGAIN or EINTR; the level
+// triggered write source would keep firing, hence it is suspended and the
+// pending payloads are discarded before the error is reported
+void stream::fail_write(context* ctx, int err)
+{
+  clear_write_queue();
+  m_wr_since = 0;
+  suspend_write_source(ctx);
+
+  auto aux = m_handler.lock();
+  if (aux)
+    try { aux->on_event(detail::oob_event::failure, std::error_code(err, std::system_category())); } catch (...) { }
+}
+
+// completes the current write and makes the next queued payload, if any,
+// the current write; returns true if there is more to write
+bool stream::complete_write(context* ctx)
+{
+  // release the reference to completed payload only after the user was notified
+  auto data = m_wr_data;
+  auto data_size = m_wr_size;
+  auto completed = std::move(m_wr_payload);
+  m_wr_payload = cool::ng::async::net::payload();
+
+  bool more = false;
+  {
+    std::unique_lock<std::mutex> l(m_wr_lock);
+    if (m_wr_queue.empty())
+    {
+      m_wr_since = 0;
+      m_wr_busy = false;
+    }
+    else
+    {
+      m_wr_payload = std::move(m_wr_queue.front());
+      m_wr_queue.pop_front();
+      m_wr_data = static_cast<const uint8_t*>(m_wr_payload.data());
+      m_wr_size = m_wr_payload.size();
+      m_wr_pos = 0;
+      more = true;
+    }
+  }
+  if (!more)
+    suspend_write_source(ctx);
+
+  auto aux = m_handler.lock();
+  if (aux)
+  {
+    try { aux->on_write(data, data_size); } catch (...) { }
+  }
+
+  if (!more && m_quiesce)
+    close_quiesced();
+
+  return more;
+}
+
+void stream::quiesce(bool force_)
+{
+  m_quiesce = true;
+  if (force_)
+    m_quiesce_force = true;
 
-    case state::disconnected:
-    case state::disconnecting:
-      break;
-  }
+  // evaluated in the stream's queue to serialize with the write events
+  auto ex_ = m_executor.lock();
+  auto self_ = self().lock();
+  if (!ex_ || !self_)
+    return;
+  ::dispatch_async_f(ex_->queue(), new stream::ptr(self_), on_quiesce);
 }
 
-void stream::write(const void* data, std::size_t size)
+void stream::on_quiesce(void* ctx)
+{
+  std::unique_ptr<stream::ptr> self(static_cast<stream::ptr*>(ctx));
+  if ((*self)->m_quiesce_force || !(*self)->m_wr_busy)
+    (*self)->close_quiesced();
+}
+
+void stream::close_quiesced()
 {
   if (m_state != state::connected)
-    throw exc::invalid_state();
+    return;
 
-  bool expected = false;
-  if (!m_wr_busy.compare_exchange_strong(expected, true))
-    throw exc::operation_failed(cool::ng::error::errc::resource_busy);
+  try { disconnect(); } catch (...) { return; }
 
-  m_wr_data = static_cast<const uint8_t*>(data);
-  m_wr_size = size;
-  m_wr_pos = 0;
-  m_writer.load()->m_source.resume();
+  auto aux = m_handler.lock();
+  if (aux)
+    try { aux->on_event(detail::oob_event::disconnect, no_error()); } catch (...) { }
 }
 
-void stream::process_write_event(context* ctx, std::size_t size)
+void stream::clear_write_queue()
 {
-  std::size_t res = ::write(ctx->m_handle, m_wr_data + m_wr_pos, m_wr_size - m_wr_pos);
-  m_wr_pos += res;
-
-  if (m_wr_pos >= m_wr_size)
-  {
-    ctx->m_source.suspend();
-    m_wr_busy = false;
-    auto aux = m_handler.lock();
-    if (aux)
-    {
-      try { aux->on_write(m_wr_data, m_wr_size); } catch (...) { }
-    }
-  }
+  std::unique_lock<std::mutex> l(m_wr_lock);
+  m_wr_queue.clear();
+  m_wr_payload = cool::ng::async::net::payload();
+  m_wr_busy = false;
 }
 
 // - Despite both OSX and Linux supporting O_NDELAY flag to fcntl call, this
@@ -843,7 +2260,7 @@ void stream::process_connecting_event(context* ctx, std::size_t size)
 {
   try
   {
-    ctx->m_source.suspend();
+    suspend_write_source(ctx);
 
   #if defined(LINUX_TARGET)
     if (size != 0)
@@ -854,14 +2271,12 @@ void stream::process_connecting_event(context* ctx, std::size_t size)
       throw exc::runtime_fault(error::errc::request_failed);
     }
 
-    // connect succeeded - create reader context and start reader
-    // !! must dup because Linux wouldn't have read/write on same fd
-    auto aux_h = ::dup(ctx->m_handle);
-    if (aux_h == cool::ng::net::invalid_handle)
-      throw exc::socket_failure();
-
-    create_read_source(aux_h, m_buf, m_size);
+    // connect succeeded - create reader context on the same socket and
+    // start reader
+    create_read_source(ctx->m_socket, m_buf, m_size);
     m_state = state::connected;
+    m_last_read = async::impl::timeout_wheel::now();
+    schedule_timeout();
 
     auto aux = m_handler.lock();
     if (aux)
@@ -913,6 +2328,546 @@ void stream::shutdown()
   }
 }
 
-} } } } }
+} } // namespace net::impl
+
+// ==========================================================================
+// ======
+// ======
+// ====== Interprocess communication event sources
+// ======
+// ======
+// ==========================================================================
+namespace ipc { namespace impl {
+
+namespace {
+
+const uint32_t    ipc_magic   = 0x434f4f4c;
+const uint32_t    ipc_version = 1;
+const uint64_t    ipc_skip    = ~static_cast<uint64_t>(0);   // rest of the ring is unused
+const std::size_t ipc_align   = sizeof(uint64_t);
+
+// messages are stored in the ring as 8 byte size followed by the data,
+// padded to 8 bytes; messages never wrap around the end of the ring
+inline std::size_t record_size(std::size_t size_)
+{
+  return sizeof(uint64_t) + ((size_ + ipc_align - 1) & ~(ipc_align - 1));
+}
+
+inline std::string shm_path(const std::string& name_)
+{
+  return "/" + name_;
+}
+
+// the fifos are placed into TMPDIR, which must thus be the same for both
+// sides of the channel
+inline std::string fifo_path(const std::string& name_, int side_)
+{
+  auto dir = std::getenv("TMPDIR");
+  std::string path = dir != nullptr && *dir != '\0' ? dir : "/tmp";
+  if (path.back() != '/')
+    path += '/';
+  return path + name_ + (side_ == 0 ? ".ipc0" : ".ipc1");
+}
+
+// the fifo path is predictable, hence it must not be a symbolic link and the
+// fifo must belong to the effective user
+int open_fifo(const std::string& path_)
+{
+  int fd = ::open(path_.c_str(), O_RDWR | O_NONBLOCK | O_NOFOLLOW);
+  if (fd < 0)
+    throw exc::system_error();
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || !S_ISFIFO(st.st_mode) || st.st_uid != ::geteuid())
+  {
+    ::close(fd);
+    throw exc::operation_failed(cool::ng::error::errc::request_failed);
+  }
+  return fd;
+}
+
+// the side of the channel is held by the process with the given pid; the
+// side left attached by the process that terminated is free
+inline bool holder_alive(uint32_t pid_)
+{
+  return pid_ != 0 && (::kill(static_cast<pid_t>(pid_), 0) == 0 || errno != ESRCH);
+}
+
+} // anonymous namespace
+
+// --------------------------------------------------------------------------
+// -----
+// ----- shared memory layout
+// -----
+// Each side is the producer of one ring and the consumer of the other. The
+// producer's and the consumer's indices are on separate cache lines. The
+// indices grow monotonically and are taken modulo capacity. The consumer
+// that runs out of messages sets the m_rd_waiting flag and goes to sleep;
+// the producer only signals the wake up if it finds the flag set. The same
+// applies to producer waiting for the free space and m_wr_waiting flag.
+struct channel::ring
+{
+  alignas(64) std::atomic<uint64_t> m_head;       // written by producer
+  alignas(64) std::atomic<uint64_t> m_tail;       // written by consumer
+  alignas(64) std::atomic<uint32_t> m_rd_waiting; // consumer waits for data
+              std::atomic<uint32_t> m_wr_waiting; // producer waits for space
+};
+
+struct channel::segment
+{
+  uint32_t              m_magic;
+  uint32_t              m_version;
+  uint64_t              m_capacity;
+  std::atomic<uint32_t> m_attached[2];   // pid of the attached process, 0 if none
+  ring                  m_ring[2];    // ring i is written by side i
+
+  uint8_t* data(int side_)
+  {
+    return reinterpret_cast<uint8_t*>(this + 1) + side_ * m_capacity;
+  }
+};
+
+// --------------------------------------------------------------------------
+// -----
+// ----- channel class implementation
+// -----
+channel::channel(const std::weak_ptr<async::impl::executor>& ex_
+               , const net::impl::cb::stream::weak_ptr& cb_)
+  : named("si.digiverse.ng.cool.channel")
+  , m_executor(ex_)
+  , m_handler(cb_)
+  , m_side(0)
+  , m_owner(false)
+  , m_attached(false)
+  , m_segment(nullptr)
+  , m_size(0)
+  , m_capacity(0)
+  , m_peer_bell(-1)
+  , m_context(nullptr)
+  , m_closed(false)
+  , m_connected(false)
+  , m_corrupt(false)
+  , m_wr_busy(false)
+  , m_wr_data(nullptr)
+  , m_wr_size(0)
+{ /* noop */ }
+
+channel::~channel()
+{ /* noop */ }
+
+void channel::initialize(const std::string& name_, mode mode_, std::size_t capacity_)
+{
+  if (name_.empty() || name_.find('/') != std::string::npos)
+    throw exc::illegal_argument();
+
+  auto ex = m_executor.lock();
+  if (!ex)
+    throw exc::runner_not_available();
+
+  m_name = name_;
+  m_side = mode_ == mode::create ? 0 : 1;
+
+  int fd = -1;
+  context* ctx = nullptr;
+
+  try
+  {
+    if (mode_ == mode::create)
+    {
+      std::size_t page = ::sysconf(_SC_PAGESIZE);
+      m_capacity = (std::max(capacity_, page) + page - 1) / page * page;
+      m_size = sizeof(segment) + 2 * m_capacity;
+
+      fd = ::shm_open(shm_path(m_name).c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+      if (fd < 0)
+        throw exc::system_error();
+      m_owner = true;
+
+      if (::ftruncate(fd, m_size) != 0)
+        throw exc::system_error();
+
+      // shared memory is created anew, any fifos left over are stale
+      for (int i = 0; i < 2; ++i)
+      {
+        ::unlink(fifo_path(m_name, i).c_str());
+        if (::mkfifo(fifo_path(m_name, i).c_str(), 0600) != 0)
+          throw exc::system_error();
+      }
+    }
+    else
+    {
+      fd = ::shm_open(shm_path(m_name).c_str(), O_RDWR, 0);
+      if (fd < 0)
+        throw exc::system_error();
+
+      struct stat st;
+      if (::fstat(fd, &st) != 0)
+        throw exc::system_error();
+      m_size = st.st_size;
+      if (m_size < sizeof(segment))
+        throw exc::operation_failed(cool::ng::error::errc::request_failed);
+    }
+
+    auto addr = ::mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED)
+      throw exc::system_error();
+    ::close(fd);
+    fd = -1;
+
+    if (mode_ == mode::create)
+    {
+      m_segment = new (addr) segment();
+      m_segment->m_capacity = m_capacity;
+      m_segment->m_version = ipc_version;
+      for (auto& r : m_segment->m_ring)
+        r.m_rd_waiting = 1;   // nobody reads yet, wake up on first message
+      std::atomic_thread_fence(std::memory_order_release);
+      m_segment->m_magic = ipc_magic;
+    }
+    else
+    {
+      m_segment = static_cast<segment*>(addr);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (m_segment->m_magic != ipc_magic || m_segment->m_version != ipc_version
+          || m_size != sizeof(segment) + 2 * m_segment->m_capacity)
+        throw exc::operation_failed(cool::ng::error::errc::request_failed);
+      m_capacity = m_segment->m_capacity;
+    }
+
+    {
+      uint32_t pid = ::getpid();
+      uint32_t expect = m_segment->m_attached[m_side].load();
+      do
+      {
+        if (holder_alive(expect))
+          throw exc::operation_failed(cool::ng::error::errc::resource_busy);
+      }
+      while (!m_segment->m_attached[m_side].compare_exchange_weak(expect, pid));
+      m_attached = true;
+    }
+
+    // fifos are opened for reading and writing so that neither open blocks
+    // nor the writes fail while the other side is not there
+    ctx = new context;
+    ctx->m_handle = -1;
+    ctx->m_handle = open_fifo(fifo_path(m_name, m_side));
+    m_peer_bell = open_fifo(fifo_path(m_name, 1 - m_side));
+
+    ctx->m_channel = self().lock();
+    ctx->m_source = ::dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, ctx->m_handle, 0 , ex->queue());
+    ctx->m_source.cancel_handler(on_cancel);
+    ctx->m_source.event_handler(on_event);
+    ctx->m_source.context(ctx);
+  }
+  catch (...)
+  {
+    if (fd >= 0)
+      ::close(fd);
+    if (ctx != nullptr)
+    {
+      if (ctx->m_handle >= 0)
+        ::close(ctx->m_handle);
+      delete ctx;
+    }
+    cleanup();
+    throw;
+  }
+
+  m_context = ctx;
+  ctx->m_source.resume();
+
+  // wake up both sides - this side to pick up the peer's state and any
+  // messages already waiting, and the peer to learn about this side
+  char c = 0;
+  if (::write(ctx->m_handle, &c, 1) < 0)
+  { /* noop - fifo is full, wake up is pending anyway */ }
+  ring_peer();
+}
+
+void channel::cleanup()
+{
+  if (m_peer_bell >= 0)
+    ::close(m_peer_bell);
+  m_peer_bell = -1;
+
+  if (m_segment != nullptr)
+  {
+    if (m_attached)
+      m_segment->m_attached[m_side] = 0;
+    ::munmap(m_segment, m_size);
+  }
+  m_segment = nullptr;
+
+  if (m_owner)
+  {
+    ::shm_unlink(shm_path(m_name).c_str());
+    for (int i = 0; i < 2; ++i)
+      ::unlink(fifo_path(m_name, i).c_str());
+  }
+}
+
+void channel::shutdown()
+{
+  bool expect = false;
+  if (!m_closed.compare_exchange_strong(expect, true))
+    return;
+
+  m_segment->m_attached[m_side] = 0;
+  m_attached = false;
+  ring_peer();
+
+  auto ctx = m_context.exchange(nullptr);
+  if (ctx != nullptr)
+  {
+    ctx->m_source.resume();
+    ctx->m_source.cancel();
+  }
+}
+
+void channel::on_cancel(void* ctx)
+{
+  auto self = static_cast<context*>(ctx);
+  self->m_source.release();
+  ::close(self->m_handle);
+  self->m_channel->cleanup();
+
+  delete self;
+}
+
+void channel::on_event(void* ctx)
+{
+  auto self = static_cast<context*>(ctx);
+  self->m_channel->process_event(self);
+}
+
+void channel::on_post(void* ctx)
+{
+  std::unique_ptr<std::function<void()>> f(static_cast<std::function<void()>*>(ctx));
+  try { (*f)(); } catch (...) { /* noop */ }
+}
+
+void channel::post(const std::function<void()>& f_)
+{
+  auto ex = m_executor.lock();
+  if (ex)
+    ::dispatch_async_f(ex->queue(), new std::function<void()>(f_), on_post);
+}
+
+void channel::ring_peer()
+{
+  char c = 0;
+  if (::write(m_peer_bell, &c, 1) < 0)
+  { /* noop - fifo is full, wake up is pending anyway */ }
+}
+
+void channel::process_event(context* ctx)
+{
+  // consume all wake-ups, they are merged
+  char buf[64];
+  while (::read(ctx->m_handle, buf, sizeof(buf)) > 0)
+    ;
+
+  if (m_closed)
+    return;
+
+  auto cb = m_handler.lock();
+
+  bool peer = holder_alive(m_segment->m_attached[1 - m_side].load());
+  if (m_connected.exchange(peer) != peer && cb)
+  {
+    try
+    {
+      cb->on_event(peer ? net::detail::oob_event::connect : net::detail::oob_event::disconnect, no_error());
+    }
+    catch (...)
+    { /* noop */ }
+  }
+
+  process_read();
+
+  const void* data;
+  std::size_t size;
+  bool done;
+  {
+    std::unique_lock<std::mutex> l(m_wr_lock);
+    data = m_wr_data;
+    size = m_wr_size;
+    done = flush_write();
+  }
+  if (done && cb)
+    try { cb->on_write(data, size); } catch (...) { /* noop */ }
+}
+
+// The ring is written by the peer process, thus neither its indices nor
+// the sizes of the records are trusted; the record that does not fit between
+// its position and the end of the ring, or between the consumer's and the
+// producer's index, renders the ring corrupt.
+void channel::process_read()
+{
+  if (m_corrupt)
+    return;
+
+  auto& r = m_segment->m_ring[1 - m_side];
+  auto base = m_segment->data(1 - m_side);
+  auto cb = m_handler.lock();
+
+  uint64_t tail = r.m_tail.load(std::memory_order_relaxed);
+  for ( ; ; )
+  {
+    uint64_t head = r.m_head.load(std::memory_order_acquire);
+    if (head - tail > m_capacity)
+    {
+      fail_read();
+      return;
+    }
+
+    while (tail != head)
+    {
+      std::size_t pos = tail % m_capacity;
+      uint64_t avail = head - tail;
+      if (pos % ipc_align != 0 || avail < sizeof(uint64_t))
+      {
+        fail_read();
+        return;
+      }
+
+      uint64_t size = *reinterpret_cast<const uint64_t*>(base + pos);
+      if (size == ipc_skip)
+      {
+        if (m_capacity - pos > avail)
+        {
+          fail_read();
+          return;
+        }
+        tail += m_capacity - pos;
+        continue;
+      }
+      if (size > m_capacity - pos - sizeof(uint64_t) || record_size(size) > avail)
+      {
+        fail_read();
+        return;
+      }
+
+      if (cb)
+      {
+        void* buf = base + pos + sizeof(uint64_t);
+        std::size_t sz = size;
+        try { cb->on_read(buf, sz); } catch (...) { /* noop */ }
+      }
+      tail += record_size(size);
+      r.m_tail.store(tail, std::memory_order_release);
+    }
+
+    // announce the sleep, then check again to close the race with producer
+    r.m_rd_waiting.store(1);
+    if (r.m_head.load() == tail)
+      break;
+    r.m_rd_waiting.store(0);
+  }
+
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (r.m_wr_waiting.load() != 0 && r.m_wr_waiting.exchange(0) != 0)
+    ring_peer();
+}
+
+// stops reading from the corrupt ring and reports the failure
+void channel::fail_read()
+{
+  m_corrupt = true;
+
+  auto cb = m_handler.lock();
+  if (cb)
+  {
+    try
+    {
+      cb->on_event(net::detail::oob_event::failure, std::make_error_code(std::errc::bad_message));
+    }
+    catch (...)
+    { /* noop */ }
+  }
+}
+
+bool channel::copy_to_ring(const void* data_, std::size_t size_)
+{
+  auto& r = m_segment->m_ring[m_side];
+  auto base = m_segment->data(m_side);
+
+  uint64_t head = r.m_head.load(std::memory_order_relaxed);
+  uint64_t tail = r.m_tail.load(std::memory_order_acquire);
+  std::size_t rec = record_size(size_);
+  std::size_t pos = head % m_capacity;
+  std::size_t contig = m_capacity - pos;
+  std::size_t need = rec <= contig ? rec : contig + rec;
+
+  if (m_capacity - (head - tail) < need)
+    return false;
+
+  if (rec > contig)
+  {
+    *reinterpret_cast<uint64_t*>(base + pos) = ipc_skip;
+    head += contig;
+    pos = 0;
+  }
+  *reinterpret_cast<uint64_t*>(base + pos) = size_;
+  std::memcpy(base + pos + sizeof(uint64_t), data_, size_);
+  r.m_head.store(head + rec);
+
+  if (r.m_rd_waiting.load() != 0 && r.m_rd_waiting.exchange(0) != 0)
+    ring_peer();
+  return true;
+}
+
+// must be called with m_wr_lock held
+bool channel::flush_write()
+{
+  if (m_wr_data == nullptr)
+    return false;
+
+  if (!copy_to_ring(m_wr_data, m_wr_size))
+  {
+    // announce the wait, then check again to close the race with consumer
+    m_segment->m_ring[m_side].m_wr_waiting.store(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!copy_to_ring(m_wr_data, m_wr_size))
+      return false;
+  }
+
+  m_wr_data = nullptr;
+  m_wr_busy = false;
+  return true;
+}
+
+void channel::write(const void* data_, std::size_t size_)
+{
+  if (m_closed)
+    throw exc::invalid_state();
+  if (data_ == nullptr || size_ == 0 || record_size(size_) > m_capacity / 2)
+    throw exc::illegal_argument();
+
+  bool expected = false;
+  if (!m_wr_busy.compare_exchange_strong(expected, true))
+    throw exc::operation_failed(cool::ng::error::errc::resource_busy);
+
+  bool done;
+  {
+    std::unique_lock<std::mutex> l(m_wr_lock);
+    m_wr_data = data_;
+    m_wr_size = size_;
+    done = flush_write();
+  }
 
+  // completion is always reported from the runner, as with streams
+  if (done)
+  {
+    auto self_ = self().lock();
+    post([self_, data_, size_] ()
+      {
+        auto cb = self_->m_handler.lock();
+        if (cb)
+          cb->on_write(data_, size_);
+      }
+    );
+  }
+}
 
+} } } } } // namespace
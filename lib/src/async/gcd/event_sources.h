@@ -27,11 +27,20 @@
 #include <atomic>
 #include <memory>
 #include <functional>
-
+#include <mutex>
+#include <deque>
+#include <string>
+#include <vector>
+#include <set>
+#include <chrono>
+
+#include <sys/socket.h>
 #include <dispatch/dispatch.h>
 #include "cool/ng/bases.h"
 #include "cool/ng/ip_address.h"
+#include "cool/ng/local_address.h"
 #include "cool/ng/async/task.h"
+#include "cool/ng/async/net/stream.h"
 #include "cool/ng/impl/async/event_sources_types.h"
 
 #include "executor.h"
@@ -181,6 +190,231 @@ class timer : public cool::ng::util::named
   task_type                      m_task;
 };
 
+// Process-wide hashed timing wheel used to supervise timeouts of many event
+// sources with a single dispatch timer. The timer ticks every ten milliseconds
+// and is suspended while there is nothing armed. The wheel holds weak
+// references to its entries; the arms are one-shot and cannot be disarmed,
+// the entries are expected to ignore the stale expirations by their tag.
+class timeout_wheel
+{
+ public:
+  class entry
+  {
+   public:
+    virtual ~entry() { /* noop */ }
+    virtual void expired(uint64_t tag_) = 0;
+  };
+
+ public:
+  static timeout_wheel& instance();
+  // milliseconds on the monotonic clock
+  static uint64_t now();
+
+  void arm(const std::weak_ptr<entry>& e_, uint64_t tag_, uint64_t due_);
+
+ private:
+  struct item
+  {
+    std::weak_ptr<entry> m_entry;
+    uint64_t             m_tag;
+    uint64_t             m_due;   // in ticks
+  };
+
+  static const uint64_t    tick = 10;    // milliseconds
+  static const std::size_t slots = 512;
+
+  timeout_wheel();
+  static void on_event(void* ctx);
+  void process_tick();
+
+ private:
+  std::mutex        m_lock;
+  std::vector<item> m_slots[slots];
+  uint64_t          m_current;   // last processed tick
+  std::size_t       m_count;     // number of armed items
+  dispatch_queue_t  m_queue;
+  dispatch_source   m_source;
+};
+
+} // namespace impl
+
+// ==========================================================================
+// ======
+// ======
+// ====== Notifier event source
+// ======
+// ======
+// ==========================================================================
+
+namespace impl {
+
+// The signals are merged into the data of the DATA_ADD dispatch source, which
+// runs the task with the accumulated count from the notifier's own queue.
+class notifier : public cool::ng::util::named
+               , public detail::itf::notifier
+               , public cool::ng::util::self_aware<notifier>
+{
+  using task_type = detail::itf::notifier::task_type;
+
+  struct context
+  {
+    context(const task_type& t_, const std::string& name_);
+
+    static void on_event(void* ctx);
+    static void on_cancel(void* ctx);
+
+    task_type            m_task;
+    dispatch_source      m_source;
+    dispatch_queue_t     m_queue;
+  };
+
+ public:
+  notifier(const task_type& t_);
+  ~notifier();
+
+  void initialize();
+  // detail::itf::notifier
+  void signal(std::size_t count_) override;
+  void start() override;
+  void stop() override;
+  void shutdown() override;
+  const std::string& name() const override
+  {
+    return named::name();
+  }
+
+ private:
+  std::mutex          m_lock;
+  context*            m_context;
+  ::dispatch_source_t m_source;
+  task_type           m_task;
+};
+
+} // namespace impl
+
+// ==========================================================================
+// ======
+// ======
+// ====== Signal event source
+// ======
+// ======
+// ==========================================================================
+
+namespace impl {
+
+// The deliveries of the signal are counted by the SIGNAL dispatch source,
+// which runs the task with the count from the signal object's own queue.
+class signal : public cool::ng::util::named
+             , public detail::itf::signal
+             , public cool::ng::util::self_aware<signal>
+{
+  using task_type = detail::itf::signal::task_type;
+
+  struct context
+  {
+    context(int signo_, const task_type& t_, const std::string& name_);
+
+    static void on_event(void* ctx);
+    static void on_cancel(void* ctx);
+
+    int                  m_signo;
+    task_type            m_task;
+    dispatch_source      m_source;
+    dispatch_queue_t     m_queue;
+  };
+
+ public:
+  signal(int signo_, const task_type& t_);
+  ~signal();
+
+  void initialize();
+  // detail::itf::signal
+  void start() override;
+  void stop() override;
+  void shutdown() override;
+  const std::string& name() const override
+  {
+    return named::name();
+  }
+
+ private:
+  std::mutex  m_lock;
+  context*    m_context;
+  int         m_signo;
+  task_type   m_task;
+};
+
+} // namespace impl
+
+// ==========================================================================
+// ======
+// ======
+// ====== File descriptor watcher
+// ======
+// ======
+// ==========================================================================
+
+namespace impl {
+
+// Watches the readiness of an arbitrary file descriptor through a pair of
+// dispatch sources, one per direction, that run on the runner's queue.
+class watcher : public cool::ng::util::named
+              , public detail::itf::watcher
+              , public cool::ng::util::self_aware<watcher>
+{
+  struct handle_owner
+  {
+    handle_owner(cool::ng::net::handle h_, bool owner_, const std::function<void()>& release_)
+        : m_handle(h_), m_owner(owner_), m_release(release_)
+    { /* noop */ }
+    ~handle_owner();
+
+    cool::ng::net::handle m_handle;
+    bool                  m_owner;
+    std::function<void()> m_release;   // called once the descriptor is released
+  };
+
+  struct context
+  {
+    context(readiness r_, const std::shared_ptr<handle_owner>& h_, const cb::watcher::weak_ptr& cb_)
+        : m_readiness(r_), m_handle(h_), m_handler(cb_)
+    { /* noop */ }
+
+    static void on_event(void* ctx);
+    static void on_cancel(void* ctx);
+
+    readiness                     m_readiness;
+    std::shared_ptr<handle_owner> m_handle;
+    cb::watcher::weak_ptr         m_handler;
+    dispatch_source               m_source;
+  };
+
+ public:
+  watcher(const std::shared_ptr<executor>& ex_, const cb::watcher::weak_ptr& cb_);
+  ~watcher();
+
+  void initialize(cool::ng::net::handle fd_, readiness r_, bool owner_, const std::function<void()>& release_);
+  // detail::itf::watcher
+  void start(readiness r_) override;
+  void stop(readiness r_) override;
+  void shutdown() override;
+  const std::string& name() const override
+  {
+    return named::name();
+  }
+
+ private:
+  context* create_source(readiness r_, const std::shared_ptr<handle_owner>& h_, const std::shared_ptr<executor>& ex_);
+  static void cancel_source(context*& ctx_);
+
+ private:
+  std::mutex               m_lock;
+  std::weak_ptr<executor>  m_executor;
+  cb::watcher::weak_ptr    m_handler;
+  context*                 m_rd;
+  context*                 m_wr;
+};
+
 } // namespace impl
 
 // ==========================================================================
@@ -192,7 +426,23 @@ class timer : public cool::ng::util::named
 // ==========================================================================
 namespace net { namespace impl {
 
-class server : public async::detail::itf::startable
+class server;
+class stream;
+
+// An open connection accepted by the server. The stream keeps its slot until
+// the socket is closed, and the server tracks the slots of the accepted
+// streams to reach them when draining.
+struct connection_slot
+{
+  explicit connection_slot(const std::weak_ptr<server>& s_) : m_server(s_)
+  { /* noop */ }
+  ~connection_slot();
+
+  std::weak_ptr<server> m_server;
+  std::weak_ptr<stream> m_stream;
+};
+
+class server : public detail::itf::server
              , public cool::ng::util::named
              , public cool::ng::util::self_aware<server>
 {
@@ -204,7 +454,11 @@ class server : public async::detail::itf::startable
           , const std::shared_ptr<async::impl::executor>& ex_
           , const cool::ng::net::ip::address& addr_
           , uint16_t port_);
+    context(const server::ptr& s_
+          , const std::shared_ptr<async::impl::executor>& ex_
+          , const cool::ng::net::local::address& addr_);
 
+    void listen(const std::shared_ptr<async::impl::executor>& ex_);
     void start_accept();
     void stop_accept();
     void shutdown();
@@ -215,6 +469,7 @@ class server : public async::detail::itf::startable
     server::ptr             m_server;
     dispatch_source         m_source;
     ::cool::ng::net::handle m_handle;
+    std::string             m_path;    // filesystem path of the local socket, if any
   };
 
  public:
@@ -224,23 +479,47 @@ class server : public async::detail::itf::startable
 
   void initialize(const cool::ng::net::ip::address& addr_
                 , uint16_t port_);
+  void initialize(const cool::ng::net::local::address& addr_);
 
   // startable interface
   void start() override;
   void stop() override;
   void shutdown() override;
   const std::string& name() const override { return named::name(); }
+  // server interface
+  void options(const cool::ng::async::net::socket_options& opts_) override;
+  void max_connections(std::size_t max_) override;
+  std::size_t connections() const override;
+  void drain(const std::function<void()>& handler_, const std::chrono::milliseconds& grace_) override;
 
  private:
+  friend struct connection_slot;
+  std::shared_ptr<connection_slot> acquire_connection();
+  void release_connection(connection_slot* slot_);
+  void complete_drain();
+  static void on_drain_timeout(void* ctx);
+  static void on_drained(void* ctx);
   void process_accept(cool::ng::net::handle h_
                     , const cool::ng::net::ip::address& addr_
-                    , uint16_t port_);
+                    , uint16_t port_
+                    , const std::shared_ptr<connection_slot>& slot_);
 
  private:
   std::atomic<state>   m_state;
   context*             m_context;
   cb::server::weak_ptr m_handler;
   std::weak_ptr<async::impl::executor> m_exec;
+  std::mutex                           m_opt_lock;  // protects socket options
+  cool::ng::async::net::socket_options m_options;   // for accepted connections
+
+  mutable std::mutex m_conn_lock;   // protects connection count and accept pausing
+  std::size_t        m_connections;
+  std::size_t        m_max_connections;
+  bool               m_paused;      // accepting suspended due to connection limit
+  bool               m_draining;
+  uint64_t           m_drain_id;    // tells apart the grace timeouts of subsequent drains
+  std::function<void()>      m_drain_handler;
+  std::set<connection_slot*> m_slots;   // slots of the accepted streams
 };
 
 /*
@@ -251,18 +530,39 @@ class server : public async::detail::itf::startable
  * Note that the stream implementation does not manage the life time of event
  * source contexts - these will get deleted  through their cancel callbacks. So
  * in a sense they co-manage the life time of the stream implementation.
+ *
+ * Both event sources use the same socket; libdispatch multiplexes read and
+ * write interest on the same descriptor into a single kernel registration.
+ * The socket is owned jointly by both contexts and is closed when the last
+ * of them is deleted.
  */
 class stream : public detail::itf::connected_writable
+             , public async::impl::timeout_wheel::entry
              , public cool::ng::util::named
              , public cool::ng::util::self_aware<stream>
 {
   enum class state { disconnected, connecting, connected, disconnecting };
 
-  struct context
+  // maximum number of buffers written with a single writev() call
+  static constexpr int write_batch = 64;
+
+  // closes the socket when the last event source context is gone
+  struct socket_owner
   {
+    explicit socket_owner(::cool::ng::net::handle h_) : m_handle(h_)
+    { /* noop */ }
+    ~socket_owner();
+
     ::cool::ng::net::handle m_handle;
-    dispatch_source         m_source;
-    stream::ptr             m_stream;
+    std::shared_ptr<void>   m_slot;   // server's connection slot, if accepted
+  };
+
+  struct context
+  {
+    ::cool::ng::net::handle       m_handle;
+    std::shared_ptr<socket_owner> m_socket;
+    dispatch_source               m_source;
+    stream::ptr                   m_stream;
   };
   struct rd_context : public context
   {
@@ -280,30 +580,53 @@ class stream : public detail::itf::connected_writable
                 , uint16_t port_
                 , void* buf_
                 , std::size_t bufsz_);
+  void initialize(const cool::ng::net::local::address& addr_
+                , void* buf_
+                , std::size_t bufsz_);
   void initialize(cool::ng::net::handle h_);
   void initialize(void* buf_, std::size_t bufsz_);
-  void set_handle(cool::ng::net::handle h_) override;
+  void set_handle(cool::ng::net::handle h_, const std::shared_ptr<void>& slot_) override;
   void shutdown() override;
   const std::string& name() const override { return named::name(); }
 
   void write(const void* data, std::size_t size) override;
+  void write(const cool::ng::async::net::payload& data_) override;
   void connect(const cool::ng::net::ip::address& addr_, uint16_t port_) override;
+  void connect(const cool::ng::net::local::address& addr_) override;
   void disconnect() override;
+  void options(const cool::ng::async::net::socket_options& opts_) override;
+  void set_timeouts(const cool::ng::async::net::timeouts& t_) override;
+  // closes the stream once there are no pending writes, or immediately if
+  // forced, and reports the disconnect to the user
+  void quiesce(bool force_);
+  // async::impl::timeout_wheel::entry
+  void expired(uint64_t tag_) override;
 
  private:
+  void connect(int domain_, const sockaddr* addr_, socklen_t size_);
   static void on_rd_cancel(void* ctx);
   static void on_wr_cancel(void* ctx);
   static void on_rd_event(void* ctx);
   static void on_wr_event(void* ctx);
 
-  void create_write_source(cool::ng::net::handle h_, bool start_ = true);
+  void attach_socket(const std::shared_ptr<socket_owner>& s_);
+  void create_write_source(const std::shared_ptr<socket_owner>& s_, bool start_ = true);
   bool cancel_write_source(context*&);
+  void suspend_write_source(context* ctx);
   bool cancel_read_source(rd_context*&);
 
-  void create_read_source(cool::ng::net::handle h_, void* buf_, std::size_t bufsz_);
+  void create_read_source(const std::shared_ptr<socket_owner>& s_, void* buf_, std::size_t bufsz_);
   void process_connecting_event(context* ctx, std::size_t size);
   void process_disconnect_event();
   void process_write_event(context* ctx, std::size_t size);
+  bool complete_write(context* ctx);
+  void clear_write_queue();
+  void fail_write(context* ctx, int err);
+  void schedule_timeout();
+  static void on_timeout(void* ctx);
+  static void on_quiesce(void* ctx);
+  void close_quiesced();
+  void process_timeout();
 
  private:
   std::atomic<state>                   m_state;
@@ -321,10 +644,109 @@ class stream : public detail::itf::connected_writable
   const uint8_t*        m_wr_data;
   std::size_t           m_wr_size;
   std::size_t           m_wr_pos;
+  cool::ng::async::net::payload m_wr_payload;  // keeps payload alive while being written
+  std::mutex                    m_wr_lock;     // protects the payload write queue
+  std::deque<cool::ng::async::net::payload> m_wr_queue;
+
+  std::mutex                           m_opt_lock;  // protects socket options
+  cool::ng::async::net::socket_options m_options;
+  std::weak_ptr<socket_owner>          m_socket;    // socket the options apply to
+
+  // timeouts, all times are in milliseconds and zero means not set
+  std::atomic<uint64_t> m_tmo_connect;
+  std::atomic<uint64_t> m_tmo_read;
+  std::atomic<uint64_t> m_tmo_write;
+  std::atomic<uint64_t> m_tmo_due;      // deadline armed in the wheel
+  std::atomic<uint64_t> m_conn_start;   // start of connect
+  std::atomic<uint64_t> m_last_read;    // last read or start of read idle period
+  std::atomic<uint64_t> m_wr_since;     // last progress of the pending write
+  std::atomic<bool>     m_timed_out;    // connect aborted by timeout
+
+  std::atomic<bool>     m_quiesce;      // close when pending writes complete
+  std::atomic<bool>     m_quiesce_force;
+};
+
+} } // namespace net::impl
+
+// ==========================================================================
+// ======
+// ======
+// ====== Interprocess communication event sources
+// ======
+// ======
+// ==========================================================================
+namespace ipc { namespace impl {
 
+/*
+ * The channel implementation is kept alive by the shared pointer of its
+ * parent, detail::channel class template, and by the shared pointer in the
+ * context of the dispatch event source that listens on the channel's wake-up
+ * fifo. The shared memory segment is unmapped, and if this is the side that
+ * created it, unlinked, from the event source's cancel callback.
+ */
+class channel : public async::detail::itf::writable
+              , public cool::ng::util::named
+              , public cool::ng::util::self_aware<channel>
+{
+  struct ring;      // layout of the shared memory is defined in the
+  struct segment;   // implementation file
+
+  struct context
+  {
+    int             m_handle;   // fifo where the peer signals wake-ups
+    dispatch_source m_source;
+    channel::ptr    m_channel;
+  };
+
+ public:
+  channel(const std::weak_ptr<async::impl::executor>& ex_
+        , const net::impl::cb::stream::weak_ptr& cb_);
+  ~channel();
+
+  void initialize(const std::string& name_, mode mode_, std::size_t capacity_);
+
+  // writable interface
+  void write(const void* data_, std::size_t size_) override;
+  void shutdown() override;
+  const std::string& name() const override { return named::name(); }
+
+ private:
+  static void on_event(void* ctx);
+  static void on_cancel(void* ctx);
+  static void on_post(void* ctx);
+
+  void process_event(context* ctx);
+  void process_read();
+  void fail_read();
+  bool flush_write();
+  bool copy_to_ring(const void* data_, std::size_t size_);
+  void ring_peer();
+  void post(const std::function<void()>& f_);
+  void cleanup();
+
+ private:
+  std::weak_ptr<async::impl::executor> m_executor;
+  net::impl::cb::stream::weak_ptr      m_handler;
+  std::string           m_name;
+  int                   m_side;       // 0 for creator, 1 for peer that opened channel
+  bool                  m_owner;      // true if this side created shared memory
+  bool                  m_attached;   // true if this side is marked attached
+  segment*              m_segment;
+  std::size_t           m_size;       // size of the mapped segment
+  std::size_t           m_capacity;   // capacity of each ring
+  int                   m_peer_bell;  // fifo to signal wake-ups to the peer
+  std::atomic<context*> m_context;
+  std::atomic<bool>     m_closed;
+  std::atomic<bool>     m_connected;
+  bool                  m_corrupt;    // the peer's ring is corrupt, reading stopped
+
+  // writer part
+  std::atomic<bool>     m_wr_busy;
+  std::mutex            m_wr_lock;
+  const void*           m_wr_data;    // pending write, if any
+  std::size_t           m_wr_size;
 };
 
 } } } } } // namespace
 
 #endif
-
@@ -21,53 +21,975 @@
  * IN THE SOFTWARE.
  */
 
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#if defined(LINUX_TARGET)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 #include "cool/ng/async/runner.h"
 #include "cool/ng/exception.h"
 #include "executor.h"
 
 namespace cool { namespace ng { namespace async { namespace impl {
 
-executor::executor(RunPolicy policy_)
+const char executor::queue_key = 0;
+const char executor::worker_key = 0;
+
+namespace {
+
+// set on the threads of the worker pool
+thread_local bool pool_thread = false;
+
+// number of tasks the drain runs before it lets other work items, such as
+// the handlers of the event sources, onto the queue
+const int drain_batch = 64;
+
+// time after which the idle worker threads above the minimum exit
+const std::chrono::seconds worker_idle_timeout(10);
+
+// number of times the oldest item in the worker pool may be bypassed by the
+// items with higher priority
+const std::uint64_t starvation_limit = 16;
+
+// number of tasks each priority lane of the runner may execute in a round
+// when the lanes are weighted
+const int lane_weights[] = { 8, 4, 2, 1 };
+
+// time the busy polling thread spins without work before it parks
+const std::chrono::microseconds default_spin_period(100);
+
+inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#else
+  std::this_thread::yield();
+#endif
+}
+
+// throws if the CPU numbers cannot be used for the affinity
+void validate_cpus(const std::vector<unsigned int>& cpus_)
+{
+#if defined(LINUX_TARGET)
+  for (auto cpu : cpus_)
+    if (cpu >= CPU_SETSIZE)
+      throw exception::illegal_argument();
+#else
+  if (!cpus_.empty())
+    throw exception::operation_failed(error::errc::not_available);
+#endif
+}
+
+#if defined(LINUX_TARGET)
+// the empty list of CPUs allows all CPUs; the kernel further restricts them
+// to the CPUs available to the process
+cpu_set_t make_cpu_set(const std::vector<unsigned int>& cpus_)
+{
+  cpu_set_t ret;
+  CPU_ZERO(&ret);
+  if (cpus_.empty())
+  {
+    for (int i = 0; i < CPU_SETSIZE; ++i)
+      CPU_SET(i, &ret);
+  }
+  else
+  {
+    for (auto cpu : cpus_)
+      CPU_SET(cpu, &ret);
+  }
+  return ret;
+}
+#endif
+
+// pins the calling thread to the CPUs for its lifetime, then restores the
+// previous affinity of the thread
+class pin_guard
+{
+ public:
+  pin_guard(const std::vector<unsigned int>& cpus_)
+    : m_pinned(false)
+  {
+#if defined(LINUX_TARGET)
+    auto set = make_cpu_set(cpus_);
+    m_pinned = ::pthread_getaffinity_np(::pthread_self(), sizeof(m_saved), &m_saved) == 0
+            && ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set) == 0;
+#endif
+  }
+  ~pin_guard()
+  {
+#if defined(LINUX_TARGET)
+    if (m_pinned)
+      ::pthread_setaffinity_np(::pthread_self(), sizeof(m_saved), &m_saved);
+#endif
+  }
+
+ private:
+  bool      m_pinned;
+#if defined(LINUX_TARGET)
+  cpu_set_t m_saved;
+#endif
+};
+
+long dispatch_priority(RunPriority priority_)
+{
+  switch (priority_)
+  {
+    case RunPriority::HIGH:       return DISPATCH_QUEUE_PRIORITY_HIGH;
+    case RunPriority::LOW:        return DISPATCH_QUEUE_PRIORITY_LOW;
+    case RunPriority::BACKGROUND: return DISPATCH_QUEUE_PRIORITY_BACKGROUND;
+    default:                      return DISPATCH_QUEUE_PRIORITY_DEFAULT;
+  }
+}
+
+} // anonymous namespace
+
+// ---------------------------
+// worker pool
+
+std::atomic<worker_pool*> worker_pool::m_instance(nullptr);
+std::mutex                worker_pool::m_affinity_lock;
+std::vector<unsigned int> worker_pool::m_affinity;
+std::atomic<std::uint64_t> worker_pool::m_affinity_gen(0);
+
+worker_pool::worker_pool()
+    : m_size(0)
+    , m_seq(0)
+    , m_picks(0)
+    , m_min(0)
+    , m_max(0)
+    , m_threads(0)
+    , m_idle(0)
+{ /* noop */ }
+
+worker_pool* worker_pool::instance()
+{
+  return m_instance.load(std::memory_order_acquire);
+}
+
+// the pool is never destroyed as the runners may use it until the very end
+// of the process
+void worker_pool::configure(std::size_t min_, std::size_t max_)
+{
+  if (max_ == 0 || min_ > max_)
+    throw exception::illegal_argument();
+
+  static std::mutex lock;
+  std::unique_lock<std::mutex> l(lock);
+
+  auto pool = instance();
+  if (pool == nullptr)
+    pool = new worker_pool;
+
+  {
+    std::unique_lock<std::mutex> pl(pool->m_lock);
+    pool->m_min = min_;
+    pool->m_max = max_;
+    while (pool->m_threads < pool->m_min)
+      pool->start_thread();
+  }
+  // let the surplus threads exit
+  pool->m_cv.notify_all();
+
+  m_instance.store(pool, std::memory_order_release);
+}
+
+// the worker threads pick up the new affinity before they take the next item
+void worker_pool::affinity(const std::vector<unsigned int>& cpus_)
+{
+  validate_cpus(cpus_);
+
+  std::unique_lock<std::mutex> l(m_affinity_lock);
+  m_affinity = cpus_;
+  ++m_affinity_gen;
+}
+
+std::size_t worker_pool::threads() const
+{
+  std::unique_lock<std::mutex> l(m_lock);
+  return m_threads;
+}
+
+void worker_pool::submit(function f_, void* arg_, RunPriority priority_)
+{
+  {
+    std::unique_lock<std::mutex> l(m_lock);
+    m_queue[static_cast<int>(priority_)].push_back(item { f_, arg_, m_seq++, m_picks });
+    ++m_size;
+    if (m_size > m_idle && m_threads < m_max)
+      start_thread();
+  }
+  m_cv.notify_one();
+}
+
+// must be called with the lock held and at least one item queued
+worker_pool::item worker_pool::next()
+{
+  ++m_picks;
+
+  int first = -1;
+  int oldest = -1;
+  for (int i = 0; i < lanes; ++i)
+  {
+    if (m_queue[i].empty())
+      continue;
+    if (first < 0)
+      first = i;
+    if (oldest < 0 || m_queue[i].front().seq < m_queue[oldest].front().seq)
+      oldest = i;
+  }
+
+  int lane = m_picks - m_queue[oldest].front().stamp > starvation_limit ? oldest : first;
+  auto ret = m_queue[lane].front();
+  m_queue[lane].pop_front();
+  --m_size;
+  return ret;
+}
+
+// must be called with the lock held
+void worker_pool::start_thread()
+{
+  std::thread(worker, this).detach();
+  ++m_threads;
+}
+
+bool worker_pool::on_worker()
+{
+  return pool_thread;
+}
+
+void worker_pool::worker(worker_pool* self_)
+{
+  std::uint64_t affinity_gen = 0;
+  pool_thread = true;
+
+  std::unique_lock<std::mutex> l(self_->m_lock);
+  while (true)
+  {
+#if defined(LINUX_TARGET)
+    if (affinity_gen != m_affinity_gen.load(std::memory_order_relaxed))
+    {
+      std::unique_lock<std::mutex> al(m_affinity_lock);
+      auto set = make_cpu_set(m_affinity);
+      affinity_gen = m_affinity_gen;
+      ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set);
+    }
+#endif
+
+    if (self_->m_size == 0)
+    {
+      ++self_->m_idle;
+      bool ready = self_->m_cv.wait_for(l, worker_idle_timeout, [self_] ()
+          {
+            return self_->m_size > 0 || self_->m_threads > self_->m_max;
+          });
+      --self_->m_idle;
+
+      if (self_->m_threads > self_->m_max || (!ready && self_->m_threads > self_->m_min))
+      {
+        --self_->m_threads;
+        return;
+      }
+      if (self_->m_size == 0)
+        continue;
+    }
+
+    auto item = self_->next();
+    l.unlock();
+
+    item.fn(item.arg);
+
+    l.lock();
+  }
+}
+
+// ---------------------------
+// mailbox
+
+executor::mailbox::mailbox(dispatch_queue_t q_, RunPriority priority_, bool edf_)
+    : m_depth(0)
+    , m_pending(0)
+    , m_weighted(false)
+    , m_queue(q_)
+    , m_priority(priority_)
+    , m_pinned(false)
+    , m_capacity(0)
+    , m_overflow(OverflowPolicy::REJECT)
+    , m_waiters(0)
+    , m_edf(edf_)
+    , m_edf_seq(0)
+    , m_shed(false)
+    , m_shed_count(0)
+    , m_poller(nullptr)
+    , m_manual(false)
+{
+  for (int i = 0; i < lanes; ++i)
+    m_credits[i] = lane_weights[i];
+}
+
+void executor::mailbox::push_deadline(detail::context_stack* ctx_)
+{
+  std::unique_lock<std::mutex> l(m_edf_lock);
+  m_edf_queue.push(entry { ctx_->m_deadline, m_edf_seq++, ctx_ });
+}
+
+detail::work* executor::mailbox::pop_deadline()
+{
+  std::unique_lock<std::mutex> l(m_edf_lock);
+  if (m_edf_queue.empty())
+    return nullptr;
+
+  auto ret = m_edf_queue.top().ctx;
+  m_edf_queue.pop();
+  return ret;
+}
+
+void executor::mailbox::push(detail::context_stack* ctx_)
+{
+  m_lanes[static_cast<int>(ctx_->m_priority)].push(ctx_);
+}
+
+// The strict lanes always serve the lane with the highest priority first.
+// The weighted lanes serve each lane up to its weight per round, which lets
+// the lower lanes progress while the higher lanes are busy. Returns nullptr
+// if the mailbox is empty or if the push of the next task is still in
+// progress.
+detail::work* executor::mailbox::pop()
+{
+  if (m_weighted)
+  {
+    for (int i = 0; i < lanes; ++i)
+    {
+      if (m_credits[i] == 0)
+        continue;
+      auto ret = m_lanes[i].pop();
+      if (ret != nullptr)
+      {
+        --m_credits[i];
+        return ret;
+      }
+    }
+    // the lanes with the credit left are empty, start a new round
+    for (int i = 0; i < lanes; ++i)
+      m_credits[i] = lane_weights[i];
+  }
+
+  for (int i = 0; i < lanes; ++i)
+  {
+    auto ret = m_lanes[i].pop();
+    if (ret != nullptr)
+    {
+      if (m_weighted)
+        --m_credits[i];
+      return ret;
+    }
+  }
+  return nullptr;
+}
+
+executor::mailbox::lane::lane()
+    : m_head(&m_stub)
+    , m_tail(&m_stub)
+{ /* noop */ }
+
+void executor::mailbox::lane::push(detail::work* w_)
+{
+  w_->m_next.store(nullptr, std::memory_order_relaxed);
+  auto prev = m_head.exchange(w_, std::memory_order_acq_rel);
+  prev->m_next.store(w_, std::memory_order_release);
+}
+
+// returns nullptr if the lane is empty or if the push of the next task is
+// still in progress
+detail::work* executor::mailbox::lane::pop()
+{
+  auto tail = m_tail;
+  auto next = tail->m_next.load(std::memory_order_acquire);
+  if (tail == &m_stub)
+  {
+    if (next == nullptr)
+      return nullptr;
+    m_tail = next;
+    tail = next;
+    next = next->m_next.load(std::memory_order_acquire);
+  }
+
+  if (next != nullptr)
+  {
+    m_tail = next;
+    return tail;
+  }
+
+  if (tail != m_head.load(std::memory_order_acquire))
+    return nullptr;
+
+  // the last task cannot be removed without another task behind it
+  push(&m_stub);
+  next = tail->m_next.load(std::memory_order_acquire);
+  if (next != nullptr)
+  {
+    m_tail = next;
+    return tail;
+  }
+  return nullptr;
+}
+
+// ---------------------------
+// poller
+
+executor::poller::poller(dispatch_queue_t q_, mailbox* mbox_)
+    : m_stop(false)
+    , m_parked(false)
+    , m_spin(std::chrono::duration_cast<std::chrono::nanoseconds>(default_spin_period).count())
+    , m_queue(q_)
+    , m_mailbox(mbox_)
+{ /* noop */ }
+
+// the parked thread must check the mailbox under the lock after it declared
+// itself parked, thus the producer that sees it running needs not lock
+void executor::poller::wake()
+{
+  if (m_parked)
+  {
+    std::unique_lock<std::mutex> l(m_lock);
+    m_cv.notify_one();
+  }
+}
+
+void executor::busy_poll(std::shared_ptr<poller> p_)
+{
+  using clock = std::chrono::steady_clock;
+
+  auto mbox = p_->m_mailbox;
+  auto last = clock::now();
+  while (true)
+  {
+    if (mbox->m_pending > 0)
+    {
+      // entering the idle serial queue synchronously runs the drain on this
+      // thread while keeping it serialized with the event sources
+      ::dispatch_sync_f(p_->m_queue, mbox, drain);
+      last = clock::now();
+      continue;
+    }
+    if (p_->m_stop)
+      break;
+
+    if (clock::now() - last < std::chrono::nanoseconds(p_->m_spin.load()))
+    {
+      cpu_relax();
+      continue;
+    }
+
+    {
+      std::unique_lock<std::mutex> l(p_->m_lock);
+      p_->m_parked = true;
+      p_->m_cv.wait(l, [&p_, mbox] () { return mbox->m_pending > 0 || p_->m_stop; });
+      p_->m_parked = false;
+    }
+    last = clock::now();
+  }
+
+  ::dispatch_release(p_->m_queue);
+}
+
+// ---------------------------
+// executor
+
+executor::executor(RunPolicy policy_, RunPriority priority_)
     : named("si.digiverse.ng.cool.runner")
     , m_is_system(false)
+#if defined(OSX_TARGET)
+    , m_sequential(policy_ != RunPolicy::CONCURRENT)
+#else
+    , m_sequential(true)
+#endif
+    , m_priority(priority_)
     , m_active(true)
 {
 #if defined(OSX_TARGET)
-  if (policy_ == RunPolicy::CONCURRENT)
+  if (!m_sequential)
     m_queue = ::dispatch_queue_create(name().c_str(), DISPATCH_QUEUE_CONCURRENT);
   else
 #endif
     m_queue = ::dispatch_queue_create(name().c_str(), NULL);
+
+  ::dispatch_set_target_queue(m_queue, ::dispatch_get_global_queue(dispatch_priority(m_priority), 0));
+
+  m_mailbox = new mailbox(m_queue, m_priority, policy_ == RunPolicy::EARLIEST_DEADLINE);
+  ::dispatch_queue_set_specific(m_queue, &queue_key, m_mailbox, release_mailbox);
+  mark_queue(m_queue);
+
+  if (policy_ == RunPolicy::BUSY_POLL)
+  {
+    m_poller = std::make_shared<poller>(m_queue, m_mailbox);
+    m_mailbox->m_poller = m_poller.get();
+    ::dispatch_retain(m_queue);
+    std::thread(busy_poll, m_poller).detach();
+  }
+  else if (policy_ == RunPolicy::MANUAL)
+  {
+    m_mailbox->m_manual = true;
+  }
 }
 
+// the polling thread is not joined as the executor may be destroyed by the
+// task the thread executes; it exits once the mailbox is empty
 executor::~executor()
 {
+  if (m_poller)
+  {
+    m_poller->m_stop = true;
+    std::unique_lock<std::mutex> l(m_poller->m_lock);
+    m_poller->m_cv.notify_one();
+  }
+
+  // the tasks left in the queue of the manually stepped executor are
+  // drained by the thread pool, which discards them as their runner is gone
+  if (m_mailbox->m_manual)
+  {
+    m_mailbox->m_manual = false;
+    if (m_mailbox->m_pending > 0)
+      schedule(m_mailbox);
+  }
+
   if (!m_is_system)
     dispatch_release(m_queue);
 }
 
+void executor::spin_period(const std::chrono::microseconds& period_)
+{
+  if (m_poller)
+    m_poller->m_spin = std::chrono::duration_cast<std::chrono::nanoseconds>(period_).count();
+}
+
+std::size_t executor::queue_depth() const
+{
+  return m_mailbox->m_depth;
+}
+
+void executor::affinity(const std::vector<unsigned int>& cpus_)
+{
+  validate_cpus(cpus_);
+
+  std::unique_lock<std::mutex> l(m_mailbox->m_affinity_lock);
+  m_mailbox->m_affinity = cpus_;
+  m_mailbox->m_pinned = !cpus_.empty();
+}
+
+std::vector<unsigned int> executor::affinity() const
+{
+  std::unique_lock<std::mutex> l(m_mailbox->m_affinity_lock);
+  return m_mailbox->m_affinity;
+}
+
+void executor::pool_affinity(const std::vector<unsigned int>& cpus_)
+{
+  worker_pool::affinity(cpus_);
+}
+
+// parses the list of CPUs of the node, such as "0-3,8-11"
+std::vector<unsigned int> executor::numa_cpus(unsigned int node_)
+{
+#if defined(LINUX_TARGET)
+  std::ifstream is("/sys/devices/system/node/node" + std::to_string(node_) + "/cpulist");
+  if (!is)
+    throw exception::illegal_argument();
+
+  std::vector<unsigned int> ret;
+  std::string range;
+  while (std::getline(is, range, ','))
+  {
+    std::istringstream rs(range);
+    unsigned int first;
+    unsigned int last;
+    if (!(rs >> first))
+      continue;
+    last = first;
+    if (rs.get() == '-')
+      rs >> last;
+    for (auto cpu = first; cpu <= last; ++cpu)
+      ret.push_back(cpu);
+  }
+  return ret;
+#else
+  throw exception::operation_failed(error::errc::not_available);
+#endif
+}
+
+void executor::release_mailbox(void* arg_)
+{
+  delete static_cast<mailbox*>(arg_);
+}
+
+// The sequential executor submits the tasks into the mailbox and only the
+// first task submitted into the empty mailbox submits the drain to the
+// dispatch queue. The concurrent executor submits each task to the dispatch
+// queue.
 void executor::run(detail::context_stack* ctx_)
 {
-  ::dispatch_async_f(m_queue, ctx_, task_executor);
+  ++m_mailbox->m_depth;
+  enqueue(ctx_);
+}
+
+void executor::enqueue(detail::context_stack* ctx_)
+{
+  if (!m_sequential)
+  {
+    ::dispatch_async_f(m_queue, ctx_, task_executor);
+    return;
+  }
+
+  if (m_mailbox->m_edf)
+    m_mailbox->push_deadline(ctx_);
+  else
+    m_mailbox->push(ctx_);
+  if (m_mailbox->m_pending.fetch_add(1) == 0)
+    schedule(m_mailbox);
+}
+
+// takes a place in the queue if the queue is not full
+bool executor::reserve()
+{
+  auto capacity = m_mailbox->m_capacity.load();
+  auto depth = m_mailbox->m_depth.load();
+  do
+  {
+    if (capacity != 0 && depth >= capacity)
+      return false;
+  }
+  while (!m_mailbox->m_depth.compare_exchange_weak(depth, depth + 1));
+  return true;
+}
+
+// The new tasks are subject to the capacity of the queue and to the overflow
+// policy when the queue is full. The context stack of the rejected task is
+// deleted.
+bool executor::submit(detail::context_stack* ctx_)
+{
+  if (m_sequential && m_mailbox->m_overflow == OverflowPolicy::DROP_OLDEST)
+    return drop_oldest(ctx_);
+
+  if (reserve())
+  {
+    enqueue(ctx_);
+    return true;
+  }
+
+  switch (m_mailbox->m_overflow.load())
+  {
+    case OverflowPolicy::BLOCK:
+      if (may_block())
+      {
+        ++m_mailbox->m_waiters;
+        {
+          std::unique_lock<std::mutex> l(m_mailbox->m_space_lock);
+          m_mailbox->m_space.wait(l, [this] () { return reserve(); });
+        }
+        --m_mailbox->m_waiters;
+        enqueue(ctx_);
+        return true;
+      }
+      // queued over the capacity
+      run(ctx_);
+      return true;
+
+    case OverflowPolicy::CALLER_RUNS:
+      // the task of the sequential runner is serialized with the runner's
+      // other tasks, unless submitted by one of them
+      if (m_sequential && ::dispatch_get_specific(&queue_key) != m_mailbox)
+        ::dispatch_sync_f(m_queue, ctx_, caller_runs);
+      else
+        execute(ctx_);
+      return true;
+
+    default:
+      break;
+  }
+
+  delete ctx_;
+  return false;
+}
+
+void executor::mark_queue(dispatch_queue_t q_)
+{
+  ::dispatch_queue_set_specific(q_, &worker_key, const_cast<char*>(&worker_key), nullptr);
+}
+
+// Only the application threads may wait for the space in the queue. The
+// threads of the worker pool and of the library's dispatch queues may be
+// needed by the drain of the full runner, and the full manually stepped
+// runner only makes room when its owner steps it.
+bool executor::may_block() const
+{
+  return !m_mailbox->m_manual
+      && !worker_pool::on_worker()
+      && ::dispatch_get_specific(&worker_key) == nullptr;
+}
+
+// The new submissions are tracked in the order of their arrival until they
+// start to execute. If the queue is full the oldest of them is marked as
+// dropped, passes its place in the queue to the new task and is discarded
+// when the drain gets to it. The continuations of the running tasks are not
+// tracked and are never dropped; if there is no task to drop the new task
+// is rejected.
+bool executor::drop_oldest(detail::context_stack* ctx_)
+{
+  {
+    std::unique_lock<std::mutex> l(m_mailbox->m_drop_lock);
+    if (!reserve())
+    {
+      if (m_mailbox->m_droppable.empty())
+      {
+        l.unlock();
+        delete ctx_;
+        return false;
+      }
+      m_mailbox->m_droppable.front()->m_dropped = true;
+      m_mailbox->m_droppable.pop_front();
+    }
+    ctx_->m_droppable = true;
+    m_mailbox->m_droppable.push_back(ctx_);
+  }
+
+  enqueue(ctx_);
+  return true;
+}
+
+// executes the task submitted to the full sequential runner on the calling
+// thread, synchronously with the runner's queue
+void executor::caller_runs(void* arg_)
+{
+  execute(static_cast<detail::context_stack*>(arg_));
 }
 
-// executor for task::run()
+void executor::capacity(std::size_t capacity_, OverflowPolicy policy_)
+{
+  m_mailbox->m_overflow = policy_;
+  m_mailbox->m_capacity = capacity_;
+
+  // the blocked submitters may fit into the new capacity
+  std::unique_lock<std::mutex> l(m_mailbox->m_space_lock);
+  m_mailbox->m_space.notify_all();
+}
+
+void executor::configure_pool(std::size_t min_, std::size_t max_)
+{
+  worker_pool::configure(min_, max_);
+}
+
+std::size_t executor::pool_threads()
+{
+  auto pool = worker_pool::instance();
+  return pool == nullptr ? 0 : pool->threads();
+}
+
+// submits the drain of the mailbox either to the worker pool, if configured,
+// or directly to the dispatch queue
+void executor::schedule(mailbox* mbox_)
+{
+  if (mbox_->m_manual)
+    return;
+
+  if (mbox_->m_poller != nullptr)
+  {
+    mbox_->m_poller->wake();
+    return;
+  }
+
+  auto pool = worker_pool::instance();
+  if (pool == nullptr)
+  {
+    ::dispatch_async_f(mbox_->m_queue, mbox_, drain);
+    return;
+  }
+
+  // the queue, and the mailbox it owns, must outlive the submitted drain
+  ::dispatch_retain(mbox_->m_queue);
+  pool->submit(enter, mbox_, mbox_->m_priority);
+}
+
+// runs the drain on the worker thread, serialized with the other work items
+// of the queue
+void executor::enter(void* arg_)
+{
+  auto mbox = static_cast<mailbox*>(arg_);
+  auto queue = mbox->m_queue;
+
+  ::dispatch_sync_f(queue, mbox, drain);
+  ::dispatch_release(queue);
+}
+
+// executor for task::run() on concurrent queue
 void executor::task_executor(void* arg_)
 {
-  auto ctx = static_cast<detail::context_stack*>(arg_);
+  // the queue may not belong to the runner of the top context, hence the
+  // counter is obtained from the queue rather than from the context
+  auto mbox = static_cast<mailbox*>(::dispatch_get_specific(&queue_key));
+  if (mbox != nullptr)
+  {
+    --mbox->m_depth;
+    if (mbox->m_waiters > 0)
+    {
+      std::unique_lock<std::mutex> l(mbox->m_space_lock);
+      mbox->m_space.notify_one();
+    }
+  }
+
+  execute(static_cast<detail::context_stack*>(arg_));
+}
+
+// executor for task::run() on sequential queue
+void executor::drain(void* arg_)
+{
+  auto mbox = static_cast<mailbox*>(arg_);
+
+  std::unique_ptr<pin_guard> pin;
+  if (mbox->m_pinned)
+  {
+    std::unique_lock<std::mutex> l(mbox->m_affinity_lock);
+    if (!mbox->m_affinity.empty())
+      pin.reset(new pin_guard(mbox->m_affinity));
+  }
+
+  for (int i = 0; i < drain_batch; ++i)
+  {
+    if (!step(mbox))
+      return;
+  }
+
+  // more tasks are pending, resubmit the drain behind the other work items
+  schedule(mbox);
+}
+
+// executes the next task of the mailbox; returns false if no more tasks are
+// pending
+bool executor::step(mailbox* mbox_)
+{
+  // the pending count only includes the completed pushes, but the push of
+  // another producer in front of them may still be in progress
+  detail::work* w;
+  while ((w = mbox_->m_edf ? mbox_->pop_deadline() : mbox_->pop()) == nullptr)
+    std::this_thread::yield();
+
+  auto ctx = static_cast<detail::context_stack*>(w);
+  auto dropped = false;
+  if (ctx->m_droppable)
+  {
+    std::unique_lock<std::mutex> l(mbox_->m_drop_lock);
+    dropped = ctx->m_dropped;
+    if (!dropped)
+      mbox_->m_droppable.erase(std::find(mbox_->m_droppable.begin(), mbox_->m_droppable.end(), ctx));
+    ctx->m_droppable = false;
+  }
+
+  // the dropped task already passed its place in the queue to another task
+  if (!dropped)
+  {
+    --mbox_->m_depth;
+    if (mbox_->m_waiters > 0)
+    {
+      std::unique_lock<std::mutex> l(mbox_->m_space_lock);
+      mbox_->m_space.notify_one();
+    }
+  }
+
+  if (dropped)
+  {
+    reject(ctx, error::errc::request_rejected);
+  }
+  else if (!mbox_->m_edf)
+  {
+    execute(ctx);
+  }
+  else if (mbox_->m_shed
+      && ctx->m_deadline != std::chrono::steady_clock::time_point::max()
+      && ctx->m_deadline < std::chrono::steady_clock::now())
+  {
+    ++mbox_->m_shed_count;
+    reject(ctx, error::errc::timed_out);
+  }
+  else
+  {
+    // the tasks submitted by this task inherit its deadline
+    auto previous = deadline::current();
+    deadline::set(ctx->m_deadline);
+    execute(ctx);
+    deadline::set(previous);
+  }
+
+  return --mbox_->m_pending != 0;
+}
+
+// the owner steps the executor through its queue, thus the tasks remain
+// serialized with its event sources and may check the queue specific data;
+// the queue is retained as the executor may be destroyed by its task
+std::size_t executor::advance(std::size_t limit_)
+{
+  if (!m_mailbox->m_manual || ::dispatch_get_specific(&queue_key) == m_mailbox)
+    throw exception::invalid_state();
+
+  auto queue = m_queue;
+  stepper s { m_mailbox, limit_, 0 };
+  ::dispatch_retain(queue);
+  ::dispatch_sync_f(queue, &s, step_manual);
+  ::dispatch_release(queue);
+  return s.count;
+}
+
+void executor::step_manual(void* arg_)
+{
+  auto s = static_cast<stepper*>(arg_);
 
-  auto r = ctx->top()->get_runner().lock();
+  // the destroyed executor hands the remaining tasks to the thread pool
+  while (s->count < s->limit && s->mbox->m_manual && s->mbox->m_pending > 0)
+  {
+    ++s->count;
+    step(s->mbox);
+  }
+}
+
+void executor::execute(detail::context_stack* ctx_)
+{
+  auto r = ctx_->top()->get_runner().lock();
   if (r)
   {
-    ctx->top()->entry_point(r, ctx->top());
-    if (ctx->empty())
-      delete ctx;
+    ctx_->top()->entry_point(r, ctx_->top());
+    if (ctx_->empty())
+      delete ctx_;
     else
-      r->impl()->run(ctx);
+      r->impl()->run(ctx_);
   }
   else
-    delete ctx;
+    delete ctx_;
+}
+
+// fails the task in place of executing it; the enclosing compound tasks may
+// handle the failure and push their next contexts to the stack
+void executor::reject(detail::context_stack* ctx_, error::errc code_)
+{
+  auto r = ctx_->top()->get_runner().lock();
+  try
+  {
+    ctx_->top()->report_exception(std::make_exception_ptr(
+        exception::operation_failed(code_)));
+  }
+  catch (...)
+  { /* noop */ }
+
+  // the handlers of the failure run without the deadline, or else they
+  // would be shed as well
+  ctx_->m_deadline = std::chrono::steady_clock::time_point::max();
+  if (r && !ctx_->empty())
+    r->impl()->run(ctx_);
+  else
+    delete ctx_;
 }
-  
 
 } } } } // namespace
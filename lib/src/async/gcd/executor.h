@@ -25,30 +25,240 @@
 #define      cool_ng_d2aa9442_15ec_4748_9d69_a7d096d1b861
 
 #include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <queue>
+#include <utility>
+#include <vector>
 #include <dispatch/dispatch.h>
 #include "cool/ng/bases.h"
+#include "cool/ng/error.h"
 #include "cool/ng/async/runner.h"
 #include "cool/ng/impl/async/context.h"
 
 namespace cool { namespace ng { namespace async { namespace impl {
 
+// Process-wide pool of worker threads the sequential executors multiplex
+// onto once it is configured. The pool keeps at least the minimum number of
+// threads running and starts new threads, up to the maximum, when all are
+// busy. The worker thread enters the executor's queue synchronously, thus the
+// tasks remain serialized with the event sources targeting the same queue.
+// The work items are queued into one lane per runner priority and the
+// workers serve the lanes with higher priority first, unless the oldest
+// queued item was already bypassed too many times.
+class worker_pool
+{
+ public:
+  using function = void (*)(void*);
+
+ private:
+  struct item
+  {
+    function      fn;
+    void*         arg;
+    std::uint64_t seq;     // submission order
+    std::uint64_t stamp;   // number of picks when the item was submitted
+  };
+
+ public:
+  static worker_pool* instance();
+  static void configure(std::size_t min_, std::size_t max_);
+  static void affinity(const std::vector<unsigned int>& cpus_);
+
+  void submit(function f_, void* arg_, RunPriority priority_);
+  std::size_t threads() const;
+  static bool on_worker();   // true on the threads of the pool
+
+ private:
+  worker_pool();
+  void start_thread();
+  item next();
+  static void worker(worker_pool* self_);
+
+ private:
+  static constexpr int lanes = 4;   // one per RunPriority
+  static std::atomic<worker_pool*> m_instance;
+  static std::mutex                m_affinity_lock;
+  static std::vector<unsigned int> m_affinity;
+  static std::atomic<std::uint64_t> m_affinity_gen;   // bumped on each change
+
+  mutable std::mutex                       m_lock;
+  std::condition_variable                  m_cv;
+  std::deque<item>                         m_queue[lanes];
+  std::size_t                              m_size;
+  std::uint64_t                            m_seq;
+  std::uint64_t                            m_picks;
+  std::size_t                              m_min;
+  std::size_t                              m_max;
+  std::size_t                              m_threads;
+  std::size_t                              m_idle;
+};
+
 class executor : public ::cool::ng::util::named
 {
+  struct mailbox;
+
+  // Dedicated thread of the busy polling executor. The thread spins on the
+  // mailbox and drains it as soon as it is not empty; after the spin period
+  // without work it parks until the next task arrives. The thread holds a
+  // reference to the queue, and with it to the mailbox, until it exits.
+  struct poller
+  {
+    poller(dispatch_queue_t q_, mailbox* mbox_);
+    void wake();
+
+    std::atomic<bool>          m_stop;
+    std::atomic<bool>          m_parked;
+    std::atomic<long long>     m_spin;     // spin period in nanoseconds
+    std::mutex                 m_lock;
+    std::condition_variable    m_cv;
+    dispatch_queue_t           m_queue;
+    mailbox*                   m_mailbox;
+  };
+
+  // Progress of the owner stepping through the manually stepped executor
+  struct stepper
+  {
+    mailbox*    mbox;
+    std::size_t limit;   // maximal number of tasks to execute
+    std::size_t count;   // number of tasks executed
+  };
+
+  // Intrusive lock-free MPSC queues of the tasks submitted to the sequential
+  // executor, one lane per task priority. The mailbox is drained by a single
+  // dispatch work item that is submitted to the executor's queue only when
+  // the mailbox goes from empty to non-empty. The mailbox is owned by the
+  // queue as the queued tasks may outlive the executor. The executor with
+  // the earliest deadline first policy keeps the tasks in the locked heap
+  // ordered by the deadline instead.
+  struct mailbox
+  {
+    struct stub : public detail::work
+    {
+      detail::work_type type() const override { return detail::work_type::task_work; }
+    };
+
+    struct lane
+    {
+      lane();
+      void push(detail::work* w_);
+      detail::work* pop();
+
+      std::atomic<detail::work*> m_head;      // last pushed, producers only
+      detail::work*              m_tail;      // next to pop, consumer only
+      stub                       m_stub;
+    };
+
+    struct entry
+    {
+      std::chrono::steady_clock::time_point deadline;
+      std::uint64_t                         seq;   // FIFO among equal deadlines
+      detail::context_stack*                ctx;
+    };
+    struct later
+    {
+      bool operator()(const entry& a_, const entry& b_) const
+      {
+        return a_.deadline > b_.deadline || (a_.deadline == b_.deadline && a_.seq > b_.seq);
+      }
+    };
+
+    mailbox(dispatch_queue_t q_, RunPriority priority_, bool edf_);
+    void push(detail::context_stack* ctx_);
+    detail::work* pop();
+    void push_deadline(detail::context_stack* ctx_);
+    detail::work* pop_deadline();
+
+    std::atomic<std::size_t>   m_depth;     // tasks submitted but not yet started
+    std::atomic<std::size_t>   m_pending;   // tasks submitted but not yet completed
+    static constexpr int lanes = 4;        // one per RunPriority
+    lane                       m_lanes[lanes];
+    int                        m_credits[lanes];   // consumer only
+    std::atomic<bool>          m_weighted;  // weighted rather than strict lanes
+    dispatch_queue_t           m_queue;
+    const RunPriority          m_priority;
+    std::atomic<bool>          m_pinned;    // m_affinity is not empty
+    std::mutex                 m_affinity_lock;
+    std::vector<unsigned int>  m_affinity;
+    std::atomic<std::size_t>   m_capacity;  // 0 if unlimited
+    std::atomic<OverflowPolicy> m_overflow;
+    std::atomic<int>           m_waiters;   // submitters blocked on full queue
+    std::mutex                 m_space_lock;
+    std::condition_variable    m_space;
+    std::mutex                 m_drop_lock;
+    std::deque<detail::context_stack*> m_droppable;  // new submissions, oldest first
+    const bool                 m_edf;       // earliest deadline first
+    std::mutex                 m_edf_lock;
+    std::priority_queue<entry, std::vector<entry>, later> m_edf_queue;
+    std::uint64_t              m_edf_seq;
+    std::atomic<bool>          m_shed;      // discard the expired tasks
+    std::atomic<std::size_t>   m_shed_count;
+    poller*                    m_poller;    // set if the executor busy polls
+    std::atomic<bool>          m_manual;    // drained only by the owner
+  };
+
  public:
-  executor(RunPolicy policy_);
+  executor(RunPolicy policy_, RunPriority priority_);
   ~executor();
 
   void run(detail::context_stack*);
+  bool submit(detail::context_stack*);
   dispatch_queue_t queue() const { return m_queue; }
-  
+  std::size_t queue_depth() const;
+  void capacity(std::size_t capacity_, OverflowPolicy policy_);
+  std::size_t capacity() const { return m_mailbox->m_capacity; }
+  void shed_expired(bool enable_) { m_mailbox->m_shed = enable_; }
+  void weighted_lanes(bool enable_) { m_mailbox->m_weighted = enable_; }
+  std::size_t shed_count() const { return m_mailbox->m_shed_count; }
+  void spin_period(const std::chrono::microseconds& period_);
+  bool run_one() { return advance(1) == 1; }
+  std::size_t poll() { return advance(m_mailbox->m_pending); }
+  std::size_t run_until_idle() { return advance(std::numeric_limits<std::size_t>::max()); }
+  RunPriority priority() const { return m_priority; }
+  void affinity(const std::vector<unsigned int>& cpus_);
+  std::vector<unsigned int> affinity() const;
+  static void configure_pool(std::size_t min_, std::size_t max_);
+  static std::size_t pool_threads();
+  static void pool_affinity(const std::vector<unsigned int>& cpus_);
+  static std::vector<unsigned int> numa_cpus(unsigned int node_);
+  // marks the private queue of the event source; the handlers on such queue
+  // never block on the full runner
+  static void mark_queue(dispatch_queue_t q_);
+
  private:
+  void enqueue(detail::context_stack*);
+  bool may_block() const;
+  bool reserve();
+  bool drop_oldest(detail::context_stack*);
+  static void caller_runs(void*);
   static void task_executor(void*);
+  static void schedule(mailbox*);
+  static void enter(void*);
+  static void drain(void*);
+  static bool step(mailbox*);
+  std::size_t advance(std::size_t limit_);
+  static void step_manual(void*);
+  static void execute(detail::context_stack*);
+  static void reject(detail::context_stack*, error::errc);
+  static void release_mailbox(void*);
+  static void busy_poll(std::shared_ptr<poller> p_);
+  static const char queue_key;   // address identifies the executor's queue specific data
+  static const char worker_key;  // address identifies the queues of the library
 
  private:
   const bool        m_is_system;
+  const bool        m_sequential;
+  const RunPriority m_priority;
   std::atomic<bool> m_active;
   dispatch_queue_t  m_queue;
+  mailbox*          m_mailbox;
+  std::shared_ptr<poller> m_poller;
 };
 
 } } } }// namespace
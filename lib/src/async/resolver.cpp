@@ -0,0 +1,279 @@
+/*
+ * Copyright (c) 2017 Leon Mlakar.
+ * Copyright (c) 2017 Digiverse d.o.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. The
+ * license should be included in the source distribution of the Software;
+ * if not, you may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and licensing terms shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#if defined(WINDOWS_TARGET)
+# include <winsock2.h>
+# include <ws2tcpip.h>
+#else
+# include <sys/types.h>
+# include <sys/socket.h>
+# include <netdb.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include "cool/ng/error.h"
+#include "cool/ng/exception.h"
+#include "cool/ng/impl/async/net_resolver.h"
+
+namespace cool { namespace ng { namespace async { namespace net { namespace impl {
+
+namespace ip = cool::ng::net::ip;
+using cool::ng::error::errc;
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+class resolver : public detail::itf::resolver
+{
+  struct entry
+  {
+    entry() : pending(false)
+    { /* noop */ }
+
+    bool                           pending;   // lookup in progress
+    std::vector<ip::host_container> hosts;
+    std::error_code                error;
+    clock_type::time_point         expires;
+    std::vector<callback>          waiters;
+  };
+
+  // shared with the lookup threads, which may outlive the resolver if they
+  // are blocked in the system resolver when the resolver is destroyed
+  struct state
+  {
+    state(const std::chrono::milliseconds& ttl_, const std::chrono::milliseconds& negative_ttl_)
+      : ttl(ttl_), negative_ttl(negative_ttl_), stopped(false), lookups(0), purge_at(64)
+    { /* noop */ }
+
+    const std::chrono::milliseconds ttl;
+    const std::chrono::milliseconds negative_ttl;
+    std::mutex                      lock;
+    std::condition_variable         cv;
+    std::deque<std::string>         queue;
+    std::map<std::string, entry>    cache;
+    bool                            stopped;
+    std::size_t                     lookups;
+    std::size_t                     purge_at;   // cache size that triggers removal of expired entries
+  };
+
+ public:
+  resolver(std::size_t threads_, const std::chrono::milliseconds& ttl_, const std::chrono::milliseconds& negative_ttl_)
+    : m_state(std::make_shared<state>(ttl_, negative_ttl_))
+  {
+    for (std::size_t i = 0; i < threads_; ++i)
+      std::thread(worker, m_state).detach();
+  }
+
+  ~resolver()
+  {
+    std::vector<callback> aborted;
+    {
+      std::unique_lock<std::mutex> l(m_state->lock);
+      m_state->stopped = true;
+      m_state->queue.clear();
+      for (auto& e : m_state->cache)
+        aborted.insert(aborted.end(), e.second.waiters.begin(), e.second.waiters.end());
+      m_state->cache.clear();
+    }
+    m_state->cv.notify_all();
+
+    std::error_code err = cool::ng::error::errc::request_aborted;
+    for (auto& cb : aborted)
+      try { cb(std::vector<ip::host_container>(), err); } catch (...) { /* noop */ }
+  }
+
+  void lookup(const std::string& name_, const callback& cb_) override
+  {
+    std::vector<ip::host_container> hosts;
+    std::error_code err;
+    {
+      std::unique_lock<std::mutex> l(m_state->lock);
+      auto now = clock_type::now();
+      auto it = m_state->cache.find(name_);
+      if (it == m_state->cache.end())
+      {
+        purge(now);
+        it = m_state->cache.emplace(name_, entry()).first;
+      }
+
+      auto& e = it->second;
+      if (e.pending)
+      {
+        e.waiters.push_back(cb_);
+        return;
+      }
+
+      if (e.expires <= now)
+      {
+        e.pending = true;
+        e.waiters.push_back(cb_);
+        m_state->queue.push_back(name_);
+        m_state->cv.notify_one();
+        return;
+      }
+
+      hosts = e.hosts;
+      err = e.error;
+    }
+
+    cb_(hosts, err);
+  }
+
+  void flush() override
+  {
+    std::unique_lock<std::mutex> l(m_state->lock);
+    for (auto it = m_state->cache.begin(); it != m_state->cache.end(); )
+    {
+      if (it->second.pending)
+        ++it;
+      else
+        it = m_state->cache.erase(it);
+    }
+  }
+
+  std::size_t lookups() const override
+  {
+    std::unique_lock<std::mutex> l(m_state->lock);
+    return m_state->lookups;
+  }
+
+ private:
+  // must be called with the lock held
+  void purge(const clock_type::time_point& now_)
+  {
+    if (m_state->cache.size() < m_state->purge_at)
+      return;
+
+    for (auto it = m_state->cache.begin(); it != m_state->cache.end(); )
+    {
+      if (!it->second.pending && it->second.expires <= now_)
+        it = m_state->cache.erase(it);
+      else
+        ++it;
+    }
+    m_state->purge_at = std::max<std::size_t>(64, 2 * m_state->cache.size());
+  }
+
+  static std::error_code resolve(const std::string& name_, std::vector<ip::host_container>& hosts_)
+  {
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo* res = nullptr;
+    auto rc = ::getaddrinfo(name_.c_str(), nullptr, &hints, &res);
+    if (rc != 0)
+    {
+      switch (rc)
+      {
+        case EAI_NONAME:
+#if defined(EAI_NODATA) && EAI_NODATA != EAI_NONAME
+        case EAI_NODATA:
+#endif
+        case EAI_FAIL:
+          return errc::name_not_found;
+
+        default:
+          return errc::request_failed;
+      }
+    }
+
+    for (auto ai = res; ai != nullptr; ai = ai->ai_next)
+    {
+      if (ai->ai_family != AF_INET && ai->ai_family != AF_INET6)
+        continue;
+
+      sockaddr_storage addr;
+      std::memset(&addr, 0, sizeof(addr));
+      std::memcpy(&addr, ai->ai_addr, ai->ai_addrlen);
+      hosts_.push_back(ip::host_container(addr));
+    }
+    ::freeaddrinfo(res);
+
+    if (hosts_.empty())
+      return errc::name_not_found;
+    return cool::ng::error::no_error();
+  }
+
+  static void worker(std::shared_ptr<state> s_)
+  {
+    std::unique_lock<std::mutex> l(s_->lock);
+    while (true)
+    {
+      s_->cv.wait(l, [&s_] () { return s_->stopped || !s_->queue.empty(); });
+      if (s_->stopped)
+        return;
+
+      auto name = s_->queue.front();
+      s_->queue.pop_front();
+      ++s_->lookups;
+      l.unlock();
+
+      std::vector<ip::host_container> hosts;
+      auto err = resolve(name, hosts);
+
+      l.lock();
+      if (s_->stopped)
+        return;   // the waiters were notified by the resolver's destructor
+
+      auto& e = s_->cache[name];
+      e.pending = false;
+      e.hosts = hosts;
+      e.error = err;
+      e.expires = clock_type::now() + (err ? s_->negative_ttl : s_->ttl);
+      std::vector<callback> waiters;
+      waiters.swap(e.waiters);
+      l.unlock();
+
+      for (auto& cb : waiters)
+        try { cb(hosts, err); } catch (...) { /* noop */ }
+
+      l.lock();
+    }
+  }
+
+ private:
+  std::shared_ptr<state> m_state;
+};
+
+} // anonymous namespace
+
+std::shared_ptr<detail::itf::resolver> create_resolver(
+    std::size_t threads_
+  , const std::chrono::milliseconds& ttl_
+  , const std::chrono::milliseconds& negative_ttl_)
+{
+  return std::make_shared<resolver>(threads_, ttl_, negative_ttl_);
+}
+
+} } } } } // namespace
@@ -33,9 +33,59 @@
 
 namespace cool { namespace ng { namespace async {
 
-runner::runner(RunPolicy policy_)
+namespace {
+
+thread_local deadline::clock::time_point current_deadline = deadline::clock::time_point::max();
+thread_local RunPriority current_priority = RunPriority::DEFAULT;
+
+} // anonymous namespace
+
+deadline::deadline(const clock::time_point& when_)
+    : m_previous(current_deadline)
+{
+  current_deadline = when_;
+}
+
+deadline::deadline(const clock::duration& timeout_)
+    : m_previous(current_deadline)
+{
+  current_deadline = clock::now() + timeout_;
+}
+
+deadline::~deadline()
+{
+  current_deadline = m_previous;
+}
+
+deadline::clock::time_point deadline::current()
+{
+  return current_deadline;
+}
+
+void deadline::set(const clock::time_point& when_)
+{
+  current_deadline = when_;
+}
+
+task_priority::task_priority(RunPriority priority_)
+    : m_previous(current_priority)
+{
+  current_priority = priority_;
+}
+
+task_priority::~task_priority()
+{
+  current_priority = m_previous;
+}
+
+RunPriority task_priority::current()
 {
-  m_impl = std::make_shared<impl::executor>(policy_);
+  return current_priority;
+}
+
+runner::runner(RunPolicy policy_, RunPriority priority_)
+{
+  m_impl = std::make_shared<impl::executor>(policy_, priority_);
 }
 
 runner::~runner()
@@ -46,6 +96,123 @@ const std::string& runner::name() const
   return m_impl->name();
 }
 
+RunPriority runner::priority() const
+{
+  return m_impl->priority();
+}
+
+void runner::affinity(const std::vector<unsigned int>& cpus_)
+{
+  m_impl->affinity(cpus_);
+}
+
+std::vector<unsigned int> runner::affinity() const
+{
+  return m_impl->affinity();
+}
+
+std::size_t runner::queue_depth() const
+{
+  return m_impl->queue_depth();
+}
+
+void runner::capacity(std::size_t capacity_, OverflowPolicy policy_)
+{
+  m_impl->capacity(capacity_, policy_);
+}
+
+std::size_t runner::capacity() const
+{
+  return m_impl->capacity();
+}
+
+void runner::shed_expired(bool enable_)
+{
+  m_impl->shed_expired(enable_);
+}
+
+std::size_t runner::shed_count() const
+{
+  return m_impl->shed_count();
+}
+
+void runner::weighted_lanes(bool enable_)
+{
+  m_impl->weighted_lanes(enable_);
+}
+
+void runner::spin_period(const std::chrono::microseconds& period_)
+{
+  m_impl->spin_period(period_);
+}
+
+bool runner::run_one()
+{
+  return m_impl->run_one();
+}
+
+std::size_t runner::poll()
+{
+  return m_impl->poll();
+}
+
+std::size_t runner::run_until_idle()
+{
+  return m_impl->run_until_idle();
+}
+
+void runner::worker_pool(std::size_t min_threads_, std::size_t max_threads_)
+{
+  impl::executor::configure_pool(min_threads_, max_threads_);
+}
+
+std::size_t runner::worker_threads()
+{
+  return impl::executor::pool_threads();
+}
+
+void runner::worker_affinity(const std::vector<unsigned int>& cpus_)
+{
+  impl::executor::pool_affinity(cpus_);
+}
+
+std::vector<unsigned int> runner::numa_cpus(unsigned int node_)
+{
+  return impl::executor::numa_cpus(node_);
+}
+
+// The system-wide runners are created on the first use and live until the
+// end of the process
+std::shared_ptr<runner> runner::sys_high()
+{
+  static auto r = std::make_shared<runner>(RunPolicy::CONCURRENT, RunPriority::HIGH);
+  return r;
+}
+
+std::shared_ptr<runner> runner::sys_default()
+{
+  static auto r = std::make_shared<runner>(RunPolicy::CONCURRENT, RunPriority::DEFAULT);
+  return r;
+}
+
+std::shared_ptr<runner> runner::sys_low()
+{
+  static auto r = std::make_shared<runner>(RunPolicy::CONCURRENT, RunPriority::LOW);
+  return r;
+}
+
+std::shared_ptr<runner> runner::sys_background()
+{
+  static auto r = std::make_shared<runner>(RunPolicy::CONCURRENT, RunPriority::BACKGROUND);
+  return r;
+}
+
+std::shared_ptr<runner> runner::cool_default()
+{
+  static auto r = std::make_shared<runner>(RunPolicy::SEQUENTIAL, RunPriority::DEFAULT);
+  return r;
+}
+
 const std::shared_ptr<impl::executor>& runner::impl() const
 {
   return m_impl;
@@ -53,7 +220,7 @@ const std::shared_ptr<impl::executor>& runner::impl() const
 
 namespace detail {
 
-void kickstart(context_stack* ctx_)
+bool kickstart(context_stack* ctx_)
 {
   if (!ctx_)
     throw exception::no_context();
@@ -62,7 +229,9 @@ void kickstart(context_stack* ctx_)
   if (!aux)
     throw exception::runner_not_available();
 
-  aux->impl()->run(ctx_);
+  ctx_->m_deadline = deadline::current();
+  ctx_->m_priority = task_priority::current();
+  return aux->impl()->submit(ctx_);
 }
 
 }
@@ -199,6 +199,27 @@ std::shared_ptr<detail::itf::timer> create_timer(
   return impl_;
 }
 
+std::shared_ptr<detail::itf::notifier> create_notifier(const detail::itf::notifier::task_type&)
+{
+  throw exc::operation_failed(cool::ng::error::errc::not_available);
+}
+
+std::shared_ptr<detail::itf::signal> create_signal(int, const detail::itf::signal::task_type&)
+{
+  throw exc::operation_failed(cool::ng::error::errc::not_available);
+}
+
+std::shared_ptr<detail::itf::watcher> create_watcher(
+    const std::shared_ptr<runner>&
+  , cool::ng::net::handle
+  , readiness
+  , bool
+  , const cb::watcher::weak_ptr&
+  , const std::function<void()>&)
+{
+  throw exc::operation_failed(cool::ng::error::errc::not_available);
+}
+
 } // namespace impl
 
 // ==========================================================================
@@ -236,6 +257,42 @@ void set_address(sockaddr_in6& sa_, const ip::address& a_, uint16_t port_, socka
   size = sizeof(sa_);
 }
 
+void set_option(handle h_, int level_, int name_, int value_)
+{
+  if (setsockopt(h_, level_, name_, reinterpret_cast<const char*>(&value_), sizeof(value_)) == SOCKET_ERROR)
+    throw exc::socket_failure();
+}
+
+// applies the options that were set to the socket; options without
+// Winsock equivalent are reported as not available
+void apply_options(handle h_, const cool::ng::async::net::socket_options& opts_)
+{
+  using option = cool::ng::async::net::socket_options::option;
+
+  if (opts_.empty())
+    return;
+
+  if (opts_.is_set(option::quick_ack) || opts_.is_set(option::cork) || opts_.is_set(option::busy_poll))
+    throw exc::operation_failed(cool::ng::error::errc::not_available);
+
+  if (opts_.is_set(option::no_delay))
+    set_option(h_, IPPROTO_TCP, TCP_NODELAY, opts_.no_delay() ? 1 : 0);
+  if (opts_.is_set(option::send_buffer))
+    set_option(h_, SOL_SOCKET, SO_SNDBUF, opts_.send_buffer());
+  if (opts_.is_set(option::receive_buffer))
+    set_option(h_, SOL_SOCKET, SO_RCVBUF, opts_.receive_buffer());
+  if (opts_.is_set(option::keep_alive))
+  {
+    set_option(h_, SOL_SOCKET, SO_KEEPALIVE, opts_.keep_alive() ? 1 : 0);
+    if (opts_.keep_alive() && opts_.keep_alive_idle() > 0)
+      set_option(h_, IPPROTO_TCP, TCP_KEEPIDLE, opts_.keep_alive_idle());
+    if (opts_.keep_alive() && opts_.keep_alive_interval() > 0)
+      set_option(h_, IPPROTO_TCP, TCP_KEEPINTVL, opts_.keep_alive_interval());
+    if (opts_.keep_alive() && opts_.keep_alive_count() > 0)
+      set_option(h_, IPPROTO_TCP, TCP_KEEPCNT, opts_.keep_alive_count());
+  }
+}
+
 } // anonymous namespace
 
 // --------------------------------------------------------------------------
@@ -284,6 +341,13 @@ server::~server()
   TRACE("server", "server deleted");
 }
 
+// Windows 10 does support AF_UNIX sockets but not with AcceptEx and ConnectEx
+// extensions, on which the completion port implementation relies
+void server::initialize(const cool::ng::net::local::address&)
+{
+  throw exc::operation_failed(cool::ng::error::errc::not_available);
+}
+
 void server::initialize(const cool::ng::net::ip::address& addr_, uint16_t port_)
 {
   m_sock_type = addr_.version() == ip::version::ipv6 ? AF_INET6 : AF_INET;
@@ -540,7 +604,7 @@ class exec_for_accept : public cool::ng::async::detail::event_context
       {
         // use factory to get new stream instance, install client handle
         // and do final on_connect callback
-        auto s = cb->manufacture(self->m_addr, self->m_port);
+        auto s = cb->manufacture(self->m_addr, self->m_port, -1);
         server::install_handle(s, self->m_handle);
         try { cb->on_connect(s); } catch (...) { }
       }
@@ -640,6 +704,28 @@ void server::process_accept()
     // TODO: error handling
   }
 
+  try
+  {
+    cool::ng::async::net::socket_options opts;
+    {
+      std::unique_lock<async::impl::critical_section> l(m_cs);
+      opts = m_options;
+    }
+    apply_options(m_client_handle, opts);
+  }
+  catch (const cool::ng::exception::base& e)
+  {
+    closesocket(m_client_handle);
+    m_client_handle = invalid_handle;
+
+    auto cb = m_handler.lock();
+    if (cb)
+      try { cb->on_event(e.code()); } catch (...) { /* noop */ }
+
+    start_accept();
+    return;
+  }
+
   ip::host_container addr = *remote;
   uint16_t port = ntohs(remote->ss_family == AF_INET
     ? reinterpret_cast<sockaddr_in*>(remote)->sin_port
@@ -670,9 +756,41 @@ void server::process_accept()
   start_accept();
 }
 
+void server::options(const cool::ng::async::net::socket_options& opts_)
+{
+  using option = cool::ng::async::net::socket_options::option;
+
+  // buffer sizes set on the listening socket are inherited by the accepted
+  // sockets
+  cool::ng::async::net::socket_options listen_opts;
+  if (opts_.is_set(option::send_buffer))
+    listen_opts.send_buffer(opts_.send_buffer());
+  if (opts_.is_set(option::receive_buffer))
+    listen_opts.receive_buffer(opts_.receive_buffer());
+  apply_options(m_handle, listen_opts);
+
+  std::unique_lock<async::impl::critical_section> l(m_cs);
+  m_options.merge(opts_);
+}
+
+void server::max_connections(std::size_t)
+{
+  throw exc::operation_failed(cool::ng::error::errc::not_available);
+}
+
+std::size_t server::connections() const
+{
+  throw exc::operation_failed(cool::ng::error::errc::not_available);
+}
+
+void server::drain(const std::function<void()>&, const std::chrono::milliseconds&)
+{
+  throw exc::operation_failed(cool::ng::error::errc::not_available);
+}
+
 void server::install_handle(cool::ng::async::net::stream& s_, cool::ng::net::handle h_)
 {
-  s_.m_impl->set_handle(h_);
+  s_.m_impl->set_handle(h_, std::shared_ptr<void>());
 }
 // --------------------------------------------------------------------------
 // --------------------------------------------------------------------------
@@ -882,17 +1000,29 @@ void stream::initialize(const cool::ng::net::ip::address& addr_
   connect(addr_, port_);
 }
 
+void stream::initialize(const cool::ng::net::local::address& addr_
+                      , void* buf_
+                      , std::size_t bufsz_)
+{
+  m_rd_size = bufsz_;
+  m_rd_data = buf_;
+
+  connect(addr_);
+}
+
 void stream::initialize(void* buf_, std::size_t bufsz_)
 {
   m_rd_size = bufsz_;
   m_rd_data = buf_;
 }
 
-void stream::set_handle(handle h_)
+void stream::set_handle(handle h_, const std::shared_ptr<void>&)
 {
   TRACE(name(), "setting handle");
   try
   {
+    apply_options(h_, get_options());
+
     auto cp = new context::sptr(new context(m_pool, self().lock(), m_rd_data, m_rd_size));
 
     (*cp)->set_handle(cp, h_);
@@ -925,8 +1055,40 @@ void stream::set_handle(handle h_)
   }
 }
 
+cool::ng::async::net::socket_options stream::get_options()
+{
+  std::unique_lock<async::impl::critical_section> l(m_opt_cs);
+  return m_options;
+}
+
+void stream::options(const cool::ng::async::net::socket_options& opts_)
+{
+  {
+    std::unique_lock<async::impl::critical_section> l(m_opt_cs);
+    m_options.merge(opts_);
+  }
+
+  if (get_state() == state::connected)
+  {
+    auto cp = m_context.load();
+    if (cp != nullptr)
+      apply_options((*cp)->m_handle, opts_);
+  }
+}
+
+void stream::set_timeouts(const cool::ng::async::net::timeouts& t_)
+{
+  if (t_.connect.count() != 0 || t_.read_idle.count() != 0 || t_.write_stall.count() != 0)
+    throw exc::operation_failed(cool::ng::error::errc::not_available);
+}
+
 // This method is always called from the user code in the context of the
 // user thread; either from the stream's ctor or using connect API call
+void stream::connect(const cool::ng::net::local::address&)
+{
+  throw exc::operation_failed(cool::ng::error::errc::not_available);
+}
+
 void stream::connect(const ip::address& addr_, uint16_t port_)
 {
   handle handle = invalid_handle;
@@ -955,6 +1117,8 @@ void stream::connect(const ip::address& addr_, uint16_t port_)
 
   try
   {
+    apply_options((*cp)->m_handle, get_options());
+
     // TODO: is this needed to client sockets, too?
     if (addr_.version() == ip::version::ipv6)
     {
@@ -1185,6 +1349,32 @@ void stream::write(const void* data, std::size_t size)
   start_write_source(cp);
 }
 
+void stream::write(const cool::ng::async::net::payload& data_)
+{
+  if (!data_ || data_.size() == 0)
+    throw exc::illegal_argument();
+
+  auto cp = m_context.load();
+  if (get_state() != state::connected)
+    throw exc::invalid_state();
+
+  {
+    std::unique_lock<async::impl::critical_section> l((*cp)->m_wr_cs);
+    bool expected = false;
+    if (!(*cp)->m_wr_busy.compare_exchange_strong(expected, true))
+    {
+      (*cp)->m_wr_queue.push_back(data_);
+      return;
+    }
+  }
+
+  (*cp)->m_wr_payload = data_;
+  (*cp)->m_wr_data = static_cast<const uint8_t*>(data_.data());
+  (*cp)->m_wr_size = data_.size();
+  (*cp)->m_wr_pos = 0;
+  start_write_source(cp);
+}
+
 
 void stream::start_read_source(context::sptr* cp)
 {
@@ -1557,15 +1747,37 @@ void stream::process_event_write(context::sptr* cp_, ULONG_PTR num_transferred_,
   (*cp_)->m_wr_pos += num_transferred_;
   if ((*cp_)->m_wr_pos >= (*cp_)->m_wr_size)  // write complete, remove busy flag and notify user
   {
-    (*cp_)->m_wr_busy = false;
+    auto data = (*cp_)->m_wr_data;
+    auto size = (*cp_)->m_wr_size;
+    auto completed = std::move((*cp_)->m_wr_payload);
+    (*cp_)->m_wr_payload = cool::ng::async::net::payload();
+
+    bool more = false;
+    {
+      std::unique_lock<async::impl::critical_section> l((*cp_)->m_wr_cs);
+      if ((*cp_)->m_wr_queue.empty())
+      {
+        (*cp_)->m_wr_busy = false;
+      }
+      else
+      {
+        (*cp_)->m_wr_payload = std::move((*cp_)->m_wr_queue.front());
+        (*cp_)->m_wr_queue.pop_front();
+        (*cp_)->m_wr_data = static_cast<const uint8_t*>((*cp_)->m_wr_payload.data());
+        (*cp_)->m_wr_size = (*cp_)->m_wr_payload.size();
+        (*cp_)->m_wr_pos = 0;
+        more = true;
+      }
+    }
+    if (more)
+      start_write_source(cp_);
+
     auto ex = m_executor.lock();
     if (ex)
     {
       auto handler = m_handler;
-      auto data = (*cp_)->m_wr_data;
-      auto size = (*cp_)->m_wr_size;
       auto exe_ctx = new exec_for_io(&(*cp_)->m_environ,
-        [handler, data, size]()
+        [handler, data, size, completed]()
         {
           auto cb = handler.lock();
           if (cb) try { cb->on_write(data, size); } catch (...) { }
@@ -1652,6 +1864,33 @@ void stream::on_event(PVOID overlapped_, ULONG io_result_, ULONG_PTR num_transfe
 }
 #endif
 
-} } } } }
+} } // namespace net::impl
 
+// ==========================================================================
+// ======
+// ======
+// ====== Interprocess communication event sources
+// ======
+// ======
+// ==========================================================================
+namespace ipc { namespace impl {
 
+channel::channel(const std::weak_ptr<async::impl::executor>&
+               , const net::impl::cb::stream::weak_ptr&)
+  : named("si.digiverse.ng.cool.channel")
+{ /* noop */ }
+
+void channel::initialize(const std::string&, mode, std::size_t)
+{
+  throw exc::operation_failed(cool::ng::error::errc::not_available);
+}
+
+void channel::write(const void*, std::size_t)
+{
+  throw exc::operation_failed(cool::ng::error::errc::not_available);
+}
+
+void channel::shutdown()
+{ /* noop */ }
+
+} } } } }
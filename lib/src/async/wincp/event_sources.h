@@ -28,6 +28,7 @@
 #include <memory>
 #include <functional>
 #include <cstdint>
+#include <deque>
 
 #include <winsock2.h>
 #include <ws2tcpip.h>
@@ -35,7 +36,9 @@
 
 #include "cool/ng/bases.h"
 #include "cool/ng/ip_address.h"
+#include "cool/ng/local_address.h"
 #include "cool/ng/async/task.h"
+#include "cool/ng/async/net/stream.h"
 #include "cool/ng/impl/async/event_sources_types.h"
 
 #include "executor.h"
@@ -114,7 +117,7 @@ class timer : public cool::ng::util::named
 
 namespace net { namespace impl {
 
-class server : public async::detail::itf::startable
+class server : public detail::itf::server
              , public cool::ng::util::named
              , public cool::ng::util::self_aware<server>
 {
@@ -137,10 +140,15 @@ class server : public async::detail::itf::startable
   ~server();
 
   void initialize(const cool::ng::net::ip::address& addr_, uint16_t port_);
+  void initialize(const cool::ng::net::local::address& addr_);
   const std::string& name() const { return named::name(); }
   void start() override;
   void stop() override;
   void shutdown() override;
+  void options(const cool::ng::async::net::socket_options& opts_) override;
+  void max_connections(std::size_t max_) override;
+  std::size_t connections() const override;
+  void drain(const std::function<void()>& handler_, const std::chrono::milliseconds& grace_) override;
 
   static void install_handle(cool::ng::async::net::stream& s_, cool::ng::net::handle h_);
 
@@ -177,6 +185,7 @@ class server : public async::detail::itf::startable
 
   async::impl::critical_section m_cs;
   ptr*                      m_context;
+  cool::ng::async::net::socket_options m_options;  // for accepted connections, protected by m_cs
 };
 
 /*
@@ -232,6 +241,9 @@ class stream : public detail::itf::connected_writable
     std::size_t       m_wr_size;
     std::size_t       m_wr_pos;
     DWORD             m_written_bytes;
+    cool::ng::async::net::payload m_wr_payload;   // keeps payload alive while being written
+    async::impl::critical_section m_wr_cs;        // protects the payload write queue
+    std::deque<cool::ng::async::net::payload> m_wr_queue;
 
     // threadpool stuff
     TP_CALLBACK_ENVIRON m_environ;
@@ -247,6 +259,9 @@ class stream : public detail::itf::connected_writable
                 , uint16_t port_
                 , void* buf_
                 , std::size_t bufsz_);
+  void initialize(const cool::ng::net::local::address& addr_
+                , void* buf_
+                , std::size_t bufsz_);
   void initialize(void* buf_, std::size_t bufsz_);
 
   // event_source interface
@@ -255,13 +270,19 @@ class stream : public detail::itf::connected_writable
 
   // connected writable interface
   void write(const void* data, std::size_t size) override;
+  void write(const cool::ng::async::net::payload& data_) override;
   void connect(const cool::ng::net::ip::address& addr_, uint16_t port_) override;
+  void connect(const cool::ng::net::local::address& addr_) override;
   void disconnect() override;
-  void set_handle(cool::ng::net::handle h_) override;
+  void set_handle(cool::ng::net::handle h_, const std::shared_ptr<void>& slot_) override;
+  void options(const cool::ng::async::net::socket_options& opts_) override;
+  void set_timeouts(const cool::ng::async::net::timeouts& t_) override;
 
  private:
   friend class exec_for_io;
 
+  cool::ng::async::net::socket_options get_options();
+
   void start_read_source(context::sptr* cp_);
   void start_write_source(context::sptr* cp_);
 
@@ -299,9 +320,40 @@ private:
   // reader part - original parameters
   std::size_t                          m_rd_size;
   void*                                m_rd_data;
+
+  async::impl::critical_section        m_opt_cs;        // protects socket options
+  cool::ng::async::net::socket_options m_options;
+};
+
+} } // namespace net::impl
+
+// ==========================================================================
+// ======
+// ======
+// ====== Interprocess communication event sources
+// ======
+// ======
+// ==========================================================================
+namespace ipc { namespace impl {
+
+// shared memory channels are not implemented on Windows; the class only
+// exists to report this to the user
+class channel : public async::detail::itf::writable
+              , public cool::ng::util::named
+              , public cool::ng::util::self_aware<channel>
+{
+ public:
+  channel(const std::weak_ptr<async::impl::executor>& ex_
+        , const net::impl::cb::stream::weak_ptr& cb_);
+
+  void initialize(const std::string& name_, mode mode_, std::size_t capacity_);
+
+  // writable interface
+  void write(const void* data_, std::size_t size_) override;
+  void shutdown() override;
+  const std::string& name() const override { return named::name(); }
 };
 
 } } } } } // namespace
 
 #endif
-
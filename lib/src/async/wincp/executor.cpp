@@ -48,6 +48,8 @@ CONSTEXPR_ const int TASK = 1;
 
 poolmgr::weak_ptr poolmgr::m_self;
 critical_section  poolmgr::m_cs;
+std::size_t       poolmgr::m_min = 0;
+std::size_t       poolmgr::m_max = 0;
 
 poolmgr::poolmgr() : m_pool(nullptr)
 {
@@ -58,6 +60,7 @@ poolmgr::poolmgr() : m_pool(nullptr)
 
   // Associate the callback environment with our thread pool.
   SetThreadpoolCallbackPool(&m_environ, m_pool);
+  apply_limits();
 
   TRACE("poolmgr", "this=" << this << ", env=" << &m_environ);
 }
@@ -96,6 +99,32 @@ poolmgr::ptr poolmgr::get_poolmgr()
   return ret;
 }
 
+// The limits are remembered and applied to the thread pool whenever it is
+// (re)created, since the pool is destroyed with its last runner
+void poolmgr::set_limits(std::size_t min_, std::size_t max_)
+{
+  if (max_ == 0 || min_ > max_)
+    throw exception::illegal_argument();
+
+  std::unique_lock<critical_section> l(m_cs);
+  m_min = min_;
+  m_max = max_;
+
+  auto pool = m_self.lock();
+  if (pool)
+    pool->apply_limits();
+}
+
+void poolmgr::apply_limits()
+{
+  if (m_max == 0)
+    return;
+
+  SetThreadpoolThreadMaximum(m_pool, static_cast<DWORD>(m_max));
+  if (!SetThreadpoolThreadMinimum(m_pool, static_cast<DWORD>(m_min)))
+    throw exception::threadpool_failure();
+}
+
 
 struct executor_cleanup
 {
@@ -109,30 +138,57 @@ struct executor_cleanup
 };
 
 
-executor::executor(RunPolicy policy_)
+executor::executor(RunPolicy policy_, RunPriority priority_)
     : named("runner") // named("si.digiverse.ng.cool.runner")
     , m_work(nullptr)
     , m_fifo(nullptr)
     , m_pool(poolmgr::get_poolmgr())
+    , m_priority(priority_)
     , m_work_in_progress(false)
     , m_active(true)
+    , m_depth(0)
+    , m_capacity(0)
     , m_lock(SRWLOCK_INIT)
 {
   TRACE(name(), "new " << this);
 
+  if (policy_ == RunPolicy::EARLIEST_DEADLINE
+      || policy_ == RunPolicy::BUSY_POLL
+      || policy_ == RunPolicy::MANUAL)
+    throw exception::operation_failed(cool::ng::error::errc::not_available);
+
   m_fifo = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1000);
   if (m_fifo == nullptr)
     throw exception::cp_failure();
 
+  // the runner uses its own callback environment to set the priority of its
+  // work; the thread pool serves the callbacks with higher priority first
+  InitializeThreadpoolEnvironment(&m_environ);
+  m_pool->add_environ(&m_environ);
+  switch (m_priority)
+  {
+    case RunPriority::HIGH:
+      SetThreadpoolCallbackPriority(&m_environ, TP_CALLBACK_PRIORITY_HIGH);
+      break;
+    case RunPriority::LOW:
+    case RunPriority::BACKGROUND:
+      SetThreadpoolCallbackPriority(&m_environ, TP_CALLBACK_PRIORITY_LOW);
+      break;
+    default:
+      SetThreadpoolCallbackPriority(&m_environ, TP_CALLBACK_PRIORITY_NORMAL);
+      break;
+  }
+
   try
   {
     // Create work with the callback environment.
-    m_work = CreateThreadpoolWork(task_executor, this, m_pool->get_environ());
+    m_work = CreateThreadpoolWork(task_executor, this, &m_environ);
     if (m_work.load() == nullptr)
       throw exception::threadpool_failure();
   }
   catch (...)
   {
+    DestroyThreadpoolEnvironment(&m_environ);
     CloseHandle(m_fifo);
     throw;
   }
@@ -169,6 +225,8 @@ executor::~executor()
     CloseHandle(m_fifo);
   }
 
+  DestroyThreadpoolEnvironment(&m_environ);
+
   TRACE(name(), "deleted");
 }
 
@@ -280,6 +338,7 @@ void executor::task_executor(PTP_WORK w_)
 
     case cool::ng::async::detail::work_type::task_work:
     {
+      --m_depth;
       auto stack = static_cast<cool::ng::async::detail::context_stack*>(static_cast<void*>(aux));
       auto context = stack->top();
       auto r = context->get_runner().lock();
@@ -313,6 +372,9 @@ void executor::run(cool::ng::async::detail::work* ctx_)
 {
   TRACE(name(), "run: " << ctx_);
 
+  if (ctx_->type() == cool::ng::async::detail::work_type::task_work)
+    ++m_depth;
+
   PostQueuedCompletionStatus(m_fifo, TASK, NULL, reinterpret_cast<LPOVERLAPPED>(ctx_));
 
   PTP_WORK w = m_work;
@@ -323,5 +385,73 @@ void executor::run(cool::ng::async::detail::work* ctx_)
   }
 }
 
+// The new tasks are rejected once the queue is full, which is the only
+// overflow policy available on Windows. The context stack of the rejected
+// task is deleted.
+bool executor::submit(cool::ng::async::detail::context_stack* ctx_)
+{
+  auto capacity = m_capacity.load();
+  if (capacity == 0 || m_depth < capacity)
+  {
+    run(ctx_);
+    return true;
+  }
+
+  delete ctx_;
+  return false;
+}
+
+void executor::capacity(std::size_t capacity_, OverflowPolicy policy_)
+{
+  if (capacity_ != 0 && policy_ != OverflowPolicy::REJECT)
+    throw exception::operation_failed(cool::ng::error::errc::not_available);
+
+  m_capacity = capacity_;
+}
+
+void executor::weighted_lanes(bool enable_)
+{
+  if (enable_)
+    throw exception::operation_failed(cool::ng::error::errc::not_available);
+}
+
+void executor::configure_pool(std::size_t min_, std::size_t max_)
+{
+  poolmgr::set_limits(min_, max_);
+}
+
+void executor::affinity(const std::vector<unsigned int>& cpus_)
+{
+  if (!cpus_.empty())
+    throw exception::operation_failed(cool::ng::error::errc::not_available);
+}
+
+void executor::pool_affinity(const std::vector<unsigned int>& cpus_)
+{
+  if (!cpus_.empty())
+    throw exception::operation_failed(cool::ng::error::errc::not_available);
+}
+
+std::vector<unsigned int> executor::numa_cpus(unsigned int node_)
+{
+  throw exception::operation_failed(cool::ng::error::errc::not_available);
+}
+
+// there are no manually stepped runners on Windows
+bool executor::run_one()
+{
+  throw exception::invalid_state();
+}
+
+std::size_t executor::poll()
+{
+  throw exception::invalid_state();
+}
+
+std::size_t executor::run_until_idle()
+{
+  throw exception::invalid_state();
+}
+
 
 } } } } // namespace
@@ -28,8 +28,11 @@
 #include <windows.h>
 
 #include <atomic>
+#include <chrono>
+#include <cstddef>
 #include <memory>
 #include <unordered_set>
+#include <vector>
 
 #include "cool/ng/bases.h"
 #include "cool/ng/async/runner.h"
@@ -51,12 +54,18 @@ class poolmgr
   PTP_CALLBACK_ENVIRON get_environ() { return &m_environ; }
   void add_environ(PTP_CALLBACK_ENVIRON e_);
   static ptr get_poolmgr();
+  static void set_limits(std::size_t min_, std::size_t max_);
+
+ private:
+  void apply_limits();
 
  private:
   PTP_POOL                        m_pool;
   TP_CALLBACK_ENVIRON             m_environ;
   static weak_ptr                 m_self;
   static critical_section         m_cs;
+  static std::size_t              m_min;   // 0 if limits not configured
+  static std::size_t              m_max;
 };
 
 
@@ -65,11 +74,29 @@ class executor : public ::cool::ng::util::named
   using queue_type = HANDLE;
 
  public:
-  executor(RunPolicy policy_);
+  executor(RunPolicy policy_, RunPriority priority_);
   ~executor();
 
   void run(detail::work*);
+  bool submit(detail::context_stack*);
   bool is_system() const { return false; }
+  std::size_t queue_depth() const { return m_depth; }
+  void capacity(std::size_t capacity_, OverflowPolicy policy_);
+  std::size_t capacity() const { return m_capacity; }
+  void shed_expired(bool) { /* noop */ }
+  std::size_t shed_count() const { return 0; }
+  void weighted_lanes(bool enable_);
+  void spin_period(const std::chrono::microseconds&) { /* noop */ }
+  bool run_one();
+  std::size_t poll();
+  std::size_t run_until_idle();
+  RunPriority priority() const { return m_priority; }
+  void affinity(const std::vector<unsigned int>& cpus_);
+  std::vector<unsigned int> affinity() const { return std::vector<unsigned int>(); }
+  static void configure_pool(std::size_t min_, std::size_t max_);
+  static std::size_t pool_threads() { return 0; }
+  static void pool_affinity(const std::vector<unsigned int>& cpus_);
+  static std::vector<unsigned int> numa_cpus(unsigned int node_);
 
  private:
   static VOID CALLBACK task_executor(PTP_CALLBACK_INSTANCE instance_, PVOID pv_, PTP_WORK work_);
@@ -81,9 +108,13 @@ class executor : public ::cool::ng::util::named
   std::atomic<PTP_WORK> m_work;
   queue_type        m_fifo;
   poolmgr::ptr      m_pool;
+  const RunPriority m_priority;
+  TP_CALLBACK_ENVIRON m_environ;   // pool environment with the runner's priority
 
   std::atomic<bool> m_work_in_progress;
   std::atomic<bool> m_active;
+  std::atomic<std::size_t> m_depth;   // tasks submitted but not yet started
+  std::atomic<std::size_t> m_capacity;   // 0 if unlimited
 
   SRWLOCK m_lock;
   std::unordered_set<void*> m_cleanup_environments;
@@ -67,6 +67,10 @@ std::string library_category::message(int ev) const
           "the destination rejected connection",
           "the destination is not reachable",
           "the request has failed",
+          "the operation did not complete in time",
+          "no data was received within the read idle timeout",
+          "the pending write made no progress within the write stall timeout",
+/*  20 */ "the host name could not be resolved",
   };
   static const char* const unknown = "unrecognized error";
 
@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2017 Leon Mlakar.
+ * Copyright (c) 2017 Digiverse d.o.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. The
+ * license should be included in the source distribution of the Software;
+ * if not, you may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and licensing terms shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <iostream>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <cstring>
+
+#define BOOST_TEST_MODULE FileEventSources
+#include <boost/test/unit_test.hpp>
+
+#include "cool/ng/bases.h"
+#include "cool/ng/async.h"
+#include "cool/ng/async/file.h"
+
+BOOST_AUTO_TEST_SUITE(file)
+
+namespace async = cool::ng::async;
+namespace exc = cool::ng::exception;
+using ms = std::chrono::milliseconds;
+
+class test_runner : public cool::ng::async::runner
+{ };
+
+void spin_wait(unsigned int msec, const std::function<bool()>& lambda)
+{
+  auto start = std::chrono::system_clock::now();
+  while (!lambda())
+  {
+    auto now = std::chrono::system_clock::now();
+    if (std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count() >= msec)
+      return;
+    std::this_thread::yield();
+  }
+}
+
+std::string temp_name()
+{
+  return "/tmp/cool-ng-es-file-" + std::to_string(::getpid());
+}
+
+// collects the completions reported to the completion task
+struct collector
+{
+  collector() : calls(0), wrong_runner(0)
+  { }
+
+  async::file::task_type task(const std::shared_ptr<test_runner>& r_)
+  {
+    return async::factory::create(
+        r_
+      , [this, r_] (const std::shared_ptr<test_runner>& r, async::file::completion c_)
+        {
+          std::unique_lock<std::mutex> l(lock);
+          if (r != r_)
+            ++wrong_runner;
+          results.push_back(c_);
+          ++calls;
+        }
+    );
+  }
+
+  std::mutex                            lock;
+  std::vector<async::file::completion>  results;
+  std::atomic<int>                      calls;
+  std::atomic<int>                      wrong_runner;
+};
+
+BOOST_AUTO_TEST_CASE(write_read)
+{
+  auto runner = std::make_shared<test_runner>();
+  auto name = temp_name();
+  collector c;
+
+  {
+    async::file f(name, O_RDWR | O_CREAT | O_TRUNC);
+    BOOST_CHECK(!!f);
+    BOOST_CHECK(f.native_handle() >= 0);
+
+    // non-overlapping writes may complete in any order
+    const char* part1 = "hello ";
+    const char* part2 = "world";
+    f.write(0, part1, 6, c.task(runner));
+    f.write(6, part2, 5, c.task(runner));
+    spin_wait(1000, [&c] () { return c.calls == 2; });
+    BOOST_REQUIRE_EQUAL(2, c.calls.load());
+    BOOST_CHECK_EQUAL(0, f.pending());
+    {
+      std::unique_lock<std::mutex> l(c.lock);
+      for (auto& r : c.results)
+      {
+        BOOST_CHECK(!r.error);
+        BOOST_CHECK_EQUAL(r.offset == 0 ? 6 : 5, r.size);
+        BOOST_CHECK(r.buffer == (r.offset == 0 ? part1 : part2));
+      }
+      c.results.clear();
+    }
+
+    f.sync(c.task(runner));
+    spin_wait(1000, [&c] () { return c.calls == 3; });
+    BOOST_REQUIRE_EQUAL(3, c.calls.load());
+
+    // the read past the end of file transfers the available bytes only
+    char buf[32];
+    std::memset(buf, 0, sizeof(buf));
+    f.read(0, buf, sizeof(buf), c.task(runner));
+    spin_wait(1000, [&c] () { return c.calls == 4; });
+    BOOST_REQUIRE_EQUAL(4, c.calls.load());
+    {
+      std::unique_lock<std::mutex> l(c.lock);
+      BOOST_CHECK(!c.results.back().error);
+      BOOST_CHECK_EQUAL(11, c.results.back().size);
+      BOOST_CHECK_EQUAL(std::string("hello world"), std::string(buf));
+    }
+
+    std::memset(buf, 0, sizeof(buf));
+    f.read(6, buf, 3, c.task(runner));
+    spin_wait(1000, [&c] () { return c.calls == 5; });
+    BOOST_REQUIRE_EQUAL(5, c.calls.load());
+    {
+      std::unique_lock<std::mutex> l(c.lock);
+      BOOST_CHECK_EQUAL(3, c.results.back().size);
+      BOOST_CHECK_EQUAL(6, c.results.back().offset);
+      BOOST_CHECK_EQUAL(std::string("wor"), std::string(buf));
+    }
+  }
+
+  BOOST_CHECK_EQUAL(0, c.wrong_runner.load());
+  ::unlink(name.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(errors)
+{
+  auto runner = std::make_shared<test_runner>();
+  auto name = temp_name();
+  collector c;
+
+  BOOST_CHECK_THROW(async::file("/nonexistent/cool-ng/file", O_RDONLY), std::system_error);
+  BOOST_CHECK_THROW(async::file(cool::ng::net::invalid_handle), exc::illegal_argument);
+  {
+    async::file::options opts;
+    opts.threads = 0;
+    BOOST_CHECK_THROW(async::file(name, O_RDWR | O_CREAT, 0644, opts), exc::illegal_argument);
+  }
+
+  {
+    // the file opened for writing only cannot be read
+    async::file f(name, O_WRONLY | O_CREAT | O_TRUNC);
+    char buf[8];
+    BOOST_CHECK_THROW(f.read(0, nullptr, 8, c.task(runner)), exc::illegal_argument);
+    BOOST_CHECK_THROW(f.read(0, buf, 8, async::file::task_type()), exc::illegal_argument);
+
+    f.read(0, buf, sizeof(buf), c.task(runner));
+    spin_wait(1000, [&c] () { return c.calls == 1; });
+    BOOST_REQUIRE_EQUAL(1, c.calls.load());
+    std::unique_lock<std::mutex> l(c.lock);
+    BOOST_CHECK(!!c.results.back().error);
+    BOOST_CHECK_EQUAL(EBADF, c.results.back().error.value());
+    BOOST_CHECK_EQUAL(0, c.results.back().size);
+  }
+
+  async::file empty;
+  BOOST_CHECK(!empty);
+  BOOST_CHECK_THROW(empty.pending(), exc::empty_object);
+  BOOST_CHECK_THROW(empty.sync(c.task(runner)), exc::empty_object);
+
+  ::unlink(name.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(completion_after_destruction)
+{
+  auto runner = std::make_shared<test_runner>();
+  auto name = temp_name();
+  collector c;
+  std::vector<char> data(1 << 20, 'x');
+
+  auto fd = ::open(name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  BOOST_REQUIRE(fd >= 0);
+  {
+    async::file::options opts;
+    opts.threads = 1;
+    async::file f(fd, true, opts);
+    for (int i = 0; i < 8; ++i)
+      f.write(i * data.size(), data.data(), data.size(), c.task(runner));
+  }
+
+  // the requests are completed and the descriptor closed afterwards
+  spin_wait(5000, [&c] () { return c.calls == 8; });
+  BOOST_CHECK_EQUAL(8, c.calls.load());
+  spin_wait(1000, [fd] () { return ::fcntl(fd, F_GETFD) == -1; });
+  BOOST_CHECK_EQUAL(-1, ::fcntl(fd, F_GETFD));
+  {
+    std::unique_lock<std::mutex> l(c.lock);
+    for (auto& r : c.results)
+      BOOST_CHECK_EQUAL(data.size(), r.size);
+  }
+
+  ::unlink(name.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
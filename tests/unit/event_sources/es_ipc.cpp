@@ -0,0 +1,361 @@
+/*
+ * Copyright (c) 2017 Leon Mlakar.
+ * Copyright (c) 2017 Digiverse d.o.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. The
+ * license should be included in the source distribution of the Software;
+ * if not, you may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and licensing terms shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <iostream>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstdlib>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define BOOST_TEST_MODULE IpcEventSources
+#include <boost/test/unit_test.hpp>
+
+#include "cool/ng/bases.h"
+#include "cool/ng/async.h"
+
+BOOST_AUTO_TEST_SUITE(ipc_sources)
+
+namespace async = cool::ng::async;
+namespace ipc = cool::ng::async::ipc;
+using cool::ng::async::net::detail::oob_event;
+using cool::ng::error::errc;
+
+class test_runner : public cool::ng::async::runner
+{ };
+
+void spin_wait(unsigned int msec, const std::function<bool()>& lambda)
+{
+  auto start = std::chrono::system_clock::now();
+  while (!lambda())
+  {
+    auto now = std::chrono::system_clock::now();
+    if (std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count() >= msec)
+      return;
+    std::this_thread::yield();
+  }
+}
+
+// collects messages and events reported by one side of the channel
+struct endpoint
+{
+  endpoint() : connected(false), disconnected(false), failed(false), written(0), received(0), errors(0)
+  { }
+
+  ipc::channel make(const std::shared_ptr<test_runner>& r_, const std::string& name_, ipc::mode mode_, std::size_t capacity_ = 4096)
+  {
+    return ipc::channel(
+        std::weak_ptr<test_runner>(r_)
+      , name_
+      , mode_
+      , [this] (const std::shared_ptr<test_runner>&, void*& buf_, std::size_t& size_)
+        {
+          // messages are written as sequence of 32 bit counters, starting with
+          // the message sequence number
+          auto p = static_cast<const uint32_t*>(buf_);
+          if (size_ % sizeof(uint32_t) != 0 || p[0] != received)
+            ++errors;
+          for (std::size_t i = 1; i < size_ / sizeof(uint32_t); ++i)
+            if (p[i] != p[0] + i)
+              ++errors;
+          ++received;
+        }
+      , [this] (const std::shared_ptr<test_runner>&, const void*, std::size_t)
+        {
+          ++written;
+        }
+      , [this] (const std::shared_ptr<test_runner>&, oob_event evt, const std::error_code& err)
+        {
+          if (evt == oob_event::connect)
+            connected = true;
+          else if (evt == oob_event::disconnect)
+            disconnected = true;
+          else if (evt == oob_event::failure && err == std::errc::bad_message)
+            failed = true;
+        }
+      , capacity_
+    );
+  }
+
+  std::atomic<bool>     connected;
+  std::atomic<bool>     disconnected;
+  std::atomic<bool>     failed;
+  std::atomic<unsigned> written;
+  std::atomic<unsigned> received;
+  std::atomic<unsigned> errors;
+};
+
+std::vector<uint32_t> message(unsigned seq_, std::size_t len_)
+{
+  std::vector<uint32_t> ret(len_);
+  for (std::size_t i = 0; i < len_; ++i)
+    ret[i] = static_cast<uint32_t>(seq_ + i);
+  return ret;
+}
+
+// sends messages of varying size, larger than the ring, to force ring wrap
+// around and writes that must wait for the free space
+void send(ipc::channel& ch_, endpoint& ep_, unsigned count_)
+{
+  for (unsigned i = 0; i < count_; ++i)
+  {
+    auto msg = message(i, 1 + (i * 37) % 300);
+    ch_.write(msg.data(), msg.size() * sizeof(uint32_t));
+    spin_wait(2000, [&ep_, i] () { return ep_.written == i + 1; });
+    BOOST_REQUIRE_EQUAL(i + 1, ep_.written);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(basic)
+{
+  const std::string name = "cool_ng_es_ipc_basic";
+  const unsigned count = 500;
+
+  auto r1 = std::make_shared<test_runner>();
+  auto r2 = std::make_shared<test_runner>();
+  endpoint creator;
+  endpoint peer;
+
+  {
+    auto ch1 = creator.make(r1, name, ipc::mode::create);
+    {
+      auto ch2 = peer.make(r2, name, ipc::mode::open);
+
+      spin_wait(1000, [&creator, &peer] () { return creator.connected && peer.connected; });
+      BOOST_CHECK(creator.connected);
+      BOOST_CHECK(peer.connected);
+
+      std::thread t([&ch2, &peer, count] () { send(ch2, peer, count); });
+      send(ch1, creator, count);
+      t.join();
+
+      spin_wait(2000, [&creator, &peer, count] () { return creator.received == count && peer.received == count; });
+      BOOST_CHECK_EQUAL(count, creator.received);
+      BOOST_CHECK_EQUAL(count, peer.received);
+      BOOST_CHECK_EQUAL(0, creator.errors);
+      BOOST_CHECK_EQUAL(0, peer.errors);
+    }
+
+    spin_wait(1000, [&creator] () { return creator.disconnected.load(); });
+    BOOST_CHECK(creator.disconnected);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(errors)
+{
+  const std::string name = "cool_ng_es_ipc_errors";
+
+  auto r = std::make_shared<test_runner>();
+  endpoint ep;
+
+  BOOST_CHECK_THROW(ep.make(r, "", ipc::mode::create), cool::ng::exception::illegal_argument);
+  BOOST_CHECK_THROW(ep.make(r, "a/b", ipc::mode::create), cool::ng::exception::illegal_argument);
+  BOOST_CHECK_THROW(ep.make(r, name, ipc::mode::open), cool::ng::exception::system_error);
+
+  {
+    auto ch1 = ep.make(r, name, ipc::mode::create);
+    BOOST_CHECK_THROW(ep.make(r, name, ipc::mode::create), cool::ng::exception::system_error);
+
+    auto ch2 = ep.make(r, name, ipc::mode::open);
+    try
+    {
+      ep.make(r, name, ipc::mode::open);
+      BOOST_FAIL("second open of the channel must fail");
+    }
+    catch (const cool::ng::exception::operation_failed& e)
+    {
+      BOOST_CHECK_EQUAL(static_cast<int>(errc::resource_busy), e.code().value());
+    }
+
+    std::vector<uint8_t> big(4096);
+    BOOST_CHECK_THROW(ch1.write(big.data(), big.size()), cool::ng::exception::illegal_argument);
+    BOOST_CHECK_THROW(ch1.write(big.data(), 0), cool::ng::exception::illegal_argument);
+  }
+
+  // channel must be removed when creator is destroyed
+  spin_wait(1000, [&ep, &r, &name] ()
+    {
+      try { ep.make(r, name, ipc::mode::open); } catch (...) { return true; }
+      return false;
+    }
+  );
+  BOOST_CHECK_THROW(ep.make(r, name, ipc::mode::open), cool::ng::exception::system_error);
+
+  ipc::channel empty;
+  BOOST_CHECK(!empty);
+  BOOST_CHECK_THROW(empty.write(&ep, 1), cool::ng::exception::empty_object);
+}
+
+// the side left attached by the process that terminated without closing
+// the channel may be opened again
+BOOST_AUTO_TEST_CASE(dead_peer)
+{
+  const std::string name = "cool_ng_es_ipc_dead_peer";
+
+  auto r = std::make_shared<test_runner>();
+  endpoint creator;
+  endpoint peer;
+
+  auto pid = ::fork();
+  BOOST_REQUIRE_NE(-1, pid);
+  if (pid == 0)
+    ::_exit(0);
+  ::waitpid(pid, nullptr, 0);
+
+  auto ch1 = creator.make(r, name, ipc::mode::create);
+
+  // the segment starts with the magic, the version and the capacity, which
+  // are followed by the pids of the attached processes
+  {
+    int fd = ::shm_open(("/" + name).c_str(), O_RDWR, 0);
+    BOOST_REQUIRE_NE(-1, fd);
+    auto addr = ::mmap(nullptr, 32, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    BOOST_REQUIRE(addr != MAP_FAILED);
+    auto attached = reinterpret_cast<uint32_t*>(static_cast<uint8_t*>(addr) + 16);
+    BOOST_REQUIRE_EQUAL(static_cast<uint32_t>(::getpid()), attached[0]);
+    attached[1] = static_cast<uint32_t>(pid);
+    ::munmap(addr, 32);
+  }
+
+  auto ch2 = peer.make(r, name, ipc::mode::open);
+  spin_wait(1000, [&creator, &peer] () { return creator.connected && peer.connected; });
+  BOOST_CHECK(creator.connected);
+  BOOST_CHECK(peer.connected);
+
+  // while the live peer is attached the channel remains busy
+  try
+  {
+    endpoint other;
+    other.make(r, name, ipc::mode::open);
+    BOOST_FAIL("open of the channel with the live peer must fail");
+  }
+  catch (const cool::ng::exception::operation_failed& e)
+  {
+    BOOST_CHECK_EQUAL(static_cast<int>(errc::resource_busy), e.code().value());
+  }
+}
+
+// the reader stops at the record whose size does not fit into the ring
+BOOST_AUTO_TEST_CASE(corrupt_ring)
+{
+  const std::string name = "cool_ng_es_ipc_corrupt_ring";
+  const std::size_t capacity = 4096;
+
+  auto r = std::make_shared<test_runner>();
+  endpoint creator;
+  endpoint peer;
+
+  auto ch1 = creator.make(r, name, ipc::mode::create, capacity);
+  auto ch2 = peer.make(r, name, ipc::mode::open);
+  spin_wait(1000, [&creator, &peer] () { return creator.connected && peer.connected; });
+  BOOST_REQUIRE(peer.connected);
+
+  // ten 32 bit counters take a record of 48 bytes
+  auto msg = message(0, 10);
+  ch1.write(msg.data(), msg.size() * sizeof(uint32_t));
+  spin_wait(1000, [&peer] () { return peer.received == 1; });
+  BOOST_REQUIRE_EQUAL(1, peer.received);
+
+  // the segment header of 64 bytes is followed by two rings of 192 bytes,
+  // the producer's index being the first field of the ring, and then by the
+  // data of the creator's ring; the bogus record claims more data than the
+  // ring holds
+  {
+    int fd = ::shm_open(("/" + name).c_str(), O_RDWR, 0);
+    BOOST_REQUIRE_NE(-1, fd);
+    const std::size_t size = 448 + 2 * capacity;
+    auto addr = static_cast<uint8_t*>(::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+    ::close(fd);
+    BOOST_REQUIRE(addr != MAP_FAILED);
+    auto head = reinterpret_cast<std::atomic<uint64_t>*>(addr + 64);
+    BOOST_REQUIRE_EQUAL(48, head->load());
+    *reinterpret_cast<uint64_t*>(addr + 448 + 48) = 1 << 20;
+    head->store(64);
+    ::munmap(addr, size);
+  }
+
+  // the next message wakes up the reader
+  msg = message(1, 10);
+  ch1.write(msg.data(), msg.size() * sizeof(uint32_t));
+  spin_wait(1000, [&peer] () { return peer.failed.load(); });
+  BOOST_CHECK(peer.failed);
+  spin_wait(50, [] () { return false; });
+  BOOST_CHECK_EQUAL(1, peer.received);
+  BOOST_CHECK_EQUAL(0, peer.errors);
+}
+
+// the fifos are created in the TMPDIR directory
+BOOST_AUTO_TEST_CASE(tmpdir)
+{
+  const std::string name = "cool_ng_es_ipc_tmpdir";
+
+  char dir[] = "/tmp/cool_ng_es_ipc_XXXXXX";
+  BOOST_REQUIRE(::mkdtemp(dir) != nullptr);
+  auto prev = std::getenv("TMPDIR");
+  std::string saved = prev == nullptr ? "" : prev;
+  ::setenv("TMPDIR", dir, 1);
+
+  auto r = std::make_shared<test_runner>();
+  {
+    endpoint creator;
+    endpoint peer;
+    auto ch1 = creator.make(r, name, ipc::mode::create);
+    auto ch2 = peer.make(r, name, ipc::mode::open);
+
+    struct stat st;
+    BOOST_CHECK_EQUAL(0, ::stat((std::string(dir) + "/" + name + ".ipc0").c_str(), &st));
+    BOOST_CHECK(S_ISFIFO(st.st_mode));
+    BOOST_CHECK_EQUAL(0, ::stat((std::string(dir) + "/" + name + ".ipc1").c_str(), &st));
+    BOOST_CHECK(S_ISFIFO(st.st_mode));
+
+    auto msg = message(0, 10);
+    ch1.write(msg.data(), msg.size() * sizeof(uint32_t));
+    spin_wait(1000, [&peer] () { return peer.received == 1; });
+    BOOST_CHECK_EQUAL(1, peer.received);
+    BOOST_CHECK_EQUAL(0, peer.errors);
+  }
+
+  // the creator removes the fifos once closed
+  spin_wait(1000, [&dir, &name] () { return ::access((std::string(dir) + "/" + name + ".ipc0").c_str(), F_OK) != 0; });
+  BOOST_CHECK_NE(0, ::access((std::string(dir) + "/" + name + ".ipc0").c_str(), F_OK));
+
+  if (prev == nullptr)
+    ::unsetenv("TMPDIR");
+  else
+    ::setenv("TMPDIR", saved.c_str(), 1);
+  ::rmdir(dir);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
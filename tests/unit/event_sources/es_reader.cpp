@@ -30,6 +30,9 @@
 #else
 # include <sys/types.h>
 # include <sys/socket.h>
+# include <netinet/in.h>
+# include <fcntl.h>
+# include <unistd.h>
 #endif
 
 #include <iostream>
@@ -40,19 +43,26 @@
 #include <functional>
 #include <atomic>
 #include <mutex>
+#include <vector>
 #include <thread>
 #include <chrono>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <condition_variable>
 #include <exception>
 
+#if defined(LINUX_TARGET)
+#include <dirent.h>
+#endif
+
 
 #define BOOST_TEST_MODULE NetworkEventSources
 #include <boost/test/unit_test.hpp>
 
 #include "cool/ng/bases.h"
 #include "cool/ng/async.h"
+#include "cool/ng/async/net/pool.h"
 
 // #include "test_server.h"
 
@@ -68,6 +78,18 @@
 #define TEST10 1
 #define TEST11 1
 #define TEST12 0  // this test may require shutting  down network interfaces
+#define TEST13 1
+#define TEST14 1
+#define TEST15 1
+#define TEST16 1
+#define TEST17 1
+#define TEST18 1
+#define TEST19 1
+#define TEST20 1
+#define TEST21 1
+#define TEST22 1
+#define TEST23 1
+#define TEST24 1
 
 using ms = std::chrono::milliseconds;
 using std::placeholders::_1;
@@ -1153,7 +1175,8 @@ BOOST_AUTO_TEST_CASE(long_connect_interrupted)
               rep_fail = true; err = e_; break;
             case oob_event::internal:
               rep_internal = true; err = e_; break;
-
+            case oob_event::timeout:
+              break;
           }
         }
     );
@@ -1247,7 +1270,8 @@ BOOST_AUTO_TEST_CASE(no_service)
               rep_fail = true; err = e_; break;
             case oob_event::internal:
               rep_internal = true; err = e_; break;
-
+            case oob_event::timeout:
+              break;
           }
         }
     );
@@ -1300,6 +1324,9 @@ BOOST_AUTO_TEST_CASE(destination_unreachable)
               rep_disconn = true; break;
             case oob_event::failure:
               rep_fail = true; err = e_; break;
+            case oob_event::internal:
+            case oob_event::timeout:
+              break;
           }
         }
     );
@@ -1323,6 +1350,1381 @@ BOOST_AUTO_TEST_CASE(destination_unreachable)
 }
 #endif
 
+#if TEST13 == 1
+// this test writes the same payload twice to several connected streams
+BOOST_AUTO_TEST_CASE(broadcast)
+{
+  const int num_clients = 4;
+  std::vector<uint8_t> buffer;
+  buffer.resize(100000);
+
+  check_start_sockets();
+
+  std::mutex srv_lock;
+  std::vector<async::net::stream> srv_streams;
+  std::atomic<int> srv_written(0);
+  std::atomic<std::size_t> clt_size[num_clients];
+  std::atomic<int> clt_connected(0);
+
+  for (auto& s : clt_size)
+    s = 0;
+
+  auto r = std::make_shared<test_runner>();
+  auto r2 = std::make_shared<test_runner>();
+  {
+    auto server = async::net::server(
+        std::weak_ptr<test_runner>(r)
+      , ipv6::any
+      , 22230
+      , std::bind(stream_factory, _1, _2, _3, r2
+          , [] (const std::shared_ptr<test_runner>&, void*&, std::size_t&)
+            { }
+          , [&srv_written] (const std::shared_ptr<test_runner>&, const void*, std::size_t)
+            {
+              ++srv_written;
+            }
+          , [] (const std::shared_ptr<test_runner>&, oob_event, const std::error_code&)
+            { }
+        )
+      , [&srv_streams, &srv_lock](const std::shared_ptr<test_runner>&, const async::net::stream& s_)
+        {
+          std::unique_lock<std::mutex> l(srv_lock);
+          srv_streams.push_back(s_);
+        }
+    );
+
+    server.start();
+
+    std::vector<std::shared_ptr<async::net::stream>> clients;
+    for (int i = 0; i < num_clients; ++i)
+    {
+      std::atomic<std::size_t>* counter = &clt_size[i];
+      clients.push_back(std::make_shared<async::net::stream>(
+          std::weak_ptr<test_runner>(r2)
+        , ipv4::loopback
+        , 22230
+        , [counter] (const std::shared_ptr<test_runner>&, void*&, std::size_t& size)
+          {
+            *counter += size;
+          }
+        , [] (const std::shared_ptr<test_runner>&, const void*, std::size_t)
+          { }
+        , [&clt_connected] (const std::shared_ptr<test_runner>&, oob_event evt, const std::error_code&)
+          {
+            if (evt == oob_event::connect)
+              ++clt_connected;
+          }
+      ));
+    }
+
+    spin_wait(2000,
+      [&clt_connected, &srv_streams, &srv_lock, num_clients] ()
+      {
+        std::unique_lock<std::mutex> l(srv_lock);
+        return clt_connected == num_clients && srv_streams.size() == num_clients;
+      }
+    );
+    BOOST_REQUIRE_EQUAL(num_clients, clt_connected);
+    BOOST_REQUIRE_EQUAL(num_clients, srv_streams.size());
+
+    {
+      async::net::payload data(buffer.data(), buffer.size());
+      BOOST_CHECK_EQUAL(1, data.use_count());
+      BOOST_CHECK_EQUAL(num_clients, async::net::broadcast(data, srv_streams.begin(), srv_streams.end()));
+      BOOST_CHECK_EQUAL(num_clients, async::net::broadcast(data, srv_streams.begin(), srv_streams.end()));
+
+      // the streams that fail to accept the payload are skipped
+      std::vector<async::net::stream> empty(2);
+      BOOST_CHECK_EQUAL(0, async::net::broadcast(data, empty.begin(), empty.end()));
+
+      spin_wait(5000,
+        [&srv_written, &clt_size, &buffer, &data, num_clients] ()
+        {
+          if (srv_written < 2 * num_clients || data.use_count() != 1)
+            return false;
+          for (auto& s : clt_size)
+            if (s < 2 * buffer.size())
+              return false;
+          return true;
+        }
+      );
+      BOOST_CHECK_EQUAL(2 * num_clients, srv_written);
+      BOOST_CHECK_EQUAL(1, data.use_count());
+      for (auto& s : clt_size)
+        BOOST_CHECK_EQUAL(2 * buffer.size(), s);
+    }
+
+    BOOST_CHECK_THROW(srv_streams[0].write(async::net::payload()), cool::ng::exception::illegal_argument);
+    srv_streams.clear();
+    clients.clear();
+  }
+  spin_wait(100, [] () { return false; });
+}
+#endif
+
+#if TEST14 == 1 && !defined(WINDOWS_TARGET)
+void local_socket_echo(const cool::ng::net::local::address& addr_)
+{
+  const char msg[] = "local socket message";
+
+  std::atomic<bool> client_connected(false);
+  std::atomic<bool> srv_connected(false);
+  std::atomic<std::size_t> srv_size(0);
+  std::atomic<std::size_t> clt_size(0);
+  std::atomic<bool> srv_written(false);
+
+  async::net::stream srv_stream;
+  ip::host_container peer_addr;
+  uint16_t peer_port = 1;
+
+  auto r = std::make_shared<test_runner>();
+  auto r2 = std::make_shared<test_runner>();
+  {
+    auto server = async::net::server(
+        std::weak_ptr<test_runner>(r)
+      , addr_
+      , [&r2, &srv_size, &srv_written, &peer_addr, &peer_port] (const std::shared_ptr<test_runner>&, const ip::address& a_, uint16_t p_)
+        {
+          peer_addr = a_;
+          peer_port = p_;
+          return async::net::stream(
+              std::weak_ptr<test_runner>(r2)
+            , [&srv_size] (const std::shared_ptr<test_runner>&, void*&, std::size_t& size_)
+              {
+                srv_size += size_;
+              }
+            , [&srv_written] (const std::shared_ptr<test_runner>&, const void*, std::size_t)
+              {
+                srv_written = true;
+              }
+            , [] (const std::shared_ptr<test_runner>&, oob_event, const std::error_code&)
+              { }
+          );
+        }
+      , [&srv_stream, &srv_connected](const std::shared_ptr<test_runner>&, const async::net::stream& s_)
+        {
+          srv_stream = s_;
+          srv_connected = true;
+        }
+    );
+
+    server.start();
+
+    {
+      auto client = std::make_shared<async::net::stream>(
+          std::weak_ptr<test_runner>(r2)
+        , addr_
+        , [&clt_size] (const std::shared_ptr<test_runner>&, void*&, std::size_t& size)
+          {
+            clt_size += size;
+          }
+        , [] (const std::shared_ptr<test_runner>&, const void*, std::size_t)
+          { }
+        , [&client_connected] (const std::shared_ptr<test_runner>&, oob_event evt, const std::error_code&)
+          {
+            if (evt == oob_event::connect)
+              client_connected = true;
+          }
+      );
+
+      spin_wait(2000, [&client_connected, &srv_connected]() { return client_connected && srv_connected; } );
+      BOOST_REQUIRE_EQUAL(true, srv_connected);
+      BOOST_REQUIRE_EQUAL(true, client_connected);
+      BOOST_CHECK_EQUAL(0, peer_port);
+      BOOST_CHECK(static_cast<const ip::address&>(peer_addr) == ipv4::any);
+
+      client->write(msg, sizeof(msg));
+      srv_stream.write(msg, sizeof(msg));
+      spin_wait(2000,
+        [&clt_size, &srv_size, &srv_written, &msg] ()
+        {
+          return srv_written && clt_size >= sizeof(msg) && srv_size >= sizeof(msg);
+        }
+      );
+      BOOST_CHECK_EQUAL(sizeof(msg), srv_size);
+      BOOST_CHECK_EQUAL(sizeof(msg), clt_size);
+      BOOST_CHECK_EQUAL(true, srv_written);
+    }
+    srv_stream = async::net::stream();
+  }
+  spin_wait(100, [] () { return false; });
+}
+
+BOOST_AUTO_TEST_CASE(local_socket)
+{
+  const char* path = "/tmp/cool_ng_es_reader.sock";
+  ::unlink(path);
+
+  local_socket_echo(cool::ng::net::local::address(path));
+  // server must remove the socket file upon destruction
+  spin_wait(1000, [path] () { return ::access(path, F_OK) != 0; });
+  BOOST_CHECK_NE(0, ::access(path, F_OK));
+
+#if defined(LINUX_TARGET)
+  local_socket_echo(cool::ng::net::local::address("cool_ng_es_reader", cool::ng::net::local::style::abstract));
+#endif
+
+  auto r = std::make_shared<test_runner>();
+  BOOST_CHECK_THROW(
+      async::net::stream(
+          std::weak_ptr<test_runner>(r)
+        , cool::ng::net::local::address()
+        , [] (const std::shared_ptr<test_runner>&, void*&, std::size_t&) { }
+        , [] (const std::shared_ptr<test_runner>&, const void*, std::size_t) { }
+        , [] (const std::shared_ptr<test_runner>&, oob_event, const std::error_code&) { })
+    , cool::ng::exception::illegal_argument);
+  BOOST_CHECK_THROW(
+      async::net::stream(
+          std::weak_ptr<test_runner>(r)
+        , cool::ng::net::local::address(std::string(200, 'x'))
+        , [] (const std::shared_ptr<test_runner>&, void*&, std::size_t&) { }
+        , [] (const std::shared_ptr<test_runner>&, const void*, std::size_t) { }
+        , [] (const std::shared_ptr<test_runner>&, oob_event, const std::error_code&) { })
+    , cool::ng::exception::illegal_argument);
+}
+#endif
+
+#if TEST15 == 1
+// this test checks reuse, pre-connecting and eviction of the pooled streams
+BOOST_AUTO_TEST_CASE(pool)
+{
+  check_start_sockets();
+
+  std::mutex srv_lock;
+  std::vector<async::net::stream> srv_streams;
+  std::atomic<int> accepted(0);
+
+  auto r = std::make_shared<test_runner>();
+  auto r2 = std::make_shared<test_runner>();
+  {
+    auto server = async::net::server(
+        std::weak_ptr<test_runner>(r)
+      , ipv6::any
+      , 22231
+      , std::bind(stream_factory, _1, _2, _3, r2
+          , [] (const std::shared_ptr<test_runner>&, void*&, std::size_t&)
+            { }
+          , [] (const std::shared_ptr<test_runner>&, const void*, std::size_t)
+            { }
+          , [] (const std::shared_ptr<test_runner>&, oob_event, const std::error_code&)
+            { }
+        )
+      , [&srv_streams, &srv_lock, &accepted](const std::shared_ptr<test_runner>&, const async::net::stream& s_)
+        {
+          std::unique_lock<std::mutex> l(srv_lock);
+          srv_streams.push_back(s_);
+          ++accepted;
+        }
+    );
+    server.start();
+
+    async::net::pool<test_runner>::options opts;
+    opts.max_idle = 2;
+    opts.idle_timeout = ms(200);
+    async::net::pool<test_runner> pool(r2, opts);
+
+    std::mutex lock;
+    async::net::stream acquired;
+    std::error_code status;
+    std::atomic<bool> ready(false);
+
+    auto do_acquire = [&] (uint16_t port_)
+    {
+      ready = false;
+      pool.acquire(
+          ipv4::loopback
+        , port_
+        , [] (const std::shared_ptr<test_runner>&, void*&, std::size_t&) { }
+        , [] (const std::shared_ptr<test_runner>&, const void*, std::size_t) { }
+        , [] (const std::shared_ptr<test_runner>&, oob_event, const std::error_code&) { }
+        , [&] (const std::shared_ptr<test_runner>&, const async::net::stream& s_, const std::error_code& ec_)
+          {
+            std::unique_lock<std::mutex> l(lock);
+            acquired = s_;
+            status = ec_;
+            ready = true;
+          }
+      );
+      spin_wait(2000, [&ready] () { return ready.load(); });
+      BOOST_REQUIRE(ready);
+    };
+
+    // first acquire connects new stream
+    do_acquire(22231);
+    BOOST_REQUIRE(!status);
+    BOOST_REQUIRE(acquired);
+    spin_wait(1000, [&accepted] () { return accepted == 1; });
+    BOOST_CHECK_EQUAL(1, accepted);
+    auto name = acquired.name();
+
+    pool.release(acquired);
+    BOOST_CHECK_EQUAL(1, pool.idle(ipv4::loopback, 22231));
+
+    // second acquire reuses the idle stream
+    do_acquire(22231);
+    BOOST_REQUIRE(!status);
+    BOOST_CHECK_EQUAL(name, acquired.name());
+    BOOST_CHECK_EQUAL(0, pool.idle(ipv4::loopback, 22231));
+    pool.release(acquired);
+    pool.release(acquired);   // second release has no effect
+    BOOST_CHECK_EQUAL(1, pool.idle(ipv4::loopback, 22231));
+    BOOST_CHECK_EQUAL(1, accepted);
+
+    // reserve pre-connects to reach the minimum and keeps it past idle timeout
+    pool.reserve(ipv4::loopback, 22231, 2);
+    spin_wait(2000, [&pool] () { return pool.idle(ipv4::loopback, 22231) == 2; });
+    BOOST_CHECK_EQUAL(2, pool.idle(ipv4::loopback, 22231));
+    BOOST_CHECK_EQUAL(2, accepted);
+    spin_wait(500, [] () { return false; });
+    BOOST_CHECK_EQUAL(2, pool.idle(ipv4::loopback, 22231));
+
+    // without reservation the idle streams time out
+    pool.reserve(ipv4::loopback, 22231, 0);
+    spin_wait(2000, [&pool] () { return pool.idle(ipv4::loopback, 22231) == 0; });
+    BOOST_CHECK_EQUAL(0, pool.idle(ipv4::loopback, 22231));
+
+    // idle stream closed by the peer is evicted
+    do_acquire(22231);
+    BOOST_REQUIRE(!status);
+    pool.release(acquired);
+    BOOST_CHECK_EQUAL(1, pool.idle(ipv4::loopback, 22231));
+    {
+      std::unique_lock<std::mutex> l(srv_lock);
+      for (auto& s : srv_streams)
+        s.disconnect();
+      srv_streams.clear();
+    }
+    spin_wait(2000, [&pool] () { return pool.idle(ipv4::loopback, 22231) == 0; });
+    BOOST_CHECK_EQUAL(0, pool.idle(ipv4::loopback, 22231));
+
+    // failure to connect is reported through ready handler
+    do_acquire(22232);
+    BOOST_CHECK(status);
+    BOOST_CHECK(!acquired);
+    BOOST_CHECK_EQUAL(0, pool.idle(ipv4::loopback, 22232));
+
+    acquired = async::net::stream();
+  }
+  spin_wait(100, [] () { return false; });
+}
+#endif
+
+#if TEST16 == 1
+// this test sets socket options on server, unconnected and connected streams
+BOOST_AUTO_TEST_CASE(socket_options)
+{
+  check_start_sockets();
+
+  {
+    auto opts = async::net::socket_options().no_delay(true).send_buffer(65536);
+    BOOST_CHECK(!async::net::socket_options().is_set(async::net::socket_options::option::no_delay));
+    BOOST_CHECK(async::net::socket_options().empty());
+    opts.merge(async::net::socket_options().no_delay(false).cork(true));
+    BOOST_CHECK(opts.is_set(async::net::socket_options::option::no_delay));
+    BOOST_CHECK(opts.is_set(async::net::socket_options::option::send_buffer));
+    BOOST_CHECK(opts.is_set(async::net::socket_options::option::cork));
+    BOOST_CHECK(!opts.is_set(async::net::socket_options::option::keep_alive));
+    BOOST_CHECK_EQUAL(false, opts.no_delay());
+    BOOST_CHECK_EQUAL(65536, opts.send_buffer());
+    BOOST_CHECK_EQUAL(true, opts.cork());
+
+    BOOST_CHECK_THROW(async::net::stream().options(opts), cool::ng::exception::empty_object);
+    BOOST_CHECK_THROW(async::net::server().options(opts), cool::ng::exception::empty_object);
+  }
+
+  std::mutex srv_lock;
+  std::vector<async::net::stream> srv_streams;
+  std::atomic<std::size_t> received(0);
+  std::atomic<bool> connected(false);
+
+  auto r = std::make_shared<test_runner>();
+  auto r2 = std::make_shared<test_runner>();
+  {
+    auto server = async::net::server(
+        std::weak_ptr<test_runner>(r)
+      , ipv6::any
+      , 22233
+      , std::bind(stream_factory, _1, _2, _3, r2
+          , [&received] (const std::shared_ptr<test_runner>&, void*&, std::size_t& size)
+            {
+              received += size;
+            }
+          , [] (const std::shared_ptr<test_runner>&, const void*, std::size_t)
+            { }
+          , [] (const std::shared_ptr<test_runner>&, oob_event, const std::error_code&)
+            { }
+        )
+      , [&srv_streams, &srv_lock](const std::shared_ptr<test_runner>&, const async::net::stream& s_)
+        {
+          std::unique_lock<std::mutex> l(srv_lock);
+          srv_streams.push_back(s_);
+        }
+    );
+    BOOST_REQUIRE_NO_THROW(server.options(
+        async::net::socket_options()
+          .no_delay(true)
+          .receive_buffer(128 * 1024)
+          .keep_alive(true, std::chrono::seconds(30), std::chrono::seconds(5), 3)));
+    server.start();
+
+    async::net::stream client(
+        std::weak_ptr<test_runner>(r2)
+      , [] (const std::shared_ptr<test_runner>&, void*&, std::size_t&)
+        { }
+      , [] (const std::shared_ptr<test_runner>&, const void*, std::size_t)
+        { }
+      , [&connected] (const std::shared_ptr<test_runner>&, oob_event evt, const std::error_code&)
+        {
+          if (evt == oob_event::connect)
+            connected = true;
+        }
+    );
+
+    // options set before connect are applied at connect
+    BOOST_REQUIRE_NO_THROW(client.options(async::net::socket_options().no_delay(true).send_buffer(256 * 1024)));
+    client.connect(ipv4::loopback, 22233);
+    spin_wait(2000,
+      [&connected, &srv_streams, &srv_lock] ()
+      {
+        std::unique_lock<std::mutex> l(srv_lock);
+        return connected && srv_streams.size() == 1;
+      }
+    );
+    BOOST_REQUIRE(connected);
+
+    const char data[] = "hello world";
+    client.write(data, sizeof(data));
+    spin_wait(2000, [&received, &data] () { return received == sizeof(data); });
+    BOOST_CHECK_EQUAL(sizeof(data), received);
+
+    // options can be adjusted on the live stream; uncorking flushes the data
+#if defined(WINDOWS_TARGET)
+    BOOST_CHECK_THROW(client.options(async::net::socket_options().cork(true)), cool::ng::exception::operation_failed);
+#else
+    BOOST_REQUIRE_NO_THROW(client.options(async::net::socket_options().cork(true)));
+    spin_wait(50, [] () { return false; });
+    BOOST_REQUIRE_NO_THROW(client.options(async::net::socket_options().cork(false)));
+#endif
+    client.write(data, sizeof(data));
+    spin_wait(2000, [&received, &data] () { return received == 2 * sizeof(data); });
+    BOOST_CHECK_EQUAL(2 * sizeof(data), received);
+
+#if defined(LINUX_TARGET)
+    BOOST_CHECK_NO_THROW(client.options(async::net::socket_options().quick_ack(true)));
+#else
+    BOOST_CHECK_THROW(client.options(async::net::socket_options().quick_ack(true)), cool::ng::exception::operation_failed);
+#endif
+
+    client.disconnect();
+    srv_streams.clear();
+  }
+  spin_wait(100, [] () { return false; });
+}
+#endif
+
+#if TEST17 == 1 && defined(LINUX_TARGET)
+std::size_t count_open_descriptors()
+{
+  std::size_t count = 0;
+  auto dir = ::opendir("/proc/self/fd");
+  if (dir == nullptr)
+    return 0;
+  while (::readdir(dir) != nullptr)
+    ++count;
+  ::closedir(dir);
+  return count;
+}
+
+// this test checks that each connected stream uses one socket descriptor for
+// both reading and writing
+BOOST_AUTO_TEST_CASE(single_descriptor)
+{
+  const int num_clients = 8;
+
+  std::mutex srv_lock;
+  std::vector<async::net::stream> srv_streams;
+  std::atomic<int> clt_connected(0);
+  std::atomic<std::size_t> received(0);
+
+  auto r = std::make_shared<test_runner>();
+  auto r2 = std::make_shared<test_runner>();
+  {
+    auto server = async::net::server(
+        std::weak_ptr<test_runner>(r)
+      , ipv4::any
+      , 22234
+      , std::bind(stream_factory, _1, _2, _3, r2
+          , [&received] (const std::shared_ptr<test_runner>&, void*&, std::size_t& size)
+            {
+              received += size;
+            }
+          , [] (const std::shared_ptr<test_runner>&, const void*, std::size_t)
+            { }
+          , [] (const std::shared_ptr<test_runner>&, oob_event, const std::error_code&)
+            { }
+        )
+      , [&srv_streams, &srv_lock](const std::shared_ptr<test_runner>&, const async::net::stream& s_)
+        {
+          std::unique_lock<std::mutex> l(srv_lock);
+          srv_streams.push_back(s_);
+        }
+    );
+    server.start();
+
+    auto before = count_open_descriptors();
+    {
+      std::vector<async::net::stream> clients;
+      for (int i = 0; i < num_clients; ++i)
+      {
+        clients.push_back(async::net::stream(
+            std::weak_ptr<test_runner>(r2)
+          , ipv4::loopback
+          , 22234
+          , [] (const std::shared_ptr<test_runner>&, void*&, std::size_t&)
+            { }
+          , [] (const std::shared_ptr<test_runner>&, const void*, std::size_t)
+            { }
+          , [&clt_connected] (const std::shared_ptr<test_runner>&, oob_event evt, const std::error_code&)
+            {
+              if (evt == oob_event::connect)
+                ++clt_connected;
+            }
+        ));
+      }
+
+      spin_wait(2000,
+        [&clt_connected, &srv_streams, &srv_lock, num_clients] ()
+        {
+          std::unique_lock<std::mutex> l(srv_lock);
+          return clt_connected == num_clients && srv_streams.size() == num_clients;
+        }
+      );
+      BOOST_REQUIRE_EQUAL(num_clients, clt_connected);
+
+      // client and server end of each connection
+      BOOST_CHECK_EQUAL(before + 2 * num_clients, count_open_descriptors());
+
+      // the single descriptor serves both directions
+      const char data[] = "ping";
+      for (auto& c : clients)
+        c.write(data, sizeof(data));
+      spin_wait(2000, [&received, &data, num_clients] () { return received == num_clients * sizeof(data); });
+      BOOST_CHECK_EQUAL(num_clients * sizeof(data), received);
+
+      for (auto& c : clients)
+        c.disconnect();
+      {
+        std::unique_lock<std::mutex> l(srv_lock);
+        srv_streams.clear();
+      }
+    }
+
+    // descriptors are closed once both event sources are cancelled
+    spin_wait(2000, [before] () { return count_open_descriptors() == before; });
+    BOOST_CHECK_EQUAL(before, count_open_descriptors());
+  }
+  spin_wait(100, [] () { return false; });
+}
+#endif
+
+#if TEST18 == 1 && !defined(WINDOWS_TARGET)
+// this test uses the listen socket with the smallest backlog which is never
+// accepted; the first connection is queued and remains silent, and once the
+// backlog is filled the connection attempts are no longer answered
+BOOST_AUTO_TEST_CASE(stream_timeouts)
+{
+  auto listener = ::socket(AF_INET, SOCK_STREAM, 0);
+  BOOST_REQUIRE(listener >= 0);
+  {
+    int option = 1;
+    ::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &option, sizeof(option));
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(22235);
+    BOOST_REQUIRE_EQUAL(0, ::bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)));
+    BOOST_REQUIRE_EQUAL(0, ::listen(listener, 0));
+  }
+
+  std::atomic<bool> connected(false);
+  std::atomic<int> read_idle(0);
+  std::atomic<int> write_stalled(0);
+  std::atomic<bool> failed(false);
+  std::atomic<int> fail_code(0);
+
+  auto r = std::make_shared<test_runner>();
+  {
+    async::net::stream silent(
+        std::weak_ptr<test_runner>(r)
+      , [] (const std::shared_ptr<test_runner>&, void*&, std::size_t&)
+        { }
+      , [] (const std::shared_ptr<test_runner>&, const void*, std::size_t)
+        { }
+      , [&connected, &read_idle, &write_stalled] (const std::shared_ptr<test_runner>&, oob_event evt, const std::error_code& e)
+        {
+          if (evt == oob_event::connect)
+            connected = true;
+          else if (evt == oob_event::timeout && e.value() == static_cast<int>(errc::read_idle))
+            ++read_idle;
+          else if (evt == oob_event::timeout && e.value() == static_cast<int>(errc::write_stalled))
+            ++write_stalled;
+        }
+    );
+    silent.set_timeouts(async::net::timeouts(ms(0), ms(100), ms(100)));
+    silent.connect(ipv4::loopback, 22235);
+    spin_wait(1000, [&connected] () { return connected.load(); });
+    BOOST_REQUIRE(connected);
+
+    // the read idle timeout is reported once per idle period
+    spin_wait(1000, [&read_idle] () { return read_idle > 0; });
+    BOOST_CHECK_EQUAL(1, read_idle);
+    spin_wait(300, [] () { return false; });
+    BOOST_CHECK_EQUAL(1, read_idle);
+    BOOST_CHECK_EQUAL(0, write_stalled);
+
+    // the peer never reads, the write stalls once the socket buffers are full
+    std::vector<uint8_t> data(32 * 1024 * 1024);
+    silent.write(data.data(), data.size());
+    spin_wait(3000, [&write_stalled] () { return write_stalled > 0; });
+    BOOST_CHECK_EQUAL(1, write_stalled);
+
+    // fill the rest of the backlog; the kernel may still occasionally answer
+    // the connection attempt, hence a few attempts are made
+    std::vector<int> fillers;
+    auto fill = [&fillers] ()
+    {
+      for (int i = 0; i < 8; ++i)
+      {
+        auto fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        BOOST_REQUIRE(fd >= 0);
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fillers.push_back(fd);
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(22235);
+        ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+      }
+    };
+
+    for (int attempt = 0; attempt < 5 && !failed; ++attempt)
+    {
+      fill();
+      std::atomic<bool> answered(false);
+      async::net::stream unanswered(
+          std::weak_ptr<test_runner>(r)
+        , [] (const std::shared_ptr<test_runner>&, void*&, std::size_t&)
+          { }
+        , [] (const std::shared_ptr<test_runner>&, const void*, std::size_t)
+          { }
+        , [&failed, &fail_code, &answered] (const std::shared_ptr<test_runner>&, oob_event evt, const std::error_code& e)
+          {
+            if (evt == oob_event::connect)
+              answered = true;
+            else if (evt == oob_event::failure)
+            {
+              fail_code = e.value();
+              failed = true;
+            }
+          }
+      );
+      unanswered.set_timeouts(async::net::timeouts(ms(200), ms(0), ms(0)));
+      auto start = std::chrono::steady_clock::now();
+      unanswered.connect(ipv4::loopback, 22235);
+      spin_wait(2000, [&failed, &answered] () { return failed || answered; });
+      auto elapsed = std::chrono::duration_cast<ms>(std::chrono::steady_clock::now() - start);
+
+      if (answered)
+      {
+        unanswered.disconnect();
+        spin_wait(50, [] () { return false; });
+        continue;
+      }
+
+      BOOST_REQUIRE(failed);
+      BOOST_CHECK_EQUAL(static_cast<int>(errc::timed_out), fail_code);
+      BOOST_CHECK(elapsed >= ms(190));
+      BOOST_CHECK(elapsed < ms(1000));
+    }
+    BOOST_CHECK(failed);
+
+    silent.disconnect();
+    spin_wait(100, [] () { return false; });
+    for (auto fd : fillers)
+      ::close(fd);
+  }
+  ::close(listener);
+}
+#endif
+
+#if TEST19 == 1 && !defined(WINDOWS_TARGET)
+// the connections above the limit remain in the listen backlog and are
+// accepted as the slots are released
+BOOST_AUTO_TEST_CASE(connection_limit)
+{
+  const std::size_t num_clients = 4;
+
+  std::mutex srv_lock;
+  std::vector<async::net::stream> srv_streams;
+  auto accepted = [&srv_lock, &srv_streams] ()
+  {
+    std::unique_lock<std::mutex> l(srv_lock);
+    return srv_streams.size();
+  };
+
+  auto r = std::make_shared<test_runner>();
+  auto r2 = std::make_shared<test_runner>();
+  {
+    auto server = async::net::server(
+        std::weak_ptr<test_runner>(r)
+      , ipv4::any
+      , 22236
+      , std::bind(stream_factory, _1, _2, _3, r2
+          , [] (const std::shared_ptr<test_runner>&, void*&, std::size_t&)
+            { }
+          , [] (const std::shared_ptr<test_runner>&, const void*, std::size_t)
+            { }
+          , [] (const std::shared_ptr<test_runner>&, oob_event, const std::error_code&)
+            { }
+        )
+      , [&srv_streams, &srv_lock](const std::shared_ptr<test_runner>&, const async::net::stream& s_)
+        {
+          std::unique_lock<std::mutex> l(srv_lock);
+          srv_streams.push_back(s_);
+        }
+    );
+    server.max_connections(2);
+    server.start();
+
+    std::vector<async::net::stream> clients;
+    for (std::size_t i = 0; i < num_clients; ++i)
+    {
+      clients.push_back(async::net::stream(
+          std::weak_ptr<test_runner>(r2)
+        , ipv4::loopback
+        , 22236
+        , [] (const std::shared_ptr<test_runner>&, void*&, std::size_t&)
+          { }
+        , [] (const std::shared_ptr<test_runner>&, const void*, std::size_t)
+          { }
+        , [] (const std::shared_ptr<test_runner>&, oob_event, const std::error_code&)
+          { }
+      ));
+    }
+
+    spin_wait(500, [&accepted] () { return accepted() == 2; });
+    spin_wait(200, [] () { return false; });
+    BOOST_CHECK_EQUAL(2, accepted());
+    BOOST_CHECK_EQUAL(2, server.connections());
+
+    // closing an accepted connection releases its slot
+    {
+      std::unique_lock<std::mutex> l(srv_lock);
+      srv_streams.front().disconnect();
+    }
+    spin_wait(1000, [&accepted] () { return accepted() == 3; });
+    spin_wait(200, [] () { return false; });
+    BOOST_CHECK_EQUAL(3, accepted());
+    BOOST_CHECK_EQUAL(2, server.connections());
+
+    // lifting the limit resumes accepting
+    server.max_connections(0);
+    spin_wait(1000, [&accepted, num_clients] () { return accepted() == num_clients; });
+    BOOST_CHECK_EQUAL(num_clients, accepted());
+    BOOST_CHECK_EQUAL(3, server.connections());
+
+    for (auto& c : clients)
+      c.disconnect();
+    spin_wait(1000, [&server] () { return server.connections() == 0; });
+    BOOST_CHECK_EQUAL(0, server.connections());
+    {
+      std::unique_lock<std::mutex> l(srv_lock);
+      srv_streams.clear();
+    }
+  }
+  spin_wait(100, [] () { return false; });
+}
+#endif
+
+#if TEST20 == 1 && !defined(WINDOWS_TARGET)
+int raw_connect(uint16_t port_)
+{
+  auto fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port_);
+  if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+  {
+    ::close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// the connections without pending writes are closed at once, the connection
+// of the client that does not read is closed when its write completes or
+// when the grace period elapses
+BOOST_AUTO_TEST_CASE(server_drain)
+{
+  std::mutex srv_lock;
+  std::vector<async::net::stream> srv_streams;
+  std::atomic<int> srv_disconnected(0);
+  std::atomic<int> clt_disconnected(0);
+  std::atomic<int> drained(0);
+  auto accepted = [&srv_lock, &srv_streams] ()
+  {
+    std::unique_lock<std::mutex> l(srv_lock);
+    return srv_streams.size();
+  };
+
+  std::vector<uint8_t> data(32 * 1024 * 1024);
+
+  auto r = std::make_shared<test_runner>();
+  auto r2 = std::make_shared<test_runner>();
+  {
+    auto server = async::net::server(
+        std::weak_ptr<test_runner>(r)
+      , ipv4::any
+      , 22237
+      , std::bind(stream_factory, _1, _2, _3, r2
+          , [] (const std::shared_ptr<test_runner>&, void*&, std::size_t&)
+            { }
+          , [] (const std::shared_ptr<test_runner>&, const void*, std::size_t)
+            { }
+          , [&srv_disconnected] (const std::shared_ptr<test_runner>&, oob_event evt, const std::error_code&)
+            {
+              if (evt == oob_event::disconnect)
+                ++srv_disconnected;
+            }
+        )
+      , [&srv_streams, &srv_lock](const std::shared_ptr<test_runner>&, const async::net::stream& s_)
+        {
+          std::unique_lock<std::mutex> l(srv_lock);
+          srv_streams.push_back(s_);
+        }
+    );
+    server.start();
+
+    std::vector<async::net::stream> clients;
+    for (int i = 0; i < 2; ++i)
+    {
+      clients.push_back(async::net::stream(
+          std::weak_ptr<test_runner>(r2)
+        , ipv4::loopback
+        , 22237
+        , [] (const std::shared_ptr<test_runner>&, void*&, std::size_t&)
+          { }
+        , [] (const std::shared_ptr<test_runner>&, const void*, std::size_t)
+          { }
+        , [&clt_disconnected] (const std::shared_ptr<test_runner>&, oob_event evt, const std::error_code&)
+          {
+            if (evt == oob_event::disconnect)
+              ++clt_disconnected;
+          }
+      ));
+      spin_wait(500, [&accepted, i] () { return accepted() == static_cast<std::size_t>(i + 1); });
+    }
+
+    auto raw = raw_connect(22237);
+    BOOST_REQUIRE(raw >= 0);
+    spin_wait(500, [&accepted] () { return accepted() == 3; });
+    BOOST_REQUIRE_EQUAL(3, accepted());
+    {
+      std::unique_lock<std::mutex> l(srv_lock);
+      srv_streams.back().write(data.data(), data.size());
+    }
+
+    server.drain([&drained] () { ++drained; });
+    spin_wait(1000, [&srv_disconnected, &clt_disconnected] () { return srv_disconnected == 2 && clt_disconnected == 2; });
+    spin_wait(100, [] () { return false; });
+    BOOST_CHECK_EQUAL(2, srv_disconnected);
+    BOOST_CHECK_EQUAL(2, clt_disconnected);
+    BOOST_CHECK_EQUAL(1, server.connections());
+    BOOST_CHECK_EQUAL(0, drained);
+    BOOST_CHECK_THROW(server.drain([] () { }), cool::ng::exception::invalid_state);
+
+    // reading the pending data lets the write complete
+    {
+      std::vector<uint8_t> buf(64 * 1024);
+      std::size_t total = 0;
+      while (total < data.size())
+      {
+        auto res = ::read(raw, buf.data(), buf.size());
+        if (res <= 0)
+          break;
+        total += res;
+      }
+      BOOST_CHECK_EQUAL(data.size(), total);
+    }
+    spin_wait(1000, [&drained] () { return drained == 1; });
+    BOOST_CHECK_EQUAL(1, drained);
+    BOOST_CHECK_EQUAL(3, srv_disconnected);
+    BOOST_CHECK_EQUAL(0, server.connections());
+    ::close(raw);
+
+    // the drained server may be started again; this time the client never
+    // reads and the connection is closed when the grace period elapses
+    {
+      std::unique_lock<std::mutex> l(srv_lock);
+      srv_streams.clear();
+    }
+    server.start();
+    raw = raw_connect(22237);
+    BOOST_REQUIRE(raw >= 0);
+    spin_wait(500, [&accepted] () { return accepted() == 1; });
+    BOOST_REQUIRE_EQUAL(1, accepted());
+    {
+      std::unique_lock<std::mutex> l(srv_lock);
+      srv_streams.back().write(data.data(), data.size());
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    server.drain([&drained] () { ++drained; }, ms(200));
+    spin_wait(2000, [&drained] () { return drained == 2; });
+    auto elapsed = std::chrono::duration_cast<ms>(std::chrono::steady_clock::now() - start);
+    BOOST_CHECK_EQUAL(2, drained);
+    BOOST_CHECK(elapsed >= ms(190));
+    BOOST_CHECK_EQUAL(4, srv_disconnected);
+    BOOST_CHECK_EQUAL(0, server.connections());
+    ::close(raw);
+
+    {
+      std::unique_lock<std::mutex> l(srv_lock);
+      srv_streams.clear();
+    }
+  }
+  spin_wait(100, [] () { return false; });
+}
+#endif
+
+#if TEST21 == 1
+BOOST_AUTO_TEST_CASE(runner_assignment)
+{
+  std::mutex lock;
+  std::vector<test_runner*> assigned;
+  std::vector<async::net::stream> srv_streams;
+  auto count = [&lock, &assigned] ()
+  {
+    std::unique_lock<std::mutex> l(lock);
+    return assigned.size();
+  };
+
+  auto r = std::make_shared<test_runner>();
+  std::vector<std::shared_ptr<test_runner>> pool;
+  std::vector<std::weak_ptr<test_runner>> weak_pool;
+  for (int i = 0; i < 3; ++i)
+  {
+    pool.push_back(std::make_shared<test_runner>());
+    weak_pool.push_back(pool.back());
+  }
+
+  std::vector<int> raws;
+  auto connect = [&raws, &count] ()
+  {
+    auto n = count();
+    auto raw = raw_connect(22238);
+    BOOST_REQUIRE(raw >= 0);
+    raws.push_back(raw);
+    spin_wait(500, [&count, n] () { return count() == n + 1; });
+    BOOST_REQUIRE_EQUAL(n + 1, count());
+  };
+
+  {
+    auto server = async::net::server(
+        std::weak_ptr<test_runner>(r)
+      , ipv4::any
+      , 22238
+      , [&lock, &assigned] (const std::shared_ptr<test_runner>& r_, const ip::address&, uint16_t)
+        {
+          {
+            std::unique_lock<std::mutex> l(lock);
+            assigned.push_back(r_.get());
+          }
+          return async::net::stream(
+              std::weak_ptr<test_runner>(r_)
+            , [] (const std::shared_ptr<test_runner>&, void*&, std::size_t&) { }
+            , [] (const std::shared_ptr<test_runner>&, const void*, std::size_t) { }
+            , [] (const std::shared_ptr<test_runner>&, oob_event, const std::error_code&) { }
+            , nullptr
+            , 1000);
+        }
+      , [&lock, &srv_streams] (const std::shared_ptr<test_runner>&, const async::net::stream& s_)
+        {
+          std::unique_lock<std::mutex> l(lock);
+          srv_streams.push_back(s_);
+        }
+    );
+
+    // the pool must use the server's runner type
+    BOOST_CHECK_THROW(
+        server.runners(std::vector<std::weak_ptr<async::runner>>())
+      , cool::ng::exception::illegal_argument);
+
+    // without the pool all connections use the server's runner
+    server.start();
+    connect();
+    BOOST_CHECK_EQUAL(r.get(), assigned[0]);
+
+    // round robin
+    server.runners(weak_pool);
+    for (int i = 0; i < 6; ++i)
+      connect();
+    for (int i = 0; i < 6; ++i)
+      BOOST_CHECK_EQUAL(pool[i % 3].get(), assigned[i + 1]);
+
+    // least loaded; the first two runners are blocked, each with one more
+    // task waiting in its queue
+    {
+      std::atomic<bool> release(false);
+      for (int i = 0; i < 2; ++i)
+      {
+        cool::ng::async::factory::create(
+            pool[i]
+          , [&release] (const std::shared_ptr<test_runner>&)
+            {
+              spin_wait(2000, [&release] () { return release.load(); });
+            }
+        ).run();
+        cool::ng::async::factory::create(
+            pool[i]
+          , [] (const std::shared_ptr<test_runner>&) { }
+        ).run();
+      }
+      spin_wait(500, [&pool] () { return pool[0]->queue_depth() == 1 && pool[1]->queue_depth() == 1; });
+      BOOST_CHECK_EQUAL(1, pool[0]->queue_depth());
+      BOOST_CHECK_EQUAL(1, pool[1]->queue_depth());
+      BOOST_CHECK_EQUAL(0, pool[2]->queue_depth());
+
+      server.runners(weak_pool, async::net::assignment::least_loaded);
+      connect();
+      connect();
+      BOOST_CHECK_EQUAL(pool[2].get(), assigned[7]);
+      BOOST_CHECK_EQUAL(pool[2].get(), assigned[8]);
+
+      release = true;
+      spin_wait(500, [&pool] () { return pool[0]->queue_depth() == 0 && pool[1]->queue_depth() == 0; });
+      BOOST_CHECK_EQUAL(0, pool[0]->queue_depth());
+      BOOST_CHECK_EQUAL(0, pool[1]->queue_depth());
+    }
+
+    // all connections from the same peer are assigned the same runner
+    server.runners(weak_pool, async::net::assignment::peer_hash);
+    for (int i = 0; i < 3; ++i)
+      connect();
+    BOOST_CHECK_EQUAL(assigned[9], assigned[10]);
+    BOOST_CHECK_EQUAL(assigned[9], assigned[11]);
+
+    // the expired runners are skipped
+    server.runners(weak_pool);
+    pool[0].reset();
+    for (int i = 0; i < 2; ++i)
+      connect();
+    BOOST_CHECK_EQUAL(pool[1].get(), assigned[12]);
+    BOOST_CHECK_EQUAL(pool[2].get(), assigned[13]);
+
+    for (auto fd : raws)
+      ::close(fd);
+    server.stop();
+    {
+      std::unique_lock<std::mutex> l(lock);
+      srv_streams.clear();
+    }
+  }
+  spin_wait(100, [] () { return false; });
+}
+#endif
+
+#if TEST22 == 1
+// many small payloads queued at once are delivered completely and in order,
+// and each is reported written exactly once
+BOOST_AUTO_TEST_CASE(write_batching)
+{
+  const int num_payloads = 500;
+
+  std::mutex lock;
+  std::vector<uint8_t> expected;
+  std::vector<uint8_t> received;
+  std::vector<async::net::stream> srv_streams;
+  std::atomic<int> srv_written(0);
+  std::atomic<bool> clt_connected(false);
+
+  std::vector<async::net::payload> payloads;
+  for (int i = 0; i < num_payloads; ++i)
+  {
+    std::vector<uint8_t> data(1 + i % 50, static_cast<uint8_t>(i));
+    expected.insert(expected.end(), data.begin(), data.end());
+    payloads.push_back(async::net::payload(data.data(), data.size()));
+  }
+
+  auto r = std::make_shared<test_runner>();
+  auto r2 = std::make_shared<test_runner>();
+  {
+    auto server = async::net::server(
+        std::weak_ptr<test_runner>(r)
+      , ipv4::any
+      , 22239
+      , std::bind(stream_factory, _1, _2, _3, r
+          , [] (const std::shared_ptr<test_runner>&, void*&, std::size_t&)
+            { }
+          , [&srv_written] (const std::shared_ptr<test_runner>&, const void*, std::size_t)
+            {
+              ++srv_written;
+            }
+          , [] (const std::shared_ptr<test_runner>&, oob_event, const std::error_code&)
+            { }
+        )
+      , [&srv_streams, &lock](const std::shared_ptr<test_runner>&, const async::net::stream& s_)
+        {
+          std::unique_lock<std::mutex> l(lock);
+          srv_streams.push_back(s_);
+        }
+    );
+    server.start();
+
+    async::net::stream client(
+        std::weak_ptr<test_runner>(r2)
+      , ipv4::loopback
+      , 22239
+      , [&lock, &received] (const std::shared_ptr<test_runner>&, void*& buf_, std::size_t& size_)
+        {
+          std::unique_lock<std::mutex> l(lock);
+          auto p = static_cast<const uint8_t*>(buf_);
+          received.insert(received.end(), p, p + size_);
+        }
+      , [] (const std::shared_ptr<test_runner>&, const void*, std::size_t)
+        { }
+      , [&clt_connected] (const std::shared_ptr<test_runner>&, oob_event evt, const std::error_code&)
+        {
+          if (evt == oob_event::connect)
+            clt_connected = true;
+        }
+    );
+
+    spin_wait(2000, [&] () { std::unique_lock<std::mutex> l(lock); return clt_connected && srv_streams.size() == 1; });
+    BOOST_REQUIRE(clt_connected);
+    BOOST_REQUIRE_EQUAL(1, srv_streams.size());
+
+    // queue all payloads from the server's runner so that they pile up
+    // behind the first write
+    auto stream = srv_streams[0];
+    async::factory::create(
+        r
+      , [&payloads, stream] (const std::shared_ptr<test_runner>&)
+        {
+          auto s = stream;
+          for (auto& p : payloads)
+            s.write(p);
+        }
+    ).run();
+
+    spin_wait(5000, [&] () { std::unique_lock<std::mutex> l(lock); return received.size() >= expected.size() && srv_written == num_payloads; });
+    BOOST_CHECK_EQUAL(num_payloads, srv_written);
+    {
+      std::unique_lock<std::mutex> l(lock);
+      BOOST_CHECK(expected == received);
+    }
+
+    {
+      std::unique_lock<std::mutex> l(lock);
+      srv_streams.clear();
+    }
+  }
+  spin_wait(100, [] () { return false; });
+}
+#endif
+
+#if TEST23 == 1 && defined(LINUX_TARGET)
+// the connections are assigned the runner pinned to the CPU that received
+// them; the runner pinned to all CPUs gets all connections
+BOOST_AUTO_TEST_CASE(incoming_cpu_assignment)
+{
+  std::mutex lock;
+  std::vector<test_runner*> assigned;
+  std::vector<async::net::stream> srv_streams;
+  auto count = [&lock, &assigned] ()
+  {
+    std::unique_lock<std::mutex> l(lock);
+    return assigned.size();
+  };
+
+  auto r = std::make_shared<test_runner>();
+  std::vector<std::shared_ptr<test_runner>> pool;
+  std::vector<std::weak_ptr<test_runner>> weak_pool;
+  for (int i = 0; i < 2; ++i)
+  {
+    pool.push_back(std::make_shared<test_runner>());
+    weak_pool.push_back(pool.back());
+  }
+  std::vector<unsigned int> cpus;
+  for (long i = 0; i < ::sysconf(_SC_NPROCESSORS_CONF); ++i)
+    cpus.push_back(static_cast<unsigned int>(i));
+  pool[1]->affinity(cpus);
+
+  std::vector<int> raws;
+  {
+    auto server = async::net::server(
+        std::weak_ptr<test_runner>(r)
+      , ipv4::any
+      , 22240
+      , [&lock, &assigned] (const std::shared_ptr<test_runner>& r_, const ip::address&, uint16_t)
+        {
+          {
+            std::unique_lock<std::mutex> l(lock);
+            assigned.push_back(r_.get());
+          }
+          return async::net::stream(
+              std::weak_ptr<test_runner>(r_)
+            , [] (const std::shared_ptr<test_runner>&, void*&, std::size_t&) { }
+            , [] (const std::shared_ptr<test_runner>&, const void*, std::size_t) { }
+            , [] (const std::shared_ptr<test_runner>&, oob_event, const std::error_code&) { }
+            , nullptr
+            , 1000);
+        }
+      , [&lock, &srv_streams] (const std::shared_ptr<test_runner>&, const async::net::stream& s_)
+        {
+          std::unique_lock<std::mutex> l(lock);
+          srv_streams.push_back(s_);
+        }
+    );
+    server.runners(weak_pool, async::net::assignment::incoming_cpu);
+    server.start();
+
+    for (int i = 0; i < 3; ++i)
+    {
+      auto raw = raw_connect(22240);
+      BOOST_REQUIRE(raw >= 0);
+      raws.push_back(raw);
+      spin_wait(500, [&count, i] () { return count() == static_cast<std::size_t>(i + 1); });
+      BOOST_REQUIRE_EQUAL(i + 1, count());
+      BOOST_CHECK_EQUAL(pool[1].get(), assigned[i]);
+    }
+
+    for (auto fd : raws)
+      ::close(fd);
+    server.stop();
+    {
+      std::unique_lock<std::mutex> l(lock);
+      srv_streams.clear();
+    }
+  }
+  spin_wait(100, [] () { return false; });
+}
+#endif
+
+#if TEST24 == 1 && !defined(WINDOWS_TARGET)
+// returns the descriptor of the socket connected from the local port
+int find_socket(uint16_t local_port_)
+{
+  for (int fd = 3; fd < 1024; ++fd)
+  {
+    sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    if (::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) == 0
+        && addr.sin_family == AF_INET && ntohs(addr.sin_port) == local_port_)
+    {
+      len = sizeof(addr);
+      if (::getpeername(fd, reinterpret_cast<sockaddr*>(&addr), &len) == 0)
+        return fd;
+    }
+  }
+  return -1;
+}
+
+// the write that fails with an error other than EAGAIN reports the failure
+// through the event handler rather than raising SIGPIPE; the peer is a plain
+// socket that neither reads nor closes the connection, and the stream's own
+// socket is shut down for writing, thus only the write can detect the error
+BOOST_AUTO_TEST_CASE(write_failure)
+{
+  std::mutex lock;
+  std::atomic<bool> clt_connected(false);
+  std::atomic<int> clt_failures(0);
+  std::atomic<int> clt_disconnects(0);
+  std::error_code clt_error;
+
+  int srv = ::socket(AF_INET, SOCK_STREAM, 0);
+  BOOST_REQUIRE_NE(-1, srv);
+  int option = 1;
+  ::setsockopt(srv, SOL_SOCKET, SO_REUSEADDR, &option, sizeof(option));
+  sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(22241);
+  BOOST_REQUIRE_EQUAL(0, ::bind(srv, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)));
+  BOOST_REQUIRE_EQUAL(0, ::listen(srv, 1));
+
+  std::vector<uint8_t> data(1024, 0x55);
+  auto r = std::make_shared<test_runner>();
+  {
+    async::net::stream client(
+        std::weak_ptr<test_runner>(r)
+      , ipv4::loopback
+      , 22241
+      , [] (const std::shared_ptr<test_runner>&, void*&, std::size_t&)
+        { }
+      , [] (const std::shared_ptr<test_runner>&, const void*, std::size_t)
+        { }
+      , [&] (const std::shared_ptr<test_runner>&, oob_event evt, const std::error_code& e_)
+        {
+          switch (evt)
+          {
+            case oob_event::connect:
+              clt_connected = true;
+              break;
+            case oob_event::failure:
+            {
+              std::unique_lock<std::mutex> l(lock);
+              clt_error = e_;
+              ++clt_failures;
+              break;
+            }
+            case oob_event::disconnect:
+              ++clt_disconnects;
+              break;
+            case oob_event::internal:
+            case oob_event::timeout:
+              break;
+          }
+        }
+    );
+
+    socklen_t len = sizeof(addr);
+    int peer = ::accept(srv, reinterpret_cast<sockaddr*>(&addr), &len);
+    BOOST_REQUIRE_NE(-1, peer);
+    spin_wait(2000, [&] () { return clt_connected.load(); });
+    BOOST_REQUIRE(clt_connected);
+
+    int fd = find_socket(ntohs(addr.sin_port));
+    BOOST_REQUIRE_NE(-1, fd);
+    BOOST_REQUIRE_EQUAL(0, ::shutdown(fd, SHUT_WR));
+
+    client.write(async::net::payload(data.data(), data.size()));
+    spin_wait(2000, [&] () { return clt_failures > 0; });
+    BOOST_CHECK_EQUAL(1, clt_failures);
+    {
+      std::unique_lock<std::mutex> l(lock);
+      BOOST_CHECK_EQUAL(EPIPE, clt_error.value());
+    }
+
+    // the stream is no longer busy writing and accepts new writes, which
+    // fail again
+    client.write(async::net::payload(data.data(), data.size()));
+    spin_wait(2000, [&] () { return clt_failures > 1; });
+    BOOST_CHECK_EQUAL(2, clt_failures);
+    BOOST_CHECK_EQUAL(0, clt_disconnects);
+
+    ::close(peer);
+  }
+  ::close(srv);
+  spin_wait(100, [] () { return false; });
+}
+#endif
+
 BOOST_AUTO_TEST_SUITE_END()
 
 
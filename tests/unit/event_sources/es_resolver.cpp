@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2017 Leon Mlakar.
+ * Copyright (c) 2017 Digiverse d.o.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. The
+ * license should be included in the source distribution of the Software;
+ * if not, you may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and licensing terms shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#include <iostream>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <string>
+
+#define BOOST_TEST_MODULE ResolverEventSources
+#include <boost/test/unit_test.hpp>
+
+#include "cool/ng/bases.h"
+#include "cool/ng/async.h"
+#include "cool/ng/async/net/resolver.h"
+
+BOOST_AUTO_TEST_SUITE(resolver)
+
+namespace async = cool::ng::async;
+namespace ip = cool::ng::net::ip;
+namespace ipv4 = cool::ng::net::ipv4;
+namespace ipv6 = cool::ng::net::ipv6;
+using cool::ng::error::errc;
+using ms = std::chrono::milliseconds;
+
+class test_runner : public cool::ng::async::runner
+{ };
+
+void spin_wait(unsigned int msec, const std::function<bool()>& lambda)
+{
+  auto start = std::chrono::system_clock::now();
+  while (!lambda())
+  {
+    auto now = std::chrono::system_clock::now();
+    if (std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count() >= msec)
+      return;
+    std::this_thread::yield();
+  }
+}
+
+// collects the results reported to the result handler
+struct collector
+{
+  collector() : calls(0), errors(0), wrong_runner(0)
+  { }
+
+  async::net::resolver<test_runner>::result_handler handler(const std::shared_ptr<test_runner>& r_)
+  {
+    return [this, r_] (const std::shared_ptr<test_runner>& r, const std::vector<ip::host_container>& hosts_, const std::error_code& err_)
+    {
+      std::unique_lock<std::mutex> l(lock);
+      if (r != r_)
+        ++wrong_runner;
+      if (err_)
+      {
+        ++errors;
+        error = err_;
+      }
+      hosts = hosts_;
+      ++calls;
+    };
+  }
+
+  bool has(const ip::address& addr_)
+  {
+    std::unique_lock<std::mutex> l(lock);
+    for (auto& h : hosts)
+      if (static_cast<const ip::address&>(h) == addr_)
+        return true;
+    return false;
+  }
+
+  std::mutex                      lock;
+  std::atomic<int>                calls;
+  std::atomic<int>                errors;
+  std::atomic<int>                wrong_runner;
+  std::error_code                 error;
+  std::vector<ip::host_container> hosts;
+};
+
+// names from the local hosts file are resolved
+BOOST_AUTO_TEST_CASE(hosts_file)
+{
+  auto r = std::make_shared<test_runner>();
+  async::net::resolver<test_runner> res(r);
+  collector c;
+
+  res.resolve("localhost", c.handler(r));
+  spin_wait(2000, [&c] () { return c.calls == 1; });
+  BOOST_REQUIRE_EQUAL(1, c.calls);
+  BOOST_CHECK_EQUAL(0, c.errors);
+  BOOST_CHECK_EQUAL(0, c.wrong_runner);
+  BOOST_CHECK(c.has(ipv4::loopback) || c.has(ipv6::loopback));
+}
+
+BOOST_AUTO_TEST_CASE(numeric_address)
+{
+  auto r = std::make_shared<test_runner>();
+  async::net::resolver<test_runner> res(r);
+  collector c;
+
+  res.resolve("127.0.0.1", c.handler(r));
+  spin_wait(2000, [&c] () { return c.calls == 1; });
+  BOOST_REQUIRE_EQUAL(1, c.calls);
+  BOOST_CHECK_EQUAL(0, c.errors);
+  BOOST_CHECK_EQUAL(1, c.hosts.size());
+  BOOST_CHECK(c.has(ipv4::loopback));
+}
+
+// the unknown names fail and the failures are cached as well
+BOOST_AUTO_TEST_CASE(unknown_name)
+{
+  auto r = std::make_shared<test_runner>();
+  async::net::resolver<test_runner> res(r);
+  collector c;
+
+  res.resolve("no-such-host.invalid", c.handler(r));
+  spin_wait(10000, [&c] () { return c.calls == 1; });
+  BOOST_REQUIRE_EQUAL(1, c.calls);
+  BOOST_CHECK_EQUAL(1, c.errors);
+  BOOST_CHECK(c.hosts.empty());
+  BOOST_CHECK(c.error == errc::name_not_found || c.error == errc::request_failed);
+
+  res.resolve("no-such-host.invalid", c.handler(r));
+  spin_wait(2000, [&c] () { return c.calls == 2; });
+  BOOST_CHECK_EQUAL(2, c.calls);
+  BOOST_CHECK_EQUAL(2, c.errors);
+  BOOST_CHECK_EQUAL(1, res.lookups());
+}
+
+// concurrent requests share one lookup, subsequent requests are served from
+// the cache until the time to live expires
+BOOST_AUTO_TEST_CASE(cache)
+{
+  auto r = std::make_shared<test_runner>();
+  async::net::resolver<test_runner>::options opts;
+  opts.ttl = ms(300);
+  async::net::resolver<test_runner> res(r, opts);
+  collector c;
+
+  for (int i = 0; i < 10; ++i)
+    res.resolve("localhost", c.handler(r));
+  spin_wait(2000, [&c] () { return c.calls == 10; });
+  BOOST_REQUIRE_EQUAL(10, c.calls);
+  BOOST_CHECK_EQUAL(0, c.errors);
+  BOOST_CHECK_EQUAL(1, res.lookups());
+
+  res.resolve("localhost", c.handler(r));
+  spin_wait(2000, [&c] () { return c.calls == 11; });
+  BOOST_CHECK_EQUAL(11, c.calls);
+  BOOST_CHECK_EQUAL(1, res.lookups());
+
+  // copies share the cache
+  auto copy = res;
+  copy.resolve("localhost", c.handler(r));
+  spin_wait(2000, [&c] () { return c.calls == 12; });
+  BOOST_CHECK_EQUAL(12, c.calls);
+  BOOST_CHECK_EQUAL(1, res.lookups());
+
+  std::this_thread::sleep_for(ms(400));
+  res.resolve("localhost", c.handler(r));
+  spin_wait(2000, [&c] () { return c.calls == 13; });
+  BOOST_CHECK_EQUAL(13, c.calls);
+  BOOST_CHECK_EQUAL(2, res.lookups());
+
+  res.flush();
+  res.resolve("localhost", c.handler(r));
+  spin_wait(2000, [&c] () { return c.calls == 14; });
+  BOOST_CHECK_EQUAL(14, c.calls);
+  BOOST_CHECK_EQUAL(3, res.lookups());
+  BOOST_CHECK_EQUAL(0, c.errors);
+  BOOST_CHECK_EQUAL(0, c.wrong_runner);
+}
+
+BOOST_AUTO_TEST_CASE(bad_options)
+{
+  auto r = std::make_shared<test_runner>();
+  async::net::resolver<test_runner>::options opts;
+  opts.threads = 0;
+  BOOST_CHECK_THROW(async::net::resolver<test_runner>(r, opts), cool::ng::exception::illegal_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -30,6 +30,9 @@
 #else
 # include <sys/types.h>
 # include <sys/socket.h>
+# include <signal.h>
+# include <pthread.h>
+# include <unistd.h>
 #endif
 
 #include <iostream>
@@ -37,6 +40,7 @@
 #include <memory>
 #include <array>
 #include <stack>
+#include <vector>
 #include <functional>
 #include <atomic>
 #include <mutex>
@@ -64,6 +68,22 @@ using std::placeholders::_4;
 
 #define DELAY 100000
 
+#if defined(LINUX_TARGET)
+// On Linux the signals reported through the signal objects must be blocked
+// in all threads, hence SIGUSR1 is blocked before any thread is created
+struct block_signals
+{
+  block_signals()
+  {
+    sigset_t set;
+    ::sigemptyset(&set);
+    ::sigaddset(&set, SIGUSR1);
+    ::pthread_sigmask(SIG_BLOCK, &set, nullptr);
+  }
+};
+BOOST_GLOBAL_FIXTURE(block_signals);
+#endif
+
 BOOST_AUTO_TEST_SUITE(timer_sources)
 
 namespace net = cool::ng::net;
@@ -140,6 +160,131 @@ BOOST_AUTO_TEST_CASE(basic)
 #endif
 
 
+BOOST_AUTO_TEST_CASE(notifier)
+{
+  auto r1 = std::make_shared<test_runner>();
+  std::atomic<std::size_t> total(0);
+  std::atomic<int> runs(0);
+
+  {
+    auto t = cool::ng::async::factory::create(
+        r1
+      , [&total, &runs] (const std::shared_ptr<test_runner>& r, std::size_t count_)
+        {
+          total += count_;
+          ++runs;
+        }
+    );
+
+    async::notifier n(t);
+    BOOST_CHECK(!!n);
+
+    // signals are accumulated while the notifier is inactive
+    for (int i = 0; i < 100; ++i)
+      n.signal();
+    n.signal(0);
+    n.signal(5);
+    std::this_thread::sleep_for(ms(100));
+    BOOST_CHECK_EQUAL(0, runs.load());
+
+    n.start();
+    spin_wait(500, [&total] () { return total == 105; });
+    BOOST_CHECK_EQUAL(105, total.load());
+    BOOST_CHECK_EQUAL(1, runs.load());
+
+    // signals from several threads, possibly coalesced
+    std::vector<std::thread> producers;
+    for (int i = 0; i < 4; ++i)
+      producers.push_back(std::thread([&n] () { for (int j = 0; j < 1000; ++j) n.signal(); }));
+    for (auto& p : producers)
+      p.join();
+
+    spin_wait(1000, [&total] () { return total == 4105; });
+    BOOST_CHECK_EQUAL(4105, total.load());
+    BOOST_CHECK(runs.load() <= 4001);
+
+    n.stop();
+    auto prev = runs.load();
+    n.signal(3);
+    std::this_thread::sleep_for(ms(100));
+    BOOST_CHECK_EQUAL(prev, runs.load());
+    n.start();
+    spin_wait(500, [&total] () { return total == 4108; });
+    BOOST_CHECK_EQUAL(4108, total.load());
+  }
+  std::this_thread::sleep_for(ms(100)); // give time for cleanup
+
+  async::notifier empty;
+  BOOST_CHECK(!empty);
+  BOOST_CHECK_THROW(empty.signal(), cool::ng::exception::empty_object);
+  BOOST_CHECK_THROW(async::notifier(async::notifier::task_type()), cool::ng::exception::illegal_argument);
+}
+
+BOOST_AUTO_TEST_CASE(signal)
+{
+  auto r1 = std::make_shared<test_runner>();
+  std::atomic<std::size_t> total(0);
+
+  {
+    auto t = cool::ng::async::factory::create(
+        r1
+      , [&total] (const std::shared_ptr<test_runner>& r, std::size_t count_)
+        {
+          total += count_;
+        }
+    );
+
+    async::signal s(SIGUSR1, t);
+    BOOST_CHECK(!!s);
+
+    // the deliveries are accumulated while the signal object is inactive
+    ::kill(::getpid(), SIGUSR1);
+    std::this_thread::sleep_for(ms(100));
+    ::kill(::getpid(), SIGUSR1);
+    std::this_thread::sleep_for(ms(100));
+    BOOST_CHECK_EQUAL(0, total.load());
+
+    s.start();
+    spin_wait(500, [&total] () { return total == 2; });
+    BOOST_CHECK_EQUAL(2, total.load());
+
+    ::kill(::getpid(), SIGUSR1);
+    spin_wait(500, [&total] () { return total == 3; });
+    BOOST_CHECK_EQUAL(3, total.load());
+  }
+
+  // the original disposition is restored once the signal object is gone
+  auto is_default = [] ()
+  {
+    struct sigaction act;
+    ::sigaction(SIGUSR1, nullptr, &act);
+    return act.sa_handler == SIG_DFL;
+  };
+  spin_wait(500, is_default);
+  BOOST_CHECK(is_default());
+
+#if defined(LINUX_TARGET)
+  // the signal that was blocked before remains blocked
+  {
+    sigset_t set;
+    ::pthread_sigmask(SIG_BLOCK, nullptr, &set);
+    BOOST_CHECK(::sigismember(&set, SIGUSR1) == 1);
+  }
+#endif
+
+  auto t = cool::ng::async::factory::create(
+      r1
+    , [] (const std::shared_ptr<test_runner>&, std::size_t) { }
+  );
+  BOOST_CHECK_THROW(async::signal(SIGKILL, t), cool::ng::exception::illegal_argument);
+  BOOST_CHECK_THROW(async::signal(0, t), cool::ng::exception::illegal_argument);
+  BOOST_CHECK_THROW(async::signal(SIGUSR2, async::signal::task_type()), cool::ng::exception::illegal_argument);
+
+  async::signal empty;
+  BOOST_CHECK(!empty);
+  BOOST_CHECK_THROW(empty.start(), cool::ng::exception::empty_object);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 
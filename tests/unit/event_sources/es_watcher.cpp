@@ -0,0 +1,290 @@
+/*
+ * Copyright (c) 2017 Leon Mlakar.
+ * Copyright (c) 2017 Digiverse d.o.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. The
+ * license should be included in the source distribution of the Software;
+ * if not, you may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and licensing terms shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <iostream>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <string>
+
+#define BOOST_TEST_MODULE WatcherEventSources
+#include <boost/test/unit_test.hpp>
+
+#include "cool/ng/bases.h"
+#include "cool/ng/async.h"
+
+BOOST_AUTO_TEST_SUITE(watcher)
+
+namespace async = cool::ng::async;
+namespace exc = cool::ng::exception;
+using cool::ng::net::handle;
+using cool::ng::net::invalid_handle;
+using ms = std::chrono::milliseconds;
+
+class test_runner : public cool::ng::async::runner
+{ };
+
+void spin_wait(unsigned int msec, const std::function<bool()>& lambda)
+{
+  auto start = std::chrono::system_clock::now();
+  while (!lambda())
+  {
+    auto now = std::chrono::system_clock::now();
+    if (std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count() >= msec)
+      return;
+    std::this_thread::yield();
+  }
+}
+
+// creates a pipe with both ends in non-blocking mode
+void make_pipe(handle (&fds_)[2])
+{
+  BOOST_REQUIRE_EQUAL(0, ::pipe(fds_));
+  for (auto fd : fds_)
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+BOOST_AUTO_TEST_CASE(readable)
+{
+  auto runner = std::make_shared<test_runner>();
+  handle fds[2];
+  make_pipe(fds);
+
+  std::mutex lock;
+  std::string received;
+  std::atomic<int> calls(0);
+  std::atomic<int> wrong_runner(0);
+
+  {
+    async::watcher w(
+        std::weak_ptr<test_runner>(runner)
+      , fds[0]
+      , [&] (const std::shared_ptr<test_runner>& r_, handle fd_, std::size_t)
+        {
+          if (r_ != runner)
+            ++wrong_runner;
+          char buf[64];
+          auto res = ::read(fd_, buf, sizeof(buf));
+          if (res > 0)
+          {
+            std::unique_lock<std::mutex> l(lock);
+            received.append(buf, res);
+          }
+          ++calls;
+        }
+      , nullptr);
+
+    BOOST_CHECK(!!w);
+
+    // inactive until started
+    BOOST_REQUIRE_EQUAL(5, ::write(fds[1], "hello", 5));
+    std::this_thread::sleep_for(ms(100));
+    BOOST_CHECK_EQUAL(0, calls.load());
+
+    w.start();
+    spin_wait(500, [&] () { std::unique_lock<std::mutex> l(lock); return received.size() == 5; });
+    {
+      std::unique_lock<std::mutex> l(lock);
+      BOOST_CHECK_EQUAL("hello", received);
+    }
+
+    // the data written while stopped is only reported after restart
+    w.stop();
+    auto prev = calls.load();
+    BOOST_REQUIRE_EQUAL(6, ::write(fds[1], " world", 6));
+    std::this_thread::sleep_for(ms(100));
+    BOOST_CHECK_EQUAL(prev, calls.load());
+
+    w.start(async::readiness::readable);
+    spin_wait(500, [&] () { std::unique_lock<std::mutex> l(lock); return received.size() == 11; });
+    {
+      std::unique_lock<std::mutex> l(lock);
+      BOOST_CHECK_EQUAL("hello world", received);
+    }
+    BOOST_CHECK_EQUAL(0, wrong_runner.load());
+  }
+
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
+
+BOOST_AUTO_TEST_CASE(writable)
+{
+  auto runner = std::make_shared<test_runner>();
+  handle fds[2];
+  make_pipe(fds);
+
+  std::atomic<int> calls(0);
+  std::atomic<std::size_t> space(0);
+  async::watcher w;
+
+  w = async::watcher(
+      std::weak_ptr<test_runner>(runner)
+    , fds[1]
+    , nullptr
+    , [&] (const std::shared_ptr<test_runner>&, handle, std::size_t size_)
+      {
+        space = size_;
+        ++calls;
+        w.stop(async::readiness::writable);
+      });
+
+  // starting the readiness without a handler has no effect
+  w.start(async::readiness::readable);
+  std::this_thread::sleep_for(ms(100));
+  BOOST_CHECK_EQUAL(0, calls.load());
+
+  w.start(async::readiness::writable);
+  spin_wait(500, [&] () { return calls.load() > 0; });
+  std::this_thread::sleep_for(ms(100));
+  BOOST_CHECK_EQUAL(1, calls.load());
+
+  w = async::watcher();
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
+
+BOOST_AUTO_TEST_CASE(owner)
+{
+  auto runner = std::make_shared<test_runner>();
+  handle fds[2];
+  make_pipe(fds);
+
+  {
+    async::watcher w(
+        std::weak_ptr<test_runner>(runner)
+      , fds[0]
+      , [] (const std::shared_ptr<test_runner>&, handle, std::size_t) { }
+      , nullptr
+      , true);
+    w.start();
+  }
+
+  // the descriptor is closed once the dispatch sources are gone
+  spin_wait(500, [&] () { return ::fcntl(fds[0], F_GETFD) == -1; });
+  BOOST_CHECK_EQUAL(-1, ::fcntl(fds[0], F_GETFD));
+  BOOST_CHECK_NE(-1, ::fcntl(fds[1], F_GETFD));
+  ::close(fds[1]);
+}
+
+// the descriptor not owned by the watcher may be closed once the release
+// handler was called; the owned descriptor is already closed by then
+BOOST_AUTO_TEST_CASE(release)
+{
+  auto runner = std::make_shared<test_runner>();
+  handle fds[2];
+  make_pipe(fds);
+
+  std::atomic<int> released(0);
+  std::atomic<handle> released_fd(invalid_handle);
+  std::atomic<bool> open_at_release(false);
+  {
+    async::watcher w(
+        std::weak_ptr<test_runner>(runner)
+      , fds[0]
+      , [] (const std::shared_ptr<test_runner>&, handle fd_, std::size_t)
+        {
+          char buf[64];
+          while (::read(fd_, buf, sizeof(buf)) > 0)
+            ;
+        }
+      , nullptr
+      , false
+      , [&] (const std::shared_ptr<test_runner>&, handle fd_)
+        {
+          released_fd = fd_;
+          open_at_release = ::fcntl(fd_, F_GETFD) != -1;
+          ++released;
+        });
+    w.start();
+    BOOST_REQUIRE_EQUAL(5, ::write(fds[1], "hello", 5));
+    std::this_thread::sleep_for(ms(50));
+    BOOST_CHECK_EQUAL(0, released.load());
+  }
+
+  spin_wait(500, [&] () { return released > 0; });
+  BOOST_CHECK_EQUAL(1, released.load());
+  BOOST_CHECK_EQUAL(fds[0], released_fd.load());
+  BOOST_CHECK(open_at_release);
+  BOOST_CHECK_NE(-1, ::fcntl(fds[0], F_GETFD));
+  ::close(fds[0]);
+
+  // the owned descriptor is closed before the release handler is called
+  make_pipe(fds);
+  {
+    async::watcher w(
+        std::weak_ptr<test_runner>(runner)
+      , fds[1]
+      , nullptr
+      , [] (const std::shared_ptr<test_runner>&, handle, std::size_t) { }
+      , true
+      , [&] (const std::shared_ptr<test_runner>&, handle fd_)
+        {
+          open_at_release = ::fcntl(fd_, F_GETFD) != -1;
+          ++released;
+        });
+  }
+  spin_wait(500, [&] () { return released > 1; });
+  BOOST_CHECK_EQUAL(2, released.load());
+  BOOST_CHECK(!open_at_release);
+  ::close(fds[0]);
+}
+
+BOOST_AUTO_TEST_CASE(errors)
+{
+  auto runner = std::make_shared<test_runner>();
+  handle fds[2];
+  make_pipe(fds);
+
+  using handler = std::function<void(const std::shared_ptr<test_runner>&, handle, std::size_t)>;
+  handler h = [] (const std::shared_ptr<test_runner>&, handle, std::size_t) { };
+
+  BOOST_CHECK_THROW(async::watcher(std::weak_ptr<test_runner>(runner), fds[0], nullptr, nullptr), exc::illegal_argument);
+  BOOST_CHECK_THROW(async::watcher(std::weak_ptr<test_runner>(runner), invalid_handle, h, nullptr), exc::illegal_argument);
+  {
+    std::weak_ptr<test_runner> gone;
+    {
+      auto aux = std::make_shared<test_runner>();
+      gone = aux;
+    }
+    BOOST_CHECK_THROW(async::watcher(gone, fds[0], h, nullptr), exc::runner_not_available);
+  }
+
+  async::watcher w;
+  BOOST_CHECK(!w);
+  BOOST_CHECK_THROW(w.start(), exc::empty_object);
+  BOOST_CHECK_THROW(w.stop(), exc::empty_object);
+  BOOST_CHECK_THROW(w.name(), exc::empty_object);
+
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -31,12 +31,20 @@
 #include <thread>
 #include <chrono>
 #include <condition_variable>
+#include <vector>
+#include <algorithm>
+
+#if defined(LINUX_TARGET)
+#include <sched.h>
+#endif
 
 #define BOOST_TEST_MODULE Executor
 #include <boost/test/unit_test.hpp>
 
 #include "cool/ng/async/runner.h"
+#include "cool/ng/exception.h"
 #include "cool/ng/impl/async/context.h"
+#include "cool/ng/impl/async/task.h"
 #include "lib/async/executor.h"
 
 using namespace cool::ng::async::detail;
@@ -46,6 +54,18 @@ using ms = std::chrono::milliseconds;
 #define TEST2 1
 #define TEST3 1
 #define TEST4 1
+#define TEST5 1
+#define TEST6 1
+#define TEST7 1
+#define TEST8 1
+#define TEST9 1
+#define TEST10 1
+#define TEST11 1
+#define TEST12 1
+#define TEST13 1
+#define TEST14 1
+#define TEST15 1
+#define TEST16 1
 
 
 class test_stack : public context_stack
@@ -101,6 +121,7 @@ class test_context : public context
   void set_input(const any&) override { }
   void set_res_reporter(const result_reporter& arg_) override { }
   void set_exc_reporter(const exception_reporter& arg_) override { }
+  void report_exception(const std::exception_ptr&) override { }
 
  private:
   std::shared_ptr<cool::ng::async::runner> m_runner;
@@ -137,7 +158,15 @@ class test_simple : public context, public context_stack
   }
   void set_input(const any&) override { }
   void set_res_reporter(const result_reporter& arg_) override { }
-  void set_exc_reporter(const exception_reporter& arg_) override { }
+  void set_exc_reporter(const exception_reporter& arg_) override
+  {
+    m_exc_reporter = arg_;
+  }
+  void report_exception(const std::exception_ptr& e_) override
+  {
+    if (m_exc_reporter)
+      m_exc_reporter(e_);
+  }
 
   // context stack interface
 
@@ -159,6 +188,7 @@ class test_simple : public context, public context_stack
  private:
   std::shared_ptr<cool::ng::async::runner> m_runner;
   std::function<void(const std::shared_ptr<cool::ng::async::runner>&)> m_func;
+  exception_reporter m_exc_reporter;
 };
 
 void spin_wait(unsigned int msec, const std::function<bool()>& lambda)
@@ -320,4 +350,977 @@ BOOST_AUTO_TEST_CASE(multi_thread_run_feed)
 
 #endif
 
+#if TEST5==1
+BOOST_AUTO_TEST_CASE(queue_depth)
+{
+  auto runner = std::make_shared<cool::ng::async::runner>();
+  std::atomic_int aux;
+  aux = 0;
+  std::atomic<bool> release(false);
+
+  BOOST_CHECK_EQUAL(0, runner->queue_depth());
+
+  runner->impl()->run(new test_simple(
+      runner
+    , [&] (const std::shared_ptr<cool::ng::async::runner>&)
+      {
+        spin_wait(2000, [&release] { return release.load(); });
+        ++aux;
+      }
+    )
+  );
+  for (int i = 0; i < 3; ++i)
+  {
+    runner->impl()->run(new test_simple(
+        runner
+      , [&aux] (const std::shared_ptr<cool::ng::async::runner>&)
+        {
+          ++aux;
+        }
+    ));
+  }
+
+  // the running task no longer counts
+  spin_wait(500, [&runner] { return runner->queue_depth() == 3; });
+  BOOST_CHECK_EQUAL(3, runner->queue_depth());
+
+  release = true;
+  spin_wait(500, [&aux] { return aux == 4; });
+  BOOST_CHECK_EQUAL(4, aux);
+  BOOST_CHECK_EQUAL(0, runner->queue_depth());
+}
+#endif
+
+#if TEST6==1
+// tasks from each producer run in submission order and never overlap
+BOOST_AUTO_TEST_CASE(sequential_mailbox)
+{
+  const int NUM_TASKS = 20000;
+  const int NUM_THREADS = 4;
+
+  auto runner = std::make_shared<cool::ng::async::runner>();
+  std::atomic_int done;
+  std::atomic_int overlaps;
+  std::atomic_int out_of_order;
+  std::atomic<bool> running(false);
+  int last[NUM_THREADS];
+  done = 0;
+  overlaps = 0;
+  out_of_order = 0;
+  for (auto& l : last)
+    l = -1;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < NUM_THREADS; ++t)
+  {
+    threads.push_back(std::thread(
+      [&, t]
+      {
+        for (int i = 0; i < NUM_TASKS; ++i)
+        {
+          runner->impl()->run(new test_simple(
+              runner
+            , [&, t, i] (const std::shared_ptr<cool::ng::async::runner>&)
+              {
+                if (running.exchange(true))
+                  ++overlaps;
+                if (last[t] != i - 1)
+                  ++out_of_order;
+                last[t] = i;
+                running = false;
+                ++done;
+              }
+          ));
+        }
+      }
+    ));
+  }
+  for (auto& t : threads)
+    t.join();
+
+  spin_wait(5000, [&] { return done == NUM_TASKS * NUM_THREADS; } );
+  BOOST_CHECK_EQUAL(NUM_TASKS * NUM_THREADS, done);
+  BOOST_CHECK_EQUAL(0, overlaps);
+  BOOST_CHECK_EQUAL(0, out_of_order);
+  BOOST_CHECK_EQUAL(0, runner->queue_depth());
+}
+#endif
+
+#if TEST7==1
+// a large number of runners with a few tasks each
+BOOST_AUTO_TEST_CASE(many_runners)
+{
+  const int NUM_RUNNERS = 20000;
+  const int NUM_TASKS = 5;
+
+  std::atomic_int done;
+  done = 0;
+  {
+    std::vector<std::shared_ptr<cool::ng::async::runner>> runners;
+    for (int i = 0; i < NUM_RUNNERS; ++i)
+      runners.push_back(std::make_shared<cool::ng::async::runner>());
+
+    for (int t = 0; t < NUM_TASKS; ++t)
+      for (auto& r : runners)
+        r->impl()->run(new test_simple(
+            r
+          , [&done] (const std::shared_ptr<cool::ng::async::runner>&)
+            {
+              ++done;
+            }
+        ));
+
+    spin_wait(10000, [&] { return done == NUM_RUNNERS * NUM_TASKS; } );
+  }
+  BOOST_CHECK_EQUAL(NUM_RUNNERS * NUM_TASKS, done);
+}
+#endif
+
+#if TEST8==1
+// the worker pool cannot be removed once configured, hence the test cases
+// that need it follow this one
+BOOST_AUTO_TEST_CASE(worker_pool)
+{
+  const int NUM_RUNNERS = 16;
+  const int NUM_TASKS = 10;
+  const int MIN_THREADS = 2;
+  const int MAX_THREADS = 4;
+
+  BOOST_CHECK_EQUAL(0, cool::ng::async::runner::worker_threads());
+  BOOST_CHECK_THROW(cool::ng::async::runner::worker_pool(0, 0), cool::ng::exception::illegal_argument);
+  BOOST_CHECK_THROW(cool::ng::async::runner::worker_pool(3, 2), cool::ng::exception::illegal_argument);
+  BOOST_CHECK_EQUAL(0, cool::ng::async::runner::worker_threads());
+
+  cool::ng::async::runner::worker_pool(MIN_THREADS, MAX_THREADS);
+  BOOST_CHECK_EQUAL(MIN_THREADS, cool::ng::async::runner::worker_threads());
+
+  std::atomic_int done;
+  std::atomic_int active;
+  std::atomic_int max_active;
+  done = 0;
+  active = 0;
+  max_active = 0;
+  {
+    std::vector<std::shared_ptr<cool::ng::async::runner>> runners;
+    for (int i = 0; i < NUM_RUNNERS; ++i)
+      runners.push_back(std::make_shared<cool::ng::async::runner>());
+
+    for (int t = 0; t < NUM_TASKS; ++t)
+      for (auto& r : runners)
+        r->impl()->run(new test_simple(
+            r
+          , [&] (const std::shared_ptr<cool::ng::async::runner>&)
+            {
+              int n = ++active;
+              int m = max_active;
+              while (n > m && !max_active.compare_exchange_weak(m, n))
+                ;
+              std::this_thread::sleep_for(ms(2));
+              --active;
+              ++done;
+            }
+        ));
+
+    spin_wait(10000, [&] { return done == NUM_RUNNERS * NUM_TASKS; } );
+  }
+  BOOST_CHECK_EQUAL(NUM_RUNNERS * NUM_TASKS, done);
+  BOOST_CHECK_LE(max_active, MAX_THREADS);
+  BOOST_CHECK_LE(cool::ng::async::runner::worker_threads(), MAX_THREADS);
+  BOOST_CHECK_GE(cool::ng::async::runner::worker_threads(), MIN_THREADS);
+
+  // shrinking the pool lets the surplus threads exit
+  cool::ng::async::runner::worker_pool(1, 1);
+  spin_wait(2000, [&] { return cool::ng::async::runner::worker_threads() == 1; } );
+  BOOST_CHECK_EQUAL(1, cool::ng::async::runner::worker_threads());
+
+  done = 0;
+  auto r = std::make_shared<cool::ng::async::runner>();
+  for (int t = 0; t < NUM_TASKS; ++t)
+    r->impl()->run(new test_simple(
+        r
+      , [&done] (const std::shared_ptr<cool::ng::async::runner>&)
+        {
+          ++done;
+        }
+    ));
+  spin_wait(2000, [&] { return done == NUM_TASKS; } );
+  BOOST_CHECK_EQUAL(NUM_TASKS, done);
+}
+#endif
+
+#if TEST9==1
+// expects the worker pool with a single thread, left by the previous test
+BOOST_AUTO_TEST_CASE(priorities)
+{
+  const int NUM_HIGH = 40;
+
+  {
+    cool::ng::async::runner r(cool::ng::async::RunPolicy::SEQUENTIAL, cool::ng::async::RunPriority::HIGH);
+    BOOST_CHECK(cool::ng::async::RunPriority::HIGH == r.priority());
+    cool::ng::async::runner d;
+    BOOST_CHECK(cool::ng::async::RunPriority::DEFAULT == d.priority());
+  }
+
+  BOOST_CHECK(cool::ng::async::runner::sys_high() == cool::ng::async::runner::sys_high());
+  BOOST_CHECK(cool::ng::async::RunPriority::HIGH == cool::ng::async::runner::sys_high()->priority());
+  BOOST_CHECK(cool::ng::async::RunPriority::DEFAULT == cool::ng::async::runner::sys_default()->priority());
+  BOOST_CHECK(cool::ng::async::RunPriority::LOW == cool::ng::async::runner::sys_low()->priority());
+  BOOST_CHECK(cool::ng::async::RunPriority::BACKGROUND == cool::ng::async::runner::sys_background()->priority());
+  BOOST_CHECK(cool::ng::async::RunPriority::DEFAULT == cool::ng::async::runner::cool_default()->priority());
+
+  BOOST_REQUIRE_EQUAL(1, cool::ng::async::runner::worker_threads());
+
+  // occupy the only worker thread while the other runners submit their work
+  std::atomic<bool> release(false);
+  std::atomic<bool> blocked(false);
+  auto blocker = std::make_shared<cool::ng::async::runner>();
+  blocker->impl()->run(new test_simple(
+      blocker
+    , [&] (const std::shared_ptr<cool::ng::async::runner>&)
+      {
+        blocked = true;
+        while (!release)
+          std::this_thread::sleep_for(ms(1));
+      }
+  ));
+  spin_wait(1000, [&] { return blocked.load(); } );
+  BOOST_REQUIRE(blocked);
+
+  std::mutex lock;
+  std::vector<cool::ng::async::RunPriority> order;
+  auto record = [&] (const std::shared_ptr<cool::ng::async::runner>& r_)
+  {
+    std::unique_lock<std::mutex> l(lock);
+    order.push_back(r_->priority());
+  };
+
+  auto low = std::make_shared<cool::ng::async::runner>(
+      cool::ng::async::RunPolicy::SEQUENTIAL, cool::ng::async::RunPriority::BACKGROUND);
+  low->impl()->run(new test_simple(low, record));
+
+  std::vector<std::shared_ptr<cool::ng::async::runner>> high;
+  for (int i = 0; i < NUM_HIGH; ++i)
+  {
+    high.push_back(std::make_shared<cool::ng::async::runner>(
+        cool::ng::async::RunPolicy::SEQUENTIAL, cool::ng::async::RunPriority::HIGH));
+    high.back()->impl()->run(new test_simple(high.back(), record));
+  }
+
+  release = true;
+  spin_wait(5000, [&] { std::unique_lock<std::mutex> l(lock); return order.size() == NUM_HIGH + 1; } );
+  BOOST_REQUIRE_EQUAL(NUM_HIGH + 1, order.size());
+
+  // the background runner yields to the high priority runners, but only
+  // for a bounded number of times
+  auto pos = std::find(order.begin(), order.end(), cool::ng::async::RunPriority::BACKGROUND) - order.begin();
+  BOOST_CHECK_GT(pos, 0);
+  BOOST_CHECK_LT(pos, NUM_HIGH);
+
+  // the system-wide runners execute tasks
+  std::atomic_int done;
+  done = 0;
+  std::vector<std::shared_ptr<cool::ng::async::runner>> sys = {
+      cool::ng::async::runner::sys_high()
+    , cool::ng::async::runner::sys_default()
+    , cool::ng::async::runner::sys_low()
+    , cool::ng::async::runner::sys_background()
+    , cool::ng::async::runner::cool_default()
+  };
+  for (auto& r : sys)
+    r->impl()->run(new test_simple(
+        r
+      , [&done] (const std::shared_ptr<cool::ng::async::runner>&)
+        {
+          ++done;
+        }
+    ));
+  spin_wait(2000, [&] { return done == 5; } );
+  BOOST_CHECK_EQUAL(5, done);
+}
+#endif
+
+#if TEST10==1 && defined(LINUX_TARGET)
+// the tasks of the pinned runner execute on its CPUs and the thread regains
+// its previous affinity afterwards
+BOOST_AUTO_TEST_CASE(affinity)
+{
+  const int NUM_TASKS = 100;
+
+  BOOST_CHECK_THROW(
+      cool::ng::async::runner().affinity(std::vector<unsigned int>{ CPU_SETSIZE })
+    , cool::ng::exception::illegal_argument);
+  BOOST_CHECK_THROW(
+      cool::ng::async::runner::worker_affinity(std::vector<unsigned int>{ CPU_SETSIZE })
+    , cool::ng::exception::illegal_argument);
+  BOOST_CHECK_THROW(cool::ng::async::runner::numa_cpus(100000), cool::ng::exception::illegal_argument);
+
+  auto node = cool::ng::async::runner::numa_cpus(0);
+  BOOST_CHECK(!node.empty());
+
+  // pin to the last CPU available to the process
+  cpu_set_t allowed;
+  BOOST_REQUIRE_EQUAL(0, sched_getaffinity(0, sizeof(allowed), &allowed));
+  unsigned int cpu = 0;
+  for (unsigned int i = 0; i < CPU_SETSIZE; ++i)
+    if (CPU_ISSET(i, &allowed))
+      cpu = i;
+
+  auto runner = std::make_shared<cool::ng::async::runner>();
+  BOOST_CHECK(runner->affinity().empty());
+  runner->affinity({ cpu });
+  BOOST_REQUIRE_EQUAL(1, runner->affinity().size());
+  BOOST_CHECK_EQUAL(cpu, runner->affinity()[0]);
+  cool::ng::async::runner::worker_affinity({ cpu });
+
+  std::atomic_int done;
+  std::atomic_int misplaced;
+  done = 0;
+  misplaced = 0;
+  for (int i = 0; i < NUM_TASKS; ++i)
+    runner->impl()->run(new test_simple(
+        runner
+      , [&, cpu] (const std::shared_ptr<cool::ng::async::runner>&)
+        {
+          if (sched_getcpu() != static_cast<int>(cpu))
+            ++misplaced;
+          ++done;
+        }
+    ));
+  spin_wait(2000, [&] { return done == NUM_TASKS; } );
+  BOOST_CHECK_EQUAL(NUM_TASKS, done);
+  BOOST_CHECK_EQUAL(0, misplaced);
+
+  // the unpinned runner runs on any of the allowed CPUs
+  runner->affinity(std::vector<unsigned int>());
+  cool::ng::async::runner::worker_affinity(std::vector<unsigned int>());
+  BOOST_CHECK(runner->affinity().empty());
+
+  done = 0;
+  std::atomic_int restricted;
+  restricted = 0;
+  for (int i = 0; i < NUM_TASKS; ++i)
+    runner->impl()->run(new test_simple(
+        runner
+      , [&] (const std::shared_ptr<cool::ng::async::runner>&)
+        {
+          cpu_set_t set;
+          sched_getaffinity(0, sizeof(set), &set);
+          if (CPU_COUNT(&set) < CPU_COUNT(&allowed))
+            ++restricted;
+          ++done;
+        }
+    ));
+  spin_wait(2000, [&] { return done == NUM_TASKS; } );
+  BOOST_CHECK_EQUAL(NUM_TASKS, done);
+  BOOST_CHECK_EQUAL(0, restricted);
+}
+#endif
+
+#if TEST11==1
+// the runner with limited capacity applies the overflow policy to the new
+// tasks while its only worker is blocked
+BOOST_AUTO_TEST_CASE(capacity)
+{
+  const int CAPACITY = 3;
+
+  auto runner = std::make_shared<cool::ng::async::runner>();
+  BOOST_CHECK_EQUAL(0, runner->capacity());
+
+  std::mutex lock;
+  std::vector<int> ran;
+  std::vector<int> dropped;
+  auto task = [&] (int i_)
+  {
+    auto ret = new test_simple(
+        runner
+      , [&, i_] (const std::shared_ptr<cool::ng::async::runner>&)
+        {
+          std::unique_lock<std::mutex> l(lock);
+          ran.push_back(i_);
+        }
+    );
+    ret->set_exc_reporter([&, i_] (const std::exception_ptr& e_)
+      {
+        try
+        {
+          std::rethrow_exception(e_);
+        }
+        catch (const cool::ng::exception::operation_failed& e)
+        {
+          if (e.code() == cool::ng::error::errc::request_rejected)
+          {
+            std::unique_lock<std::mutex> l(lock);
+            dropped.push_back(i_);
+          }
+        }
+      });
+    return ret;
+  };
+  auto ran_count = [&] ()
+  {
+    std::unique_lock<std::mutex> l(lock);
+    return ran.size();
+  };
+
+  std::atomic<bool> release;
+  std::atomic<bool> blocked;
+  auto block = [&] ()
+  {
+    release = false;
+    blocked = false;
+    BOOST_REQUIRE(kickstart(new test_simple(
+        runner
+      , [&] (const std::shared_ptr<cool::ng::async::runner>&)
+        {
+          blocked = true;
+          while (!release)
+            std::this_thread::sleep_for(ms(1));
+        }
+    )));
+    spin_wait(1000, [&] { return blocked.load(); } );
+    BOOST_REQUIRE(blocked);
+  };
+
+  // reject
+  runner->capacity(CAPACITY);
+  BOOST_CHECK_EQUAL(CAPACITY, runner->capacity());
+  block();
+  for (int i = 0; i < CAPACITY; ++i)
+    BOOST_CHECK(kickstart(task(i)));
+  BOOST_CHECK(!kickstart(task(CAPACITY)));
+  BOOST_CHECK_EQUAL(CAPACITY, runner->queue_depth());
+  release = true;
+  spin_wait(1000, [&] { return ran_count() == CAPACITY; } );
+  spin_wait(50, [] { return false; } );
+  BOOST_CHECK_EQUAL(CAPACITY, ran_count());
+  BOOST_CHECK(std::vector<int>({ 0, 1, 2 }) == ran);
+
+  // drop oldest
+  ran.clear();
+  runner->capacity(CAPACITY, cool::ng::async::OverflowPolicy::DROP_OLDEST);
+  block();
+  for (int i = 0; i < CAPACITY + 2; ++i)
+    BOOST_CHECK(kickstart(task(i)));
+  release = true;
+  spin_wait(1000, [&] { return ran_count() == CAPACITY; } );
+  spin_wait(50, [] { return false; } );
+  BOOST_CHECK(std::vector<int>({ 2, 3, 4 }) == ran);
+  BOOST_CHECK(std::vector<int>({ 0, 1 }) == dropped);
+  BOOST_CHECK_EQUAL(0, runner->queue_depth());
+
+  // drop oldest never drops the continuations and rejects the new task if
+  // there is nothing else to drop
+  ran.clear();
+  dropped.clear();
+  block();
+  for (int i = 0; i < CAPACITY; ++i)
+    runner->impl()->run(task(10 + i));
+  BOOST_CHECK(!kickstart(task(0)));
+  release = true;
+  spin_wait(1000, [&] { return ran_count() == CAPACITY; } );
+  spin_wait(50, [] { return false; } );
+  BOOST_CHECK(std::vector<int>({ 10, 11, 12 }) == ran);
+  BOOST_CHECK(dropped.empty());
+  BOOST_CHECK_EQUAL(0, runner->queue_depth());
+
+  // caller runs, serialized with the runner's tasks
+  ran.clear();
+  runner->capacity(CAPACITY, cool::ng::async::OverflowPolicy::CALLER_RUNS);
+  block();
+  for (int i = 0; i < CAPACITY; ++i)
+    BOOST_CHECK(kickstart(task(i)));
+  std::atomic<bool> ran_caller(false);
+  std::thread caller([&] ()
+    {
+      ran_caller = kickstart(task(CAPACITY));
+    });
+  spin_wait(50, [] { return false; } );
+  BOOST_CHECK_EQUAL(0, ran_count());
+  release = true;
+  caller.join();
+  BOOST_CHECK(ran_caller);
+  spin_wait(1000, [&] { return ran_count() == CAPACITY + 1; } );
+  BOOST_CHECK_EQUAL(CAPACITY + 1, ran_count());
+
+  // block
+  ran.clear();
+  runner->capacity(CAPACITY, cool::ng::async::OverflowPolicy::BLOCK);
+  block();
+  for (int i = 0; i < CAPACITY; ++i)
+    BOOST_CHECK(kickstart(task(i)));
+  std::atomic<bool> submitted(false);
+  std::thread submitter([&] ()
+    {
+      kickstart(task(CAPACITY));
+      submitted = true;
+    });
+  spin_wait(50, [] { return false; } );
+  BOOST_CHECK(!submitted);
+  release = true;
+  submitter.join();
+  BOOST_CHECK(submitted);
+  spin_wait(1000, [&] { return ran_count() == CAPACITY + 1; } );
+  BOOST_CHECK(std::vector<int>({ 0, 1, 2, 3 }) == ran);
+
+  // no limit
+  ran.clear();
+  runner->capacity(0);
+  block();
+  for (int i = 0; i < 2 * CAPACITY; ++i)
+    BOOST_CHECK(kickstart(task(i)));
+  release = true;
+  spin_wait(1000, [&] { return ran_count() == 2 * CAPACITY; } );
+  BOOST_CHECK_EQUAL(2 * CAPACITY, ran_count());
+}
+#endif
+
+#if TEST12==1
+// the waiting tasks are executed in the order of their deadlines and the
+// expired tasks are shed if requested
+BOOST_AUTO_TEST_CASE(earliest_deadline)
+{
+  using cool::ng::async::deadline;
+  const auto never = deadline::clock::time_point::max();
+
+  BOOST_CHECK(never == deadline::current());
+  {
+    deadline d1(ms(100));
+    auto t1 = deadline::current();
+    BOOST_CHECK(t1 != never);
+    {
+      deadline d2(ms(10));
+      BOOST_CHECK(deadline::current() < t1);
+    }
+    BOOST_CHECK(t1 == deadline::current());
+  }
+  BOOST_CHECK(never == deadline::current());
+
+  auto runner = std::make_shared<cool::ng::async::runner>(cool::ng::async::RunPolicy::EARLIEST_DEADLINE);
+
+  std::mutex lock;
+  std::vector<int> ran;
+  std::vector<int> shed;
+  auto task = [&] (int i_)
+  {
+    auto ret = new test_simple(
+        runner
+      , [&, i_] (const std::shared_ptr<cool::ng::async::runner>&)
+        {
+          std::unique_lock<std::mutex> l(lock);
+          ran.push_back(i_);
+        }
+    );
+    ret->set_exc_reporter([&, i_] (const std::exception_ptr& e_)
+      {
+        try
+        {
+          std::rethrow_exception(e_);
+        }
+        catch (const cool::ng::exception::operation_failed& e)
+        {
+          if (e.code() == cool::ng::error::errc::timed_out)
+          {
+            std::unique_lock<std::mutex> l(lock);
+            shed.push_back(i_);
+          }
+        }
+      });
+    return ret;
+  };
+  auto ran_count = [&] ()
+  {
+    std::unique_lock<std::mutex> l(lock);
+    return ran.size();
+  };
+
+  std::atomic<bool> release;
+  std::atomic<bool> blocked;
+  auto block = [&] ()
+  {
+    release = false;
+    blocked = false;
+    kickstart(new test_simple(
+        runner
+      , [&] (const std::shared_ptr<cool::ng::async::runner>&)
+        {
+          blocked = true;
+          while (!release)
+            std::this_thread::sleep_for(ms(1));
+        }
+    ));
+    spin_wait(1000, [&] { return blocked.load(); } );
+    BOOST_REQUIRE(blocked);
+  };
+
+  // earliest deadline first, the tasks without the deadline last
+  block();
+  {
+    deadline d(ms(500));
+    kickstart(task(0));
+  }
+  {
+    deadline d(ms(100));
+    kickstart(task(1));
+  }
+  kickstart(task(2));
+  {
+    deadline d(ms(300));
+    kickstart(task(3));
+  }
+  kickstart(task(4));
+  release = true;
+  spin_wait(1000, [&] { return ran_count() == 5; } );
+  BOOST_CHECK(std::vector<int>({ 1, 3, 0, 2, 4 }) == ran);
+
+  // shedding of the expired tasks
+  ran.clear();
+  runner->shed_expired(true);
+  block();
+  {
+    deadline d(ms(5));
+    kickstart(task(0));
+  }
+  {
+    deadline d(std::chrono::seconds(10));
+    kickstart(task(1));
+  }
+  kickstart(task(2));
+  std::this_thread::sleep_for(ms(20));
+  release = true;
+  spin_wait(1000, [&] { return ran_count() == 2; } );
+  spin_wait(50, [] { return false; } );
+  BOOST_CHECK(std::vector<int>({ 1, 2 }) == ran);
+  BOOST_CHECK(std::vector<int>({ 0 }) == shed);
+  BOOST_CHECK_EQUAL(1, runner->shed_count());
+
+  // the tasks submitted from a task inherit its deadline
+  auto other = std::make_shared<cool::ng::async::runner>(cool::ng::async::RunPolicy::EARLIEST_DEADLINE);
+  std::atomic<bool> done(false);
+  deadline::clock::time_point inherited;
+  deadline::clock::time_point expected;
+  {
+    deadline d(std::chrono::seconds(10));
+    expected = deadline::current();
+    kickstart(new test_simple(
+        runner
+      , [&] (const std::shared_ptr<cool::ng::async::runner>&)
+        {
+          kickstart(new test_simple(
+              other
+            , [&] (const std::shared_ptr<cool::ng::async::runner>&)
+              {
+                inherited = deadline::current();
+                done = true;
+              }
+          ));
+        }
+    ));
+  }
+  spin_wait(1000, [&] { return done.load(); } );
+  BOOST_REQUIRE(done);
+  BOOST_CHECK(expected == inherited);
+}
+#endif
+
+#if TEST13==1
+// the waiting tasks are executed from the lanes with higher priority first,
+// strictly or weighted
+BOOST_AUTO_TEST_CASE(priority_lanes)
+{
+  using cool::ng::async::task_priority;
+  using cool::ng::async::RunPriority;
+
+  BOOST_CHECK(RunPriority::DEFAULT == task_priority::current());
+  {
+    task_priority p1(RunPriority::LOW);
+    BOOST_CHECK(RunPriority::LOW == task_priority::current());
+    {
+      task_priority p2(RunPriority::HIGH);
+      BOOST_CHECK(RunPriority::HIGH == task_priority::current());
+    }
+    BOOST_CHECK(RunPriority::LOW == task_priority::current());
+  }
+  BOOST_CHECK(RunPriority::DEFAULT == task_priority::current());
+
+  auto runner = std::make_shared<cool::ng::async::runner>();
+
+  std::mutex lock;
+  std::vector<int> ran;
+  auto task = [&] (int i_, RunPriority p_)
+  {
+    task_priority p(p_);
+    kickstart(new test_simple(
+        runner
+      , [&, i_] (const std::shared_ptr<cool::ng::async::runner>&)
+        {
+          std::unique_lock<std::mutex> l(lock);
+          ran.push_back(i_);
+        }
+    ));
+  };
+  auto ran_count = [&] ()
+  {
+    std::unique_lock<std::mutex> l(lock);
+    return ran.size();
+  };
+
+  std::atomic<bool> release;
+  std::atomic<bool> blocked;
+  auto block = [&] ()
+  {
+    release = false;
+    blocked = false;
+    kickstart(new test_simple(
+        runner
+      , [&] (const std::shared_ptr<cool::ng::async::runner>&)
+        {
+          blocked = true;
+          while (!release)
+            std::this_thread::sleep_for(ms(1));
+        }
+    ));
+    spin_wait(1000, [&] { return blocked.load(); } );
+    BOOST_REQUIRE(blocked);
+  };
+
+  // strict lanes
+  block();
+  for (int i = 0; i < 3; ++i)
+    task(i, RunPriority::DEFAULT);
+  task(10, RunPriority::HIGH);
+  task(20, RunPriority::BACKGROUND);
+  task(11, RunPriority::HIGH);
+  release = true;
+  spin_wait(1000, [&] { return ran_count() == 6; } );
+  BOOST_CHECK(std::vector<int>({ 10, 11, 0, 1, 2, 20 }) == ran);
+
+  // weighted lanes; the background lane gets its turn after each eight
+  // high priority tasks
+  ran.clear();
+  runner->weighted_lanes(true);
+  block();
+  for (int i = 0; i < 12; ++i)
+    task(100 + i, RunPriority::HIGH);
+  for (int i = 0; i < 3; ++i)
+    task(i, RunPriority::BACKGROUND);
+  release = true;
+  spin_wait(1000, [&] { return ran_count() == 15; } );
+  BOOST_CHECK(std::vector<int>({ 100, 101, 102, 103, 104, 105, 106, 107, 0, 108, 109, 110, 111, 1, 2 }) == ran);
+}
+#endif
+
+#if TEST14==1
+// the busy polling runner executes the tasks submitted while its thread
+// spins as well as the tasks that wake the parked thread
+BOOST_AUTO_TEST_CASE(busy_poll)
+{
+  const int NUM_TASKS = 10000;
+
+  std::atomic_int done;
+  std::atomic_int overlaps;
+  std::atomic<bool> running(false);
+  done = 0;
+  overlaps = 0;
+
+  auto runner = std::make_shared<cool::ng::async::runner>(cool::ng::async::RunPolicy::BUSY_POLL);
+  runner->spin_period(std::chrono::microseconds(500));
+  auto task = [&] ()
+  {
+    return new test_simple(
+        runner
+      , [&] (const std::shared_ptr<cool::ng::async::runner>&)
+        {
+          if (running.exchange(true))
+            ++overlaps;
+          running = false;
+          ++done;
+        }
+    );
+  };
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t)
+    threads.push_back(std::thread([&] ()
+      {
+        for (int i = 0; i < NUM_TASKS; ++i)
+          runner->impl()->run(task());
+      }));
+  for (auto& t : threads)
+    t.join();
+  spin_wait(5000, [&] { return done == 4 * NUM_TASKS; } );
+  BOOST_CHECK_EQUAL(4 * NUM_TASKS, done);
+  BOOST_CHECK_EQUAL(0, overlaps);
+  BOOST_CHECK_EQUAL(0, runner->queue_depth());
+
+  // let the thread park, then wake it with new tasks
+  for (int i = 0; i < 3; ++i)
+  {
+    std::this_thread::sleep_for(ms(20));
+    runner->impl()->run(task());
+    spin_wait(1000, [&] { return done == 4 * NUM_TASKS + i + 1; } );
+    BOOST_CHECK_EQUAL(4 * NUM_TASKS + i + 1, done);
+  }
+
+  // the runner may be released by its own task
+  std::atomic<bool> released(false);
+  runner->impl()->run(new test_simple(
+      runner
+    , [&] (const std::shared_ptr<cool::ng::async::runner>&)
+      {
+        std::this_thread::sleep_for(ms(20));
+        released = true;
+      }
+  ));
+  runner.reset();
+  spin_wait(1000, [&] { return released.load(); } );
+  BOOST_CHECK(released);
+}
+#endif
+
+#if TEST15==1
+// the manually stepped runner executes the tasks only on the owner's request
+BOOST_AUTO_TEST_CASE(manual)
+{
+  std::atomic_int done;
+  done = 0;
+
+  auto runner = std::make_shared<cool::ng::async::runner>(cool::ng::async::RunPolicy::MANUAL);
+  auto task = [&] ()
+  {
+    return new test_simple(
+        runner
+      , [&] (const std::shared_ptr<cool::ng::async::runner>&)
+        {
+          ++done;
+        }
+    );
+  };
+
+  BOOST_CHECK(!runner->run_one());
+  BOOST_CHECK_EQUAL(0, runner->poll());
+
+  for (int i = 0; i < 5; ++i)
+    runner->impl()->run(task());
+  std::this_thread::sleep_for(ms(50));
+  BOOST_CHECK_EQUAL(0, done);
+  BOOST_CHECK_EQUAL(5, runner->queue_depth());
+
+  BOOST_CHECK(runner->run_one());
+  BOOST_CHECK_EQUAL(1, done);
+  BOOST_CHECK_EQUAL(4, runner->poll());
+  BOOST_CHECK_EQUAL(5, done);
+  BOOST_CHECK_EQUAL(0, runner->queue_depth());
+  BOOST_CHECK(!runner->run_one());
+
+  // poll leaves the tasks submitted by the tasks for the next call, while
+  // run_until_idle executes them as well
+  auto chain = [&] ()
+  {
+    return new test_simple(
+        runner
+      , [&] (const std::shared_ptr<cool::ng::async::runner>& r_)
+        {
+          ++done;
+          r_->impl()->run(task());
+        }
+    );
+  };
+  runner->impl()->run(chain());
+  runner->impl()->run(chain());
+  BOOST_CHECK_EQUAL(2, runner->poll());
+  BOOST_CHECK_EQUAL(7, done);
+  BOOST_CHECK_EQUAL(2, runner->queue_depth());
+  runner->impl()->run(chain());
+  BOOST_CHECK_EQUAL(4, runner->run_until_idle());
+  BOOST_CHECK_EQUAL(11, done);
+  BOOST_CHECK_EQUAL(0, runner->queue_depth());
+
+  // the runner's own task cannot step the runner
+  std::atomic<bool> thrown(false);
+  runner->impl()->run(new test_simple(
+      runner
+    , [&] (const std::shared_ptr<cool::ng::async::runner>& r_)
+      {
+        try { r_->poll(); } catch (const cool::ng::exception::invalid_state&) { thrown = true; }
+      }
+  ));
+  BOOST_CHECK(runner->run_one());
+  BOOST_CHECK(thrown);
+
+  // the other runners cannot be stepped
+  auto other = std::make_shared<cool::ng::async::runner>();
+  BOOST_CHECK_THROW(other->run_one(), cool::ng::exception::invalid_state);
+  BOOST_CHECK_THROW(other->run_until_idle(), cool::ng::exception::invalid_state);
+
+  // the tasks left in the queue of the released runner are discarded
+  for (int i = 0; i < 3; ++i)
+    runner->impl()->run(task());
+  runner.reset();
+  std::this_thread::sleep_for(ms(50));
+  BOOST_CHECK_EQUAL(11, done);
+}
+#endif
+
+#if TEST16==1
+// the tasks of the runners and the owner of the manually stepped runner do
+// not block on the full runner, as they might wait for themselves
+BOOST_AUTO_TEST_CASE(block_without_deadlock)
+{
+  cool::ng::async::runner::worker_pool(1, 1);
+
+  std::atomic_int done;
+  done = 0;
+  auto count = [&] (const std::shared_ptr<cool::ng::async::runner>& r_)
+  {
+    return new test_simple(
+        r_
+      , [&] (const std::shared_ptr<cool::ng::async::runner>&)
+        {
+          ++done;
+        }
+    );
+  };
+
+  // the task of the runner A occupies the only thread of the pool while it
+  // submits to the full runner B, whose drain needs that very thread
+  auto a = std::make_shared<cool::ng::async::runner>();
+  auto b = std::make_shared<cool::ng::async::runner>();
+  b->capacity(1, cool::ng::async::OverflowPolicy::BLOCK);
+
+  std::atomic<bool> started(false);
+  std::atomic<bool> go(false);
+  std::atomic<bool> submitted(false);
+  BOOST_REQUIRE(kickstart(new test_simple(
+      a
+    , [&] (const std::shared_ptr<cool::ng::async::runner>&)
+      {
+        started = true;
+        while (!go)
+          std::this_thread::sleep_for(ms(1));
+        submitted = kickstart(count(b));
+      }
+  )));
+  spin_wait(1000, [&] { return started.load(); } );
+  BOOST_REQUIRE(started);
+  BOOST_CHECK(kickstart(count(b)));
+  BOOST_CHECK_EQUAL(1, b->queue_depth());
+  go = true;
+
+  spin_wait(2000, [&] { return done == 2; } );
+  BOOST_CHECK(submitted);
+  BOOST_CHECK_EQUAL(2, done);
+
+  // the owner of the full manually stepped runner is the only one to make
+  // room in its queue
+  done = 0;
+  auto m = std::make_shared<cool::ng::async::runner>(cool::ng::async::RunPolicy::MANUAL);
+  m->capacity(1, cool::ng::async::OverflowPolicy::BLOCK);
+  BOOST_CHECK(kickstart(count(m)));
+  BOOST_CHECK(kickstart(count(m)));
+  BOOST_CHECK_EQUAL(2, m->queue_depth());
+  BOOST_CHECK_EQUAL(2, m->run_until_idle());
+  BOOST_CHECK_EQUAL(2, done);
+}
+#endif
+
 BOOST_AUTO_TEST_SUITE_END()
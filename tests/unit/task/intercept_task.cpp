@@ -308,4 +308,64 @@ auto outer = cool::ng::async::factory::try_catch(
 
 
 }
+
+// the try task shed by the runner fails with the timed_out error and its
+// catch task handles it
+BOOST_AUTO_TEST_CASE(shed_try_task)
+{
+  auto runner = std::make_shared<cool::ng::async::runner>(cool::ng::async::RunPolicy::EARLIEST_DEADLINE);
+  runner->shed_expired(true);
+  std::mutex m;
+  std::condition_variable cv;
+  std::atomic<bool> blocked(false);
+  std::atomic<bool> release(false);
+  std::atomic<int> counter;
+  counter = 0;
+
+  auto blocker = cool::ng::async::factory::create(
+      runner
+    , [&blocked, &release] (const std::shared_ptr<cool::ng::async::runner>&)
+      {
+        blocked = true;
+        while (!release)
+          std::this_thread::sleep_for(ms(1));
+      }
+  );
+  auto t1 = cool::ng::async::factory::create(
+      runner
+    , [&counter] (const std::shared_ptr<cool::ng::async::runner>&, int value) -> int
+      {
+        counter = 21;
+        return value;
+      }
+  );
+  auto t2 = cool::ng::async::factory::create(
+      runner
+    , [&m, &cv, &counter] (const std::shared_ptr<cool::ng::async::runner>&, const cool::ng::exception::operation_failed& e) -> int
+      {
+        counter = e.code() == cool::ng::error::errc::timed_out ? 42 : 84;
+        std::unique_lock<std::mutex> l(m);
+        cv.notify_one();
+        return counter;
+      }
+  );
+  auto task = cool::ng::async::factory::try_catch(t1, t2);
+
+  blocker.run();
+  for (int i = 0; i < 1000 && !blocked; ++i)
+    std::this_thread::sleep_for(ms(1));
+  BOOST_REQUIRE(blocked);
+  {
+    cool::ng::async::deadline d(ms(5));
+    task.run(5);
+  }
+  std::this_thread::sleep_for(ms(20));
+
+  std::unique_lock<std::mutex> l(m);
+  release = true;
+  cv.wait_for(l, ms(500), [&counter] { return counter != 0; });
+  BOOST_CHECK_EQUAL(42, counter);
+  BOOST_CHECK_EQUAL(1, runner->shed_count());
+}
+
 BOOST_AUTO_TEST_SUITE_END()